@@ -3243,7 +3243,10 @@ Its value is void, and its function definition and property list are nil.  */)
   set_symbol_plist (val, Qnil);
   p->redirect = SYMBOL_PLAINVAL;
   SET_SYMBOL_VAL (p, Qunbound);
-  set_symbol_function (val, Qnil);
+  /* Not set_symbol_function: no cached function lookup can refer to
+     a new symbol, since the collector that freed its storage
+     invalidated them all, so there is no need to do that again.  */
+  p->function = Qnil;
   set_symbol_next (val, NULL);
   p->gcmarkbit = 0;
   p->interned = SYMBOL_UNINTERNED;
@@ -5305,6 +5308,10 @@ See Info node `(elisp)Garbage Collection'.  */)
 
   shrink_regexp_cache ();
 
+  /* Symbols and function objects may be freed and their storage
+     reused, so forget all cached function lookups.  */
+  function_cell_epoch++;
+
   gc_in_progress = 1;
 
   /* Mark all the special slots that serve as the roots of accessibility.  */
@@ -5589,6 +5596,16 @@ mark_face_cache (struct face_cache *c)
 		mark_object (face->lface[j]);
 	    }
 	}
+
+      if (c->merge_cache)
+	for (i = 0; i < FACE_MERGE_CACHE_SIZE; ++i)
+	  {
+	    struct face_merge_entry *entry = c->merge_cache + i;
+
+	    if (entry->base_face_id >= 0)
+	      for (j = 0; j < entry->nprops; ++j)
+		mark_object (entry->props[j]);
+	  }
     }
 }
 
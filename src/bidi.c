@@ -1151,6 +1151,43 @@ bidi_find_paragraph_start (ptrdiff_t pos, ptrdiff_t pos_byte)
   return pos_byte;
 }
 
+/* Return a buffer position after LIMIT and at or before CHARPOS that
+   immediately follows a strong left-to-right character, with no
+   explicit directional or paragraph separator characters between it
+   and CHARPOS, and store its byte position in *RESTART_BYTEPOS.  If
+   there is no such position, return -1.
+
+   If CHARPOS is at the base embedding level of a left-to-right
+   paragraph, starting the UBA afresh at the returned position, as if
+   a line began there, resolves the levels of the characters that
+   follow exactly as does starting at the beginning of the paragraph.  */
+ptrdiff_t
+bidi_find_restart_position (ptrdiff_t charpos, ptrdiff_t bytepos,
+			    ptrdiff_t limit, ptrdiff_t *restart_bytepos)
+{
+  if (!bidi_initialized)
+    bidi_initialize ();
+
+  while (charpos > limit)
+    {
+      ptrdiff_t pos = charpos, pos_byte = bytepos;
+      bidi_type_t type;
+
+      DEC_BOTH (pos, pos_byte);
+      type = bidi_get_type (FETCH_CHAR (pos_byte), NEUTRAL_DIR);
+      if (type == STRONG_L)
+	{
+	  *restart_bytepos = bytepos;
+	  return charpos;
+	}
+      if (type == LRE || type == LRO || type == RLE || type == RLO
+	  || type == PDF || type == NEUTRAL_B)
+	break;
+      charpos = pos, bytepos = pos_byte;
+    }
+  return -1;
+}
+
 /* On a 3.4 GHz machine, searching forward for a strong directional
    character in a long paragraph full of weaks or neutrals takes about
    1 ms for each 20K characters.  The number below limits each call to
@@ -1040,7 +1040,10 @@ reset_buffer_local_variables (struct buffer *b, bool permanent_too)
 	else if (NILP (last))
 	  bset_local_var_alist (b, XCDR (tmp));
 	else
-	  XSETCDR (last, XCDR (tmp));
+	  {
+	    XSETCDR (last, XCDR (tmp));
+	    local_var_alist_epoch++;
+	  }
     }
 
   for (i = 0; i < last_per_buffer_idx; ++i)
@@ -1204,7 +1207,7 @@ buffer_local_value_1 (Lisp_Object variable, Lisp_Object buffer)
       { /* Look in local_var_alist.  */
 	struct Lisp_Buffer_Local_Value *blv = SYMBOL_BLV (sym);
 	XSETSYMBOL (variable, sym); /* Update In case of aliasing.  */
-	result = Fassoc (variable, BVAR (buf, local_var_alist));
+	result = local_var_binding (buf, variable);
 	if (!NILP (result))
 	  {
 	    if (blv->fwd)
@@ -2148,24 +2151,30 @@ set_buffer_internal_1 (register struct buffer *b)
      when it is not current, fetch them now.  */
   fetch_buffer_markers (b);
 
-  /* Look down buffer's list of local Lisp variables
-     to find and update any that forward into C variables. */
+  /* Update the buffer-local variables that forward into C variables.
+     There are few of them, so walking their list is much cheaper
+     than walking the local_var_alist of B and of the previous buffer,
+     which can hold hundreds of variables.  Each symbol is on the list
+     once, so its length is bounded by the number of DEFVARs.  Only a
+     variable whose C variable holds a buffer-local value, or that is
+     local in B, needs to be updated; for the others, the C variable
+     already holds the default value.  */
 
-  do
+  for (tail = Vforwarded_local_variables; CONSP (tail); tail = XCDR (tail))
     {
-      for (tail = BVAR (b, local_var_alist); CONSP (tail); tail = XCDR (tail))
-	{
-	  Lisp_Object var = XCAR (XCAR (tail));
-	  struct Lisp_Symbol *sym = XSYMBOL (var);
-	  if (sym->redirect == SYMBOL_LOCALIZED /* Just to be sure.  */
-	      && SYMBOL_BLV (sym)->fwd)
-	    /* Just reference the variable
-	       to cause it to become set for this buffer.  */
-	    Fsymbol_value (var);
-	}
+      Lisp_Object var = XCAR (tail);
+      struct Lisp_Symbol *sym = XSYMBOL (var);
+      struct Lisp_Buffer_Local_Value *blv;
+
+      if (sym->redirect != SYMBOL_LOCALIZED) /* Just to be sure.  */
+	continue;
+      blv = SYMBOL_BLV (sym);
+      if (blv->fwd && !blv->frame_local
+	  && (blv_found (blv) || !NILP (local_var_binding (b, var))))
+	/* Just reference the variable
+	   to cause it to become set for this buffer.  */
+	find_symbol_value (var);
     }
-  /* Do the same with any others that were local to the previous buffer */
-  while (b != old_buf && (b = old_buf, b));
 }
 
 /* Switch to buffer B temporarily for redisplay purposes.
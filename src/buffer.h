@@ -930,10 +930,17 @@ bset_last_selected_window (struct buffer *b, Lisp_Object val)
 {
   b->INTERNAL_FIELD (last_selected_window) = val;
 }
+/* Defined in data.c.  */
+extern Lisp_Object Vforwarded_local_variables;
+/* Incremented whenever bindings are added to or removed from any
+   buffer's local_var_alist.  */
+extern EMACS_UINT local_var_alist_epoch;
+
 BUFFER_INLINE void
 bset_local_var_alist (struct buffer *b, Lisp_Object val)
 {
   b->INTERNAL_FIELD (local_var_alist) = val;
+  local_var_alist_epoch++;
 }
 BUFFER_INLINE void
 bset_mark_active (struct buffer *b, Lisp_Object val)
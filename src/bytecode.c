@@ -413,6 +413,22 @@ unmark_byte_stack (void)
 
 #define TOP (*top)
 
+/* The float that the current, single-byte, instruction may overwrite
+   with its result, or nil; see `fresh_float' in exec_byte_code.  */
+
+#define FRESH_FLOAT()							\
+  (stack.pc - 1 - stack.byte_string_start == fresh_float_pc		\
+   ? fresh_float : Qnil)
+
+/* Record that the current instruction has left the float X on top of
+   the stack.  */
+
+#define NOTE_FRESH_FLOAT(x)						\
+  (FLOATP (x)								\
+   ? (fresh_float = (x),						\
+      fresh_float_pc = stack.pc - stack.byte_string_start)		\
+   : (fresh_float_pc = -1))
+
 /* Actions that must be performed before and after calling a function
    that might GC.  */
 
@@ -467,6 +483,121 @@ unmark_byte_stack (void)
   } while (0)
 
 
+/* Store the float value F in *RESULT.  If REUSE is a float that the
+   caller knows to be referenced from nowhere but the operand slots of
+   the current instruction, overwrite it instead of allocating.  */
+
+static void
+store_float (double f, Lisp_Object reuse, Lisp_Object *result)
+{
+  if (FLOATP (reuse))
+    {
+      XFLOAT (reuse)->u.data = f;
+      *result = reuse;
+    }
+  else
+    *result = make_float (f);
+}
+
+/* Fast paths for the arithmetic byte-codes.  If V1 and V2 are both
+   fixnums or floats, store in *RESULT the value of (OP V1 V2), where
+   OP is one of the Bplus, Bdiff, Bmult and Bquo byte-codes, exactly as
+   the corresponding function in data.c would compute it, and return
+   true.  Otherwise, and for fixnum operations that would overflow or
+   divide by zero, return false and leave the work to data.c.
+
+   REUSE is either nil or a float that may be overwritten with a float
+   result, as for store_float; it is used only if it is one of V1 and
+   V2.  */
+
+static bool
+arith_fast_path (int op, Lisp_Object v1, Lisp_Object v2, Lisp_Object reuse,
+		 Lisp_Object *result)
+{
+  if (INTEGERP (v1) && INTEGERP (v2))
+    {
+      EMACS_INT i1 = XINT (v1), i2 = XINT (v2);
+      switch (op)
+	{
+	case Bplus:
+	  XSETINT (*result, i1 + i2);
+	  return true;
+	case Bdiff:
+	  XSETINT (*result, i1 - i2);
+	  return true;
+	case Bmult:
+	  if (INT_MULTIPLY_OVERFLOW (i1, i2))
+	    return false;
+	  XSETINT (*result, i1 * i2);
+	  return true;
+	default:
+	  if (i2 == 0)
+	    return false;
+	  XSETINT (*result, i1 / i2);
+	  return true;
+	}
+    }
+  else if ((FLOATP (v1) || INTEGERP (v1)) && (FLOATP (v2) || INTEGERP (v2)))
+    {
+      double f1 = FLOATP (v1) ? XFLOAT_DATA (v1) : XINT (v1);
+      double f2 = FLOATP (v2) ? XFLOAT_DATA (v2) : XINT (v2);
+      if (! (EQ (reuse, v1) || EQ (reuse, v2)))
+	reuse = Qnil;
+      switch (op)
+	{
+	case Bplus:
+	  /* Like float_arith_driver, start from 0, so that
+	     (+ -0.0 -0.0) is 0.0.  */
+	  store_float (0 + f1 + f2, reuse, result);
+	  return true;
+	case Bdiff:
+	  store_float (f1 - f2, reuse, result);
+	  return true;
+	case Bmult:
+	  store_float (f1 * f2, reuse, result);
+	  return true;
+	default:
+	  if (! IEEE_FLOATING_POINT && f2 == 0)
+	    return false;
+	  store_float (f1 / f2, reuse, result);
+	  return true;
+	}
+    }
+  return false;
+}
+
+/* Likewise for the comparison byte-codes Bgtr, Blss, Bleq and Bgeq;
+   store t or nil in *RESULT as arithcompare would.  */
+
+static bool
+compare_fast_path (int op, Lisp_Object v1, Lisp_Object v2, Lisp_Object *result)
+{
+  bool val;
+
+  if (INTEGERP (v1) && INTEGERP (v2))
+    {
+      EMACS_INT i1 = XINT (v1), i2 = XINT (v2);
+      val = (op == Bgtr ? i1 > i2
+	     : op == Blss ? i1 < i2
+	     : op == Bleq ? i1 <= i2
+	     : i1 >= i2);
+    }
+  else if ((FLOATP (v1) || INTEGERP (v1)) && (FLOATP (v2) || INTEGERP (v2)))
+    {
+      double f1 = FLOATP (v1) ? XFLOAT_DATA (v1) : XINT (v1);
+      double f2 = FLOATP (v2) ? XFLOAT_DATA (v2) : XINT (v2);
+      val = (op == Bgtr ? f1 > f2
+	     : op == Blss ? f1 < f2
+	     : op == Bleq ? f1 <= f2
+	     : f1 >= f2);
+    }
+  else
+    return false;
+
+  *result = val ? Qt : Qnil;
+  return true;
+}
+
 DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
        doc: /* Function used internally in byte-compiled code.
 The first argument, BYTESTR, is a string of byte code;
@@ -504,8 +635,16 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
   ptrdiff_t bytestr_length;
 #endif
   struct byte_stack stack;
-  Lisp_Object *top;
+  Lisp_Object *top, *bottom;
   Lisp_Object result;
+  /* The float most recently made by an arithmetic instruction, and
+     the offset in the byte string of the instruction following it.
+     While it is still on top of the stack and that next instruction
+     is arithmetic too, nothing else can refer to the float, so its
+     storage can be reused for the next result instead of allocating
+     a new one.  */
+  Lisp_Object fresh_float = Qnil;
+  ptrdiff_t fresh_float_pc = -1;
 
 #if 0 /* CHECK_FRAME_FONT */
  {
@@ -546,8 +685,9 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
   if (MAX_ALLOCA / word_size <= XFASTINT (maxdepth))
     memory_full (SIZE_MAX);
   top = alloca ((XFASTINT (maxdepth) + 1) * sizeof *top);
+  bottom = top + 1;
 #if BYTE_MAINTAIN_TOP
-  stack.bottom = top + 1;
+  stack.bottom = bottom;
   stack.top = NULL;
 #endif
   stack.next = byte_stack_list;
@@ -902,6 +1042,44 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 		  }
 	      }
 #endif
+	    if (byte_code_tail_calls
+		&& *stack.pc == Breturn
+		&& INTEGERP (args_template)
+		&& SPECPDL_INDEX () == count
+		&& !debug_on_next_call)
+	      {
+		/* A call immediately followed by a return.  If it calls
+		   the function being executed, and needs no &rest list,
+		   reuse this frame instead of recursing.  */
+		Lisp_Object fun = TOP;
+		ptrdiff_t at = XINT (args_template);
+		ptrdiff_t nonrest = at >> 8;
+
+		if (SYMBOLP (fun) && !NILP (fun))
+		  fun = XSYMBOL (fun)->function;
+		if (COMPILEDP (fun)
+		    && EQ (AREF (fun, COMPILED_BYTECODE), stack.byte_string)
+		    && EQ (AREF (fun, COMPILED_CONSTANTS), vector)
+		    && EQ (AREF (fun, COMPILED_ARGLIST), args_template)
+		    && (at & 127) <= op && op <= nonrest
+		    && set_backtrace_tail_call (count, bottom, op))
+		  {
+		    ptrdiff_t i;
+		    memmove (bottom, top + 1, op * sizeof *top);
+		    top = bottom - 1 + op;
+		    for (i = op; i < nonrest; i++)
+		      PUSH (Qnil);
+		    if (at & 128)
+		      PUSH (Qnil);
+		    stack.pc = stack.byte_string_start;
+		    fresh_float_pc = -1;
+		    BEFORE_POTENTIAL_GC ();
+		    maybe_gc ();
+		    AFTER_POTENTIAL_GC ();
+		    BYTE_CODE_QUIT;
+		    NEXT;
+		  }
+	      }
 	    TOP = Ffuncall (op + 1, &TOP);
 	    AFTER_POTENTIAL_GC ();
 	    NEXT;
@@ -1314,6 +1492,14 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 		XSETINT (v1, XINT (v1) - 1);
 		TOP = v1;
 	      }
+	    else if (FLOATP (v1))
+	      {
+		BEFORE_POTENTIAL_GC ();
+		store_float (XFLOAT_DATA (v1) - 1.0, FRESH_FLOAT (), &TOP);
+		AFTER_POTENTIAL_GC ();
+		NOTE_FRESH_FLOAT (TOP);
+		NEXT;
+	      }
 	    else
 	      {
 		BEFORE_POTENTIAL_GC ();
@@ -1332,6 +1518,14 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 		XSETINT (v1, XINT (v1) + 1);
 		TOP = v1;
 	      }
+	    else if (FLOATP (v1))
+	      {
+		BEFORE_POTENTIAL_GC ();
+		store_float (1.0 + XFLOAT_DATA (v1), FRESH_FLOAT (), &TOP);
+		AFTER_POTENTIAL_GC ();
+		NOTE_FRESH_FLOAT (TOP);
+		NEXT;
+	      }
 	    else
 	      {
 		BEFORE_POTENTIAL_GC ();
@@ -1365,47 +1559,65 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	CASE (Bgtr):
 	  {
 	    Lisp_Object v1;
-	    BEFORE_POTENTIAL_GC ();
 	    v1 = POP;
-	    TOP = arithcompare (TOP, v1, ARITH_GRTR);
-	    AFTER_POTENTIAL_GC ();
+	    if (!compare_fast_path (Bgtr, TOP, v1, &TOP))
+	      {
+		BEFORE_POTENTIAL_GC ();
+		TOP = arithcompare (TOP, v1, ARITH_GRTR);
+		AFTER_POTENTIAL_GC ();
+	      }
 	    NEXT;
 	  }
 
 	CASE (Blss):
 	  {
 	    Lisp_Object v1;
-	    BEFORE_POTENTIAL_GC ();
 	    v1 = POP;
-	    TOP = arithcompare (TOP, v1, ARITH_LESS);
-	    AFTER_POTENTIAL_GC ();
+	    if (!compare_fast_path (Blss, TOP, v1, &TOP))
+	      {
+		BEFORE_POTENTIAL_GC ();
+		TOP = arithcompare (TOP, v1, ARITH_LESS);
+		AFTER_POTENTIAL_GC ();
+	      }
 	    NEXT;
 	  }
 
 	CASE (Bleq):
 	  {
 	    Lisp_Object v1;
-	    BEFORE_POTENTIAL_GC ();
 	    v1 = POP;
-	    TOP = arithcompare (TOP, v1, ARITH_LESS_OR_EQUAL);
-	    AFTER_POTENTIAL_GC ();
+	    if (!compare_fast_path (Bleq, TOP, v1, &TOP))
+	      {
+		BEFORE_POTENTIAL_GC ();
+		TOP = arithcompare (TOP, v1, ARITH_LESS_OR_EQUAL);
+		AFTER_POTENTIAL_GC ();
+	      }
 	    NEXT;
 	  }
 
 	CASE (Bgeq):
 	  {
 	    Lisp_Object v1;
-	    BEFORE_POTENTIAL_GC ();
 	    v1 = POP;
-	    TOP = arithcompare (TOP, v1, ARITH_GRTR_OR_EQUAL);
-	    AFTER_POTENTIAL_GC ();
+	    if (!compare_fast_path (Bgeq, TOP, v1, &TOP))
+	      {
+		BEFORE_POTENTIAL_GC ();
+		TOP = arithcompare (TOP, v1, ARITH_GRTR_OR_EQUAL);
+		AFTER_POTENTIAL_GC ();
+	      }
 	    NEXT;
 	  }
 
 	CASE (Bdiff):
 	  BEFORE_POTENTIAL_GC ();
 	  DISCARD (1);
-	  TOP = Fminus (2, &TOP);
+	  if (arith_fast_path (Bdiff, TOP, top[1], FRESH_FLOAT (), &TOP))
+	    NOTE_FRESH_FLOAT (TOP);
+	  else
+	    {
+	      fresh_float_pc = -1;
+	      TOP = Fminus (2, &TOP);
+	    }
 	  AFTER_POTENTIAL_GC ();
 	  NEXT;
 
@@ -1418,6 +1630,14 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 		XSETINT (v1, - XINT (v1));
 		TOP = v1;
 	      }
+	    else if (FLOATP (v1))
+	      {
+		BEFORE_POTENTIAL_GC ();
+		store_float (- XFLOAT_DATA (v1), FRESH_FLOAT (), &TOP);
+		AFTER_POTENTIAL_GC ();
+		NOTE_FRESH_FLOAT (TOP);
+		NEXT;
+	      }
 	    else
 	      {
 		BEFORE_POTENTIAL_GC ();
@@ -1430,7 +1650,13 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	CASE (Bplus):
 	  BEFORE_POTENTIAL_GC ();
 	  DISCARD (1);
-	  TOP = Fplus (2, &TOP);
+	  if (arith_fast_path (Bplus, TOP, top[1], FRESH_FLOAT (), &TOP))
+	    NOTE_FRESH_FLOAT (TOP);
+	  else
+	    {
+	      fresh_float_pc = -1;
+	      TOP = Fplus (2, &TOP);
+	    }
 	  AFTER_POTENTIAL_GC ();
 	  NEXT;
 
@@ -1451,14 +1677,26 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	CASE (Bmult):
 	  BEFORE_POTENTIAL_GC ();
 	  DISCARD (1);
-	  TOP = Ftimes (2, &TOP);
+	  if (arith_fast_path (Bmult, TOP, top[1], FRESH_FLOAT (), &TOP))
+	    NOTE_FRESH_FLOAT (TOP);
+	  else
+	    {
+	      fresh_float_pc = -1;
+	      TOP = Ftimes (2, &TOP);
+	    }
 	  AFTER_POTENTIAL_GC ();
 	  NEXT;
 
 	CASE (Bquo):
 	  BEFORE_POTENTIAL_GC ();
 	  DISCARD (1);
-	  TOP = Fquo (2, &TOP);
+	  if (arith_fast_path (Bquo, TOP, top[1], FRESH_FLOAT (), &TOP))
+	    NOTE_FRESH_FLOAT (TOP);
+	  else
+	    {
+	      fresh_float_pc = -1;
+	      TOP = Fquo (2, &TOP);
+	    }
 	  AFTER_POTENTIAL_GC ();
 	  NEXT;
 
@@ -1971,6 +2209,16 @@ syms_of_bytecode (void)
 {
   defsubr (&Sbyte_code);
 
+  DEFVAR_BOOL ("byte-code-tail-calls", byte_code_tail_calls,
+	       doc: /* Non-nil means byte-code reuses its frame for self tail calls.
+When a lexically scoped byte-compiled function calls itself and
+immediately returns the value of that call, and the call binds no
+&rest argument, the call runs in the current frame instead of a new
+one.  Such recursion then grows neither the Lisp stack nor the C stack
+and is not limited by `max-lisp-eval-depth', but backtraces show only
+the innermost of the tail calls.  */);
+  byte_code_tail_calls = 0;
+
 #ifdef BYTE_CODE_METER
 
   DEFVAR_LISP ("byte-code-meter", Vbyte_code_meter,
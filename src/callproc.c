@@ -304,6 +304,7 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
   USE_SAFE_ALLOCA;
 
   char **new_argv;
+  char **env;
   /* File to use for stderr in the child.
      t means use same as standard output.  */
   Lisp_Object error_file;
@@ -578,10 +579,13 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
       callproc_fd[CALLPROC_STDERR] = fd_error;
     }
 
+  env = make_environment_block (current_dir);
+
 #ifdef MSDOS /* MW, July 1993 */
   /* Note that on MSDOS `child_setup' actually returns the child process
      exit status, not its PID, so assign it to status below.  */
-  pid = child_setup (filefd, fd_output, fd_error, new_argv, 0, current_dir);
+  pid = child_setup (filefd, fd_output, fd_error, new_argv, env, 0,
+		     current_dir);
 
   if (pid < 0)
     {
@@ -630,7 +634,8 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
   block_child_signal ();
 
 #ifdef WINDOWSNT
-  pid = child_setup (filefd, fd_output, fd_error, new_argv, 0, current_dir);
+  pid = child_setup (filefd, fd_output, fd_error, new_argv, env, 0,
+		     current_dir);
 #else  /* not WINDOWSNT */
 
   /* vfork, and prevent local vars from being clobbered by the vfork.  */
@@ -645,6 +650,7 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
     ptrdiff_t volatile count_volatile = count;
     ptrdiff_t volatile sa_count_volatile = sa_count;
     char **volatile new_argv_volatile = new_argv;
+    char **volatile env_volatile = env;
     int volatile callproc_fd_volatile[CALLPROC_FDS];
     for (i = 0; i < CALLPROC_FDS; i++)
       callproc_fd_volatile[i] = callproc_fd[i];
@@ -661,6 +667,7 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
     count = count_volatile;
     sa_count = sa_count_volatile;
     new_argv = new_argv_volatile;
+    env = env_volatile;
 
     for (i = 0; i < CALLPROC_FDS; i++)
       callproc_fd[i] = callproc_fd_volatile[i];
@@ -676,7 +683,8 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
       /* Emacs ignores SIGPIPE, but the child should not.  */
       signal (SIGPIPE, SIG_DFL);
 
-      child_setup (filefd, fd_output, fd_error, new_argv, 0, current_dir);
+      child_setup (filefd, fd_output, fd_error, new_argv, env, 0,
+		   current_dir);
     }
 
 #endif /* not WINDOWSNT */
@@ -773,15 +781,20 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
   if (0 <= fd0)
     {
       enum { CALLPROC_BUFFER_SIZE_MIN = 16 * 1024 };
-      enum { CALLPROC_BUFFER_SIZE_MAX = 4 * CALLPROC_BUFFER_SIZE_MIN };
-      char buf[CALLPROC_BUFFER_SIZE_MAX];
-      int bufsize = CALLPROC_BUFFER_SIZE_MIN;
-      int nread;
+      ptrdiff_t bufmax = clip_to_bounds (CALLPROC_BUFFER_SIZE_MIN,
+					 read_process_output_max,
+					 min (PTRDIFF_MAX, SIZE_MAX) / 2);
+      char *buf;
+      ptrdiff_t bufsize = CALLPROC_BUFFER_SIZE_MIN;
+      ptrdiff_t nread;
       bool first = 1;
       EMACS_INT total_read = 0;
       int carryover = 0;
       bool display_on_the_fly = display_p;
       struct coding_system saved_coding = process_coding;
+      struct timespec next_display = make_timespec (0, 0);
+
+      buf = SAFE_ALLOCA (bufmax);
 
       while (1)
 	{
@@ -791,8 +804,8 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
 	  nread = carryover;
 	  while (nread < bufsize - 1024)
 	    {
-	      int this_read = emacs_read (fd0, buf + nread,
-					  bufsize - nread);
+	      ptrdiff_t this_read = emacs_read (fd0, buf + nread,
+						bufsize - nread);
 
 	      if (this_read < 0)
 		goto give_up;
@@ -867,17 +880,29 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
 	    break;
 
 	  /* Make the buffer bigger as we continue to read more data,
-	     but not past CALLPROC_BUFFER_SIZE_MAX.  */
-	  if (bufsize < CALLPROC_BUFFER_SIZE_MAX && total_read > 32 * bufsize)
-	    if ((bufsize *= 2) > CALLPROC_BUFFER_SIZE_MAX)
-	      bufsize = CALLPROC_BUFFER_SIZE_MAX;
+	     but not past `read-process-output-max'.  */
+	  if (bufsize < bufmax && total_read > 32 * bufsize)
+	    bufsize = min (2 * bufsize, bufmax);
 
 	  if (display_p)
 	    {
-	      if (first)
-		prepare_menu_bars ();
-	      first = 0;
-	      redisplay_preserve_echo_area (1);
+	      struct timespec now = current_timespec ();
+
+	      /* Don't redisplay more often than
+		 `call-process-redisplay-interval' says.  */
+	      if (first || timespec_cmp (next_display, now) <= 0)
+		{
+		  if (first)
+		    prepare_menu_bars ();
+		  first = 0;
+		  redisplay_preserve_echo_area (1);
+		  if (NUMBERP (Vcall_process_redisplay_interval)
+		      && 0 < XFLOATINT (Vcall_process_redisplay_interval))
+		    next_display
+		      = timespec_add (now,
+				      dtotimespec (XFLOATINT
+						   (Vcall_process_redisplay_interval)));
+		}
 	      /* This variable might have been set to 0 for code
 		 detection.  In that case, set it back to 1 because
 		 we should have already detected a coding system.  */
@@ -1158,77 +1183,50 @@ add_env (char **env, char **new_env, char *string)
   return new_env;
 }
 
-/* This is the last thing run in a newly forked inferior
-   either synchronous or asynchronous.
-   Copy descriptors IN, OUT and ERR as descriptors 0, 1 and 2.
-   Initialize inferior's priority, pgrp, connected dir and environment.
-   then exec another program based on new_argv.
+/* Strip the trailing slashes of DIR, a directory name NBYTES bytes
+   long, as for PWD, but leave "/" and "//" alone.  */
 
-   If SET_PGRP, put the subprocess into a separate process group.
+static void
+strip_directory_slashes (char *dir, ptrdiff_t nbytes)
+{
+#ifdef DOS_NT
+  /* Get past the drive letter, so that d:/ is left alone.  */
+  if (nbytes > 2 && IS_DEVICE_SEP (dir[1]) && IS_DIRECTORY_SEP (dir[2]))
+    {
+      dir += 2;
+      nbytes -= 2;
+    }
+#endif /* DOS_NT */
 
-   CURRENT_DIR is an elisp string giving the path of the current
-   directory the subprocess should have.  Since we can't really signal
-   a decent error from within the child, this should be verified as an
-   executable directory by the parent.  */
+  while (nbytes > 2 && IS_DIRECTORY_SEP (dir[nbytes - 1]))
+    dir[--nbytes] = 0;
+}
 
-int
-child_setup (int in, int out, int err, char **new_argv, bool set_pgrp,
-	     Lisp_Object current_dir)
+/* Return a vector of the environment strings for a subprocess whose
+   current directory is CURRENT_DIR, terminated by a null pointer.
+   This is done before forking, so that the inferior only has to pass
+   the vector to execve.  The vector and the strings it owns are
+   freed when the caller unwinds; the other strings belong to
+   `process-environment', so the caller must not let a garbage
+   collection happen before the vector has been used.  */
+
+char **
+make_environment_block (Lisp_Object current_dir)
 {
   char **env;
   char *pwd_var;
-#ifdef WINDOWSNT
-  int cpid;
-  HANDLE handles[3];
-#else
-  int exec_errno;
-
-  pid_t pid = getpid ();
-#endif /* WINDOWSNT */
 
-  /* Note that use of alloca is always safe here.  It's obvious for systems
-     that do not have true vfork or that have true (stack) alloca.
-     If using vfork and C_ALLOCA (when Emacs used to include
-     src/alloca.c) it is safe because that changes the superior's
-     static variables as if the superior had done alloca and will be
-     cleaned up in the usual way. */
   {
     char *temp;
     ptrdiff_t i;
 
     i = SBYTES (current_dir);
-#ifdef MSDOS
-    /* MSDOS must have all environment variables malloc'ed, because
-       low-level libc functions that launch subsidiary processes rely
-       on that.  */
     pwd_var = xmalloc (i + 5);
-#else
-    pwd_var = alloca (i + 5);
-#endif
+    record_unwind_protect_ptr (xfree, pwd_var);
     temp = pwd_var + 4;
     memcpy (pwd_var, "PWD=", 4);
     strcpy (temp, SSDATA (current_dir));
-
-#ifndef DOS_NT
-    /* We can't signal an Elisp error here; we're in a vfork.  Since
-       the callers check the current directory before forking, this
-       should only return an error if the directory's permissions
-       are changed between the check and this chdir, but we should
-       at least check.  */
-    if (chdir (temp) < 0)
-      _exit (EXIT_CANCELED);
-#else /* DOS_NT */
-    /* Get past the drive letter, so that d:/ is left alone.  */
-    if (i > 2 && IS_DEVICE_SEP (temp[1]) && IS_DIRECTORY_SEP (temp[2]))
-      {
-	temp += 2;
-	i -= 2;
-      }
-#endif /* DOS_NT */
-
-    /* Strip trailing slashes for PWD, but leave "/" and "//" alone.  */
-    while (i > 2 && IS_DIRECTORY_SEP (temp[i - 1]))
-      temp[--i] = 0;
+    strip_directory_slashes (temp, i);
   }
 
   /* Set `env' to a vector of the strings in the environment.  */
@@ -1269,7 +1267,8 @@ child_setup (int in, int out, int err, char **new_argv, bool set_pgrp,
       }
 
     /* new_length + 2 to include PWD and terminating 0.  */
-    env = new_env = alloca ((new_length + 2) * sizeof *env);
+    env = new_env = xnmalloc (new_length + 2, sizeof *env);
+    record_unwind_protect_ptr (xfree, env);
     /* If we have a PWD envvar, pass one down,
        but with corrected value.  */
     if (egetenv ("PWD"))
@@ -1277,7 +1276,8 @@ child_setup (int in, int out, int err, char **new_argv, bool set_pgrp,
 
     if (STRINGP (display))
       {
-	char *vdata = alloca (sizeof "DISPLAY=" + SBYTES (display));
+	char *vdata = xmalloc (sizeof "DISPLAY=" + SBYTES (display));
+	record_unwind_protect_ptr (xfree, vdata);
 	strcpy (vdata, "DISPLAY=");
 	strcat (vdata, SSDATA (display));
 	new_env = add_env (env, new_env, vdata);
@@ -1303,6 +1303,45 @@ child_setup (int in, int out, int err, char **new_argv, bool set_pgrp,
       }
   }
 
+  return env;
+}
+
+/* This is the last thing run in a newly forked inferior
+   either synchronous or asynchronous.
+   Copy descriptors IN, OUT and ERR as descriptors 0, 1 and 2.
+   Initialize inferior's priority, pgrp and connected dir,
+   then exec another program based on new_argv with environment ENV,
+   which make_environment_block returned.
+
+   If SET_PGRP, put the subprocess into a separate process group.
+
+   CURRENT_DIR is an elisp string giving the path of the current
+   directory the subprocess should have.  Since we can't really signal
+   a decent error from within the child, this should be verified as an
+   executable directory by the parent.  */
+
+int
+child_setup (int in, int out, int err, char **new_argv, char **env,
+	     bool set_pgrp, Lisp_Object current_dir)
+{
+#ifdef WINDOWSNT
+  int cpid;
+  HANDLE handles[3];
+#else
+  int exec_errno;
+
+  pid_t pid = getpid ();
+#endif /* WINDOWSNT */
+
+#ifndef DOS_NT
+  /* We can't signal an Elisp error here; we're in a vfork.  Since
+     the callers check the current directory before forking, this
+     should only return an error if the directory's permissions
+     are changed between the check and this chdir, but we should
+     at least check.  */
+  if (chdir (SSDATA (current_dir)) < 0)
+    _exit (EXIT_CANCELED);
+#endif /* not DOS_NT */
 
 #ifdef WINDOWSNT
   prepare_standard_handles (in, out, err, handles);
@@ -1364,8 +1403,14 @@ child_setup (int in, int out, int err, char **new_argv, bool set_pgrp,
   _exit (exec_errno == ENOENT ? EXIT_ENOENT : EXIT_CANNOT_INVOKE);
 
 #else /* MSDOS */
-  pid = run_msdos_command (new_argv, pwd_var + 4, in, out, err, env);
-  xfree (pwd_var);
+  {
+    /* Run the command in the directory that PWD names.  */
+    char *dir = xlispstrdup (current_dir);
+
+    strip_directory_slashes (dir, SBYTES (current_dir));
+    pid = run_msdos_command (new_argv, dir, in, out, err, env);
+    xfree (dir);
+  }
   if (pid == -1)
     /* An error occurred while trying to run the subprocess.  */
     report_file_error ("Spawning child process", Qnil);
@@ -1753,6 +1798,16 @@ use.
 See `setenv' and `getenv'.  */);
   Vprocess_environment = Qnil;
 
+  DEFVAR_LISP ("call-process-redisplay-interval",
+	       Vcall_process_redisplay_interval,
+	       doc: /* Minimum number of seconds between redisplays in `call-process'.
+When the DISPLAY argument of `call-process' is non-nil, Emacs updates
+the display after inserting each chunk of output.  If this is a
+positive number, it doesn't update the display more often than that,
+which makes commands that produce a lot of output much faster.
+nil means to update the display after every chunk.  */);
+  Vcall_process_redisplay_interval = Qnil;
+
   defsubr (&Scall_process);
   defsubr (&Sgetenv_internal);
   defsubr (&Scall_process_region);
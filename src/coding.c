@@ -1365,8 +1365,10 @@ decode_coding_utf_8 (struct coding_system *coding)
 	  break;
 	}
 
-      /* In the simple case, rapidly handle ordinary characters */
-      if (multibytep && ! eol_dos
+      /* In the simple case, rapidly handle ordinary characters.
+	 ASCII bytes are the same whether or not the source is
+	 multibyte.  */
+      if (! eol_dos
 	  && charbuf < charbuf_end - 6 && src < src_end - 6)
 	{
 	  while (charbuf < charbuf_end - 6 && src < src_end - 6)
@@ -1048,6 +1048,56 @@ swap_in_global_binding (struct Lisp_Symbol *symbol)
   set_blv_found (blv, 0);
 }
 
+/* A direct-mapped cache of lookups in the buffers' local_var_alists,
+   mapping a buffer and a symbol to the symbol's element of the alist,
+   or to nil if the buffer has no local binding for it.  Without it,
+   every switch of a variable's loaded binding costs an assq, which is
+   slow in buffers with hundreds of local variables.  An entry is
+   valid only while its epoch equals local_var_alist_epoch.  */
+
+#define LOCAL_BINDING_CACHE_SIZE 1024
+
+struct local_binding_cache_entry
+{
+  struct buffer *buffer;
+  Lisp_Object symbol;
+  Lisp_Object binding;
+  EMACS_UINT epoch;
+};
+
+static struct local_binding_cache_entry
+  local_binding_cache[LOCAL_BINDING_CACHE_SIZE];
+
+/* Start at 1 so that the zero-initialized entries above never match.  */
+EMACS_UINT local_var_alist_epoch = 1;
+
+/* List of the variables whose buffer-local bindings forward into C
+   variables, i.e. those made buffer-local after a DEFVAR_LISP,
+   DEFVAR_INT or DEFVAR_BOOL.  */
+Lisp_Object Vforwarded_local_variables;
+
+/* Return the element of B's local_var_alist whose car is SYMBOL,
+   or nil if there is none.  */
+
+Lisp_Object
+local_var_binding (struct buffer *b, Lisp_Object symbol)
+{
+  struct local_binding_cache_entry *entry
+    = &local_binding_cache[(((uintptr_t) b >> 4)
+			    ^ (XHASH (symbol) >> GCTYPEBITS))
+			   % LOCAL_BINDING_CACHE_SIZE];
+
+  if (entry->epoch == local_var_alist_epoch
+      && entry->buffer == b && EQ (entry->symbol, symbol))
+    return entry->binding;
+
+  entry->binding = assq_no_quit (symbol, BVAR (b, local_var_alist));
+  entry->buffer = b;
+  entry->symbol = symbol;
+  entry->epoch = local_var_alist_epoch;
+  return entry->binding;
+}
+
 /* Set up the buffer-local symbol SYMBOL for validity in the current buffer.
    VALCONTENTS is the contents of its value cell,
    which points to a struct Lisp_Buffer_Local_Value.
@@ -1085,7 +1135,7 @@ swap_in_symval_forwarding (struct Lisp_Symbol *symbol, struct Lisp_Buffer_Local_
 	  }
 	else
 	  {
-	    tem1 = assq_no_quit (var, BVAR (current_buffer, local_var_alist));
+	    tem1 = local_var_binding (current_buffer, var);
 	    set_blv_where (blv, Fcurrent_buffer ());
 	  }
       }
@@ -1220,10 +1270,9 @@ set_internal (Lisp_Object symbol, Lisp_Object newval, Lisp_Object where,
 
 	    /* Find the new binding.  */
 	    XSETSYMBOL (symbol, sym); /* May have changed via aliasing.  */
-	    tem1 = Fassq (symbol,
-			  (blv->frame_local
-			   ? XFRAME (where)->param_alist
-			   : BVAR (XBUFFER (where), local_var_alist)));
+	    tem1 = (blv->frame_local
+		    ? Fassq (symbol, XFRAME (where)->param_alist)
+		    : local_var_binding (XBUFFER (where), symbol));
 	    set_blv_where (blv, where);
 	    blv->found = 1;
 
@@ -1515,6 +1564,8 @@ make_blv (struct Lisp_Symbol *sym, bool forwarded,
   eassert (!(forwarded && BUFFER_OBJFWDP (valcontents.fwd)));
   eassert (!(forwarded && KBOARD_OBJFWDP (valcontents.fwd)));
   blv->fwd = forwarded ? valcontents.fwd : NULL;
+  if (forwarded)
+    Vforwarded_local_variables = Fcons (symbol, Vforwarded_local_variables);
   set_blv_where (blv, Qnil);
   blv->frame_local = 0;
   blv->local_if_set = 0;
@@ -1880,23 +1931,18 @@ BUFFER defaults to the current buffer.  */)
     case SYMBOL_PLAINVAL: return Qnil;
     case SYMBOL_LOCALIZED:
       {
-	Lisp_Object tail, elt, tmp;
+	Lisp_Object tmp;
 	struct Lisp_Buffer_Local_Value *blv = SYMBOL_BLV (sym);
 	XSETBUFFER (tmp, buf);
 	XSETSYMBOL (variable, sym); /* Update in case of aliasing.  */
 
 	if (EQ (blv->where, tmp)) /* The binding is already loaded.  */
 	  return blv_found (blv) ? Qt : Qnil;
-	else
-	  for (tail = BVAR (buf, local_var_alist); CONSP (tail); tail = XCDR (tail))
-	    {
-	      elt = XCAR (tail);
-	      if (EQ (variable, XCAR (elt)))
-		{
-		  eassert (!blv->frame_local);
-		  return Qt;
-		}
-	    }
+	else if (!NILP (local_var_binding (buf, variable)))
+	  {
+	    eassert (!blv->frame_local);
+	    return Qt;
+	  }
 	return Qnil;
       }
     case SYMBOL_FORWARDED:
@@ -3097,6 +3143,8 @@ syms_of_data (void)
   staticpro (&Qnil);
   staticpro (&Qt);
   staticpro (&Qunbound);
+  Vforwarded_local_variables = Qnil;
+  staticpro (&Vforwarded_local_variables);
 
   /* Types that type-of returns.  */
   DEFSYM (Qinteger, "integer");
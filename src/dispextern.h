@@ -700,6 +700,10 @@ struct glyph_matrix
   /* Number of elements allocated for the vector rows above.  */
   ptrdiff_t rows_allocated;
 
+  /* Number of glyphs allocated for each row, if the matrix manages
+     its own glyph memory; this can be more than matrix_w.  */
+  ptrdiff_t row_glyphs_allocated;
+
   /* The number of rows used by the window if all lines were displayed
      with the smallest possible character height.  */
   int nrows;
@@ -1762,6 +1766,33 @@ enum face_id
 
 #define MAX_FACE_ID  ((1 << FACE_ID_BITS) - 1)
 
+/* Number of entries in the table remembering the results of
+   face_at_buffer_position, and the maximum number of face
+   specifications merged that an entry can record.  */
+
+#define FACE_MERGE_CACHE_SIZE 64
+#define FACE_MERGE_MAX_PROPS 4
+
+/* An entry of that table.  */
+
+struct face_merge_entry
+{
+  /* ID of the face the specifications were merged into, or -1 if the
+     entry is unused.  */
+  int base_face_id;
+
+  /* The number of specifications merged, and the specifications, in
+     the order in which they were merged.  */
+  int nprops;
+  Lisp_Object props[FACE_MERGE_MAX_PROPS];
+
+  /* Non-zero if the `region' face was merged in last.  */
+  unsigned region_p : 1;
+
+  /* ID of the resulting realized face.  */
+  int face_id;
+};
+
 /* A cache of realized faces.  Each frame has its own cache because
    Emacs allows different frame-local face definitions.  */
 
@@ -1783,6 +1814,10 @@ struct face_cache
   /* Flag indicating that attributes of the `menu' face have been
      changed.  */
   unsigned menu_face_changed_p : 1;
+
+  /* Table of FACE_MERGE_CACHE_SIZE results of face_at_buffer_position,
+     or null if not allocated yet.  */
+  struct face_merge_entry *merge_cache;
 };
 
 
@@ -3154,6 +3189,48 @@ enum tool_bar_item_image
 #define TTY_CAP_DIM		0x08
 #define TTY_CAP_ITALIC  	0x10
 
+
+/***********************************************************************
+			  Redisplay Profiling
+ ***********************************************************************/
+
+/* Parts of redisplay whose duration is recorded while
+   `profile-redisplay' is non-nil.  */
+
+enum redisplay_phase
+{
+  /* Redisplaying a window, i.e. redisplay_window.  */
+  REDISPLAY_PHASE_WINDOW,
+
+  /* Building menu bar and tool-bar items.  */
+  REDISPLAY_PHASE_MENU_BARS,
+
+  /* Formatting mode lines and header lines.  */
+  REDISPLAY_PHASE_MODE_LINES,
+
+  /* Running fontification-functions.  */
+  REDISPLAY_PHASE_FONTIFICATION,
+
+  /* Updating the display from the desired matrices.  */
+  REDISPLAY_PHASE_UPDATE,
+
+  REDISPLAY_N_PHASES
+};
+
+/* Value is the time at which a phase of redisplay starts, if the
+   current redisplay cycle is profiled.  */
+
+#define REDISPLAY_PHASE_START()					\
+  (redisplay_profiling ? current_timespec () : make_timespec (0, 0))
+
+/* Record that window W, or the redisplay cycle if W is null, spent
+   the time since START in PHASE.  */
+
+#define REDISPLAY_PHASE_END(W, PHASE, START)				\
+  (redisplay_profiling							\
+   ? add_redisplay_phase_time ((W), (PHASE), (START))			\
+   : (void) 0)
+
 
 /***********************************************************************
 			  Function Prototypes
@@ -3164,6 +3241,8 @@ enum tool_bar_item_image
 extern void bidi_init_it (ptrdiff_t, ptrdiff_t, bool, struct bidi_it *);
 extern void bidi_move_to_visually_next (struct bidi_it *);
 extern void bidi_paragraph_init (bidi_dir_t, struct bidi_it *, bool);
+extern ptrdiff_t bidi_find_restart_position (ptrdiff_t, ptrdiff_t, ptrdiff_t,
+					     ptrdiff_t *);
 extern int  bidi_mirror_char (int);
 extern void bidi_push_it (struct bidi_it *);
 extern void bidi_pop_it (struct bidi_it *);
@@ -3221,9 +3300,15 @@ extern int help_echo_showing_p;
 extern Lisp_Object help_echo_string, help_echo_window;
 extern Lisp_Object help_echo_object, previous_help_echo_string;
 extern ptrdiff_t help_echo_pos;
+extern struct glyph *mouse_highlight_glyph;
 extern struct frame *last_mouse_frame;
 extern int last_tool_bar_item;
 extern void reseat_at_previous_visible_line_start (struct it *);
+extern ptrdiff_t restore_line_checkpoint (struct it *, ptrdiff_t, ptrdiff_t);
+extern void record_line_checkpoints (struct it *, ptrdiff_t);
+extern bool redisplay_profiling;
+extern void add_redisplay_phase_time (struct window *, enum redisplay_phase,
+				      struct timespec);
 extern Lisp_Object lookup_glyphless_char_display (int, struct it *);
 extern ptrdiff_t compute_display_string_pos (struct text_pos *,
 					     struct bidi_string_data *,
@@ -3489,6 +3574,7 @@ void blank_row (struct window *, struct glyph_row *, int);
 void clear_glyph_matrix_rows (struct glyph_matrix *, int, int);
 void clear_glyph_row (struct glyph_row *);
 void prepare_desired_row (struct glyph_row *);
+bool copy_glyph_row (struct glyph_row *, struct glyph_row *);
 void set_window_update_flags (struct window *, bool);
 void update_single_window (struct window *, bool);
 void do_pending_window_change (bool);
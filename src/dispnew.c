@@ -280,16 +280,63 @@ __executable_start (void)
 			    Glyph Matrices
  ***********************************************************************/
 
+/* Matrices for window-based redisplay manage their own glyph memory.
+   When such a matrix is freed, typically because its window was
+   deleted, up to N_SPARE_MATRICES of them are kept with their rows
+   and glyphs, so that a window created soon afterwards, e.g. by
+   C-x 2 after C-x 1, can use that memory instead of allocating it
+   again.  */
+
+#define N_SPARE_MATRICES 2
+
+static struct glyph_matrix *spare_matrices[N_SPARE_MATRICES];
+static int n_spare_matrices;
+
+
+/* Make MATRIX, which manages its own glyph memory, look like a newly
+   allocated matrix, but keep its rows and their glyph memory.  */
+
+static void
+reset_spare_matrix (struct glyph_matrix *matrix)
+{
+  struct glyph_row *rows = matrix->rows;
+  ptrdiff_t rows_allocated = matrix->rows_allocated;
+  ptrdiff_t row_glyphs_allocated = matrix->row_glyphs_allocated;
+  ptrdiff_t i;
+
+  for (i = 0; i < rows_allocated; ++i)
+    {
+      struct glyph *glyphs = rows[i].glyphs[LEFT_MARGIN_AREA];
+
+      memset (rows + i, 0, sizeof rows[i]);
+      rows[i].glyphs[LEFT_MARGIN_AREA] = rows[i].glyphs[TEXT_AREA]
+	= rows[i].glyphs[RIGHT_MARGIN_AREA] = rows[i].glyphs[LAST_AREA]
+	= glyphs;
+    }
+
+  memset (matrix, 0, sizeof *matrix);
+  matrix->rows = rows;
+  matrix->rows_allocated = rows_allocated;
+  matrix->row_glyphs_allocated = row_glyphs_allocated;
+}
+
+
 /* Allocate and return a glyph_matrix structure.  POOL is the glyph
    pool from which memory for the matrix should be allocated, or null
    for window-based redisplay where no glyph pools are used.  The
    member `pool' of the glyph matrix structure returned is set to
-   POOL, the structure is otherwise zeroed.  */
+   POOL, the structure is otherwise zeroed.  A matrix for window-based
+   redisplay may be a spare one, which has rows already.  */
 
 static struct glyph_matrix *
 new_glyph_matrix (struct glyph_pool *pool)
 {
-  struct glyph_matrix *result = xzalloc (sizeof *result);
+  struct glyph_matrix *result;
+
+  if (pool == NULL && n_spare_matrices > 0)
+    result = spare_matrices[--n_spare_matrices];
+  else
+    result = xzalloc (sizeof *result);
 
 #if defined GLYPH_DEBUG && defined ENABLE_CHECKING
   /* Increment number of allocated matrices.  This count is used
@@ -312,7 +359,8 @@ new_glyph_matrix (struct glyph_pool *pool)
 
    If MATRIX->pool is null, this means that the matrix manages its own
    glyph memory---this is done for matrices on X frames.  Freeing the
-   matrix also frees the glyph memory in this case.  */
+   matrix also frees the glyph memory in this case, unless the matrix
+   is kept as a spare for new_glyph_matrix.  */
 
 static void
 free_glyph_matrix (struct glyph_matrix *matrix)
@@ -328,6 +376,13 @@ free_glyph_matrix (struct glyph_matrix *matrix)
       eassert (glyph_matrix_count >= 0);
 #endif
 
+      if (matrix->pool == NULL && n_spare_matrices < N_SPARE_MATRICES)
+	{
+	  reset_spare_matrix (matrix);
+	  spare_matrices[n_spare_matrices++] = matrix;
+	  return;
+	}
+
       /* Free glyph memory if MATRIX owns it.  */
       if (matrix->pool == NULL)
 	for (i = 0; i < matrix->rows_allocated; ++i)
@@ -510,12 +565,24 @@ adjust_glyph_matrix (struct window *w, struct glyph_matrix *matrix, int x, int y
 	{
 	  struct glyph_row *row = matrix->rows;
 	  struct glyph_row *end = row + matrix->rows_allocated;
+	  bool grow_p = dim.width > matrix->row_glyphs_allocated;
+
+	  /* Grow the glyph memory of rows geometrically, so that a
+	     window being widened a column at a time doesn't reallocate
+	     all of its rows every time.  Keep the memory when the
+	     window gets narrower.  */
+	  if (grow_p)
+	    matrix->row_glyphs_allocated
+	      = max (dim.width, (matrix->row_glyphs_allocated
+				 + matrix->row_glyphs_allocated / 2));
 
 	  while (row < end)
 	    {
-	      row->glyphs[LEFT_MARGIN_AREA]
-		= xnrealloc (row->glyphs[LEFT_MARGIN_AREA],
-			     dim.width, sizeof (struct glyph));
+	      if (grow_p || row->glyphs[LEFT_MARGIN_AREA] == NULL)
+		row->glyphs[LEFT_MARGIN_AREA]
+		  = xnrealloc (row->glyphs[LEFT_MARGIN_AREA],
+			       matrix->row_glyphs_allocated,
+			       sizeof (struct glyph));
 
 	      /* The mode line never has marginal areas.  */
 	      if (row == matrix->rows + dim.height - 1
@@ -1053,6 +1120,31 @@ copy_row_except_pointers (struct glyph_row *to, struct glyph_row *from)
 }
 
 
+/* Copy glyph row FROM to glyph row TO, including its glyphs.  TO
+   keeps its own glyph memory.  Value is false if the glyphs of FROM
+   don't fit into that memory.  */
+
+bool
+copy_glyph_row (struct glyph_row *to, struct glyph_row *from)
+{
+  int area;
+
+  for (area = LEFT_MARGIN_AREA; area < LAST_AREA; ++area)
+    if (from->used[area] > to->glyphs[area + 1] - to->glyphs[area])
+      return 0;
+
+  copy_row_except_pointers (to, from);
+  for (area = LEFT_MARGIN_AREA; area < LAST_AREA; ++area)
+    {
+      memcpy (to->glyphs[area], from->glyphs[area],
+	      from->used[area] * sizeof *from->glyphs[area]);
+      to->used[area] = from->used[area];
+    }
+  to->hash = from->hash;
+  return 1;
+}
+
+
 /* Assign glyph row FROM to glyph row TO.  This works like a structure
    assignment TO = FROM, except that glyph pointers are not copied but
    exchanged between TO and FROM.  Pointers must be exchanged to avoid
@@ -1805,6 +1897,9 @@ adjust_frame_glyphs (struct frame *f)
      glyph matrices are not processed while we are changing them.  */
   block_input ();
 
+  /* The glyph under the mouse may go away.  */
+  mouse_highlight_glyph = NULL;
+
   if (FRAME_WINDOW_P (f))
     adjust_frame_glyphs_for_window_redisplay (f);
   else
@@ -2131,6 +2226,7 @@ free_glyphs (struct frame *f)
          event while we're in an inconsistent state.  */
       block_input ();
       f->glyphs_initialized_p = 0;
+      mouse_highlight_glyph = NULL;
 
       /* Release window sub-matrices.  */
       if (!NILP (f->root_window))
@@ -3014,6 +3110,7 @@ update_frame (struct frame *f, bool force_p, bool inhibit_hairy_id_p)
   /* True means display has been paused because of pending input.  */
   bool paused_p;
   struct window *root_window = XWINDOW (f->root_window);
+  struct timespec start = REDISPLAY_PHASE_START ();
 
   if (redisplay_dont_pause)
     force_p = 1;
@@ -3103,6 +3200,7 @@ update_frame (struct frame *f, bool force_p, bool inhibit_hairy_id_p)
   set_window_update_flags (root_window, 0);
 
   display_completed = !paused_p;
+  REDISPLAY_PHASE_END (NULL, REDISPLAY_PHASE_UPDATE, start);
   return paused_p;
 }
 
@@ -3302,6 +3400,7 @@ update_window (struct window *w, bool force_p)
   bool paused_p;
   int preempt_count = baud_rate / 2400 + 1;
   struct redisplay_interface *rif = FRAME_RIF (XFRAME (WINDOW_FRAME (w)));
+  struct timespec start = REDISPLAY_PHASE_START ();
 #ifdef GLYPH_DEBUG
   /* Check that W's frame doesn't have glyph matrices.  */
   eassert (FRAME_WINDOW_P (XFRAME (WINDOW_FRAME (w))));
@@ -3322,6 +3421,9 @@ update_window (struct window *w, bool force_p)
       bool changed_p = 0, mouse_face_overwritten_p = 0;
       int n_updated = 0;
 
+      /* What the mouse is over may change.  */
+      mouse_highlight_glyph = NULL;
+
       rif->update_window_begin_hook (w);
       yb = window_text_bottom_y (w);
       row = MATRIX_ROW (desired_matrix, 0);
@@ -3465,6 +3567,7 @@ update_window (struct window *w, bool force_p)
 #endif
   clear_glyph_matrix (desired_matrix);
 
+  REDISPLAY_PHASE_END (w, REDISPLAY_PHASE_UPDATE, start);
   return paused_p;
 }
 
@@ -4406,6 +4509,9 @@ update_frame_1 (struct frame *f, bool force_p, bool inhibit_id_p)
 
   eassert (current_matrix && desired_matrix);
 
+  /* What the mouse is over may change.  */
+  mouse_highlight_glyph = NULL;
+
   if (baud_rate != FRAME_COST_BAUD_RATE (f))
     calculate_costs (f);
 
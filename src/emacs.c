@@ -1413,6 +1413,8 @@ Using an Emacs configured with --with-x-toolkit=lucid does not have this problem
       syms_of_xml ();
 #endif
 
+      syms_of_json ();
+
 #ifdef HAVE_ZLIB
       syms_of_decompress ();
 #endif
@@ -76,6 +76,27 @@ Lisp_Object Vrun_hooks;
 
 Lisp_Object Vautoload_queue;
 
+/* A small direct-mapped cache from symbols whose function cell holds
+   another symbol (i.e. aliases made by `defalias') to the function
+   at the end of the chain, so that calls through an alias need not
+   chase it on every call.  An entry is valid only while its epoch
+   equals function_cell_epoch, which set_symbol_function and the
+   garbage collector increment.  */
+
+#define FUNCTION_CACHE_SIZE 256
+
+struct function_cache_entry
+{
+  Lisp_Object symbol;
+  Lisp_Object function;
+  EMACS_UINT epoch;
+};
+
+static struct function_cache_entry function_cache[FUNCTION_CACHE_SIZE];
+
+/* Start at 1 so that the zero-initialized entries above never match.  */
+EMACS_UINT function_cell_epoch = 1;
+
 /* Current number of specbindings allocated in specpdl, not counting
    the dummy entry specpdl[-1].  */
 
@@ -234,6 +255,24 @@ backtrace_next (union specbinding *pdl)
   return pdl;
 }
 
+/* Called by exec_byte_code when it reuses its frame, entered at
+   specpdl depth COUNT, for a call to the same function with the NARGS
+   arguments at ARGS.  Make the backtrace record of the frame describe
+   the new call, and return true; or return false if the frame has no
+   backtrace record of its own.  */
+
+bool
+set_backtrace_tail_call (ptrdiff_t count, Lisp_Object *args, ptrdiff_t nargs)
+{
+  union specbinding *pdl = specpdl + count - 1;
+
+  if (!backtrace_p (pdl) || pdl->kind != SPECPDL_BACKTRACE)
+    return false;
+  set_backtrace_args (pdl, args);
+  set_backtrace_nargs (pdl, nargs);
+  return true;
+}
+
 
 void
 init_eval_once (void)
@@ -2092,6 +2131,25 @@ record_in_backtrace (Lisp_Object function, Lisp_Object *args, ptrdiff_t nargs)
   grow_specpdl ();
 }
 
+/* Return the function at the end of SYMBOL's chain of function
+   indirections, like indirect_function, but consult and fill
+   function_cache first.  */
+
+static Lisp_Object
+cached_indirect_function (Lisp_Object symbol)
+{
+  struct function_cache_entry *entry
+    = &function_cache[(XHASH (symbol) >> GCTYPEBITS) % FUNCTION_CACHE_SIZE];
+
+  if (entry->epoch == function_cell_epoch && EQ (entry->symbol, symbol))
+    return entry->function;
+
+  entry->function = indirect_function (symbol);
+  entry->symbol = symbol;
+  entry->epoch = function_cell_epoch;
+  return entry->function;
+}
+
 /* Eval a sub-expression of the current expression (i.e. in the same
    lexical scope).  */
 Lisp_Object
@@ -2151,7 +2209,7 @@ eval_sub (Lisp_Object form)
   if (!SYMBOLP (fun))
     fun = Ffunction (Fcons (fun, Qnil));
   else if (!NILP (fun) && (fun = XSYMBOL (fun)->function, SYMBOLP (fun)))
-    fun = indirect_function (fun);
+    fun = cached_indirect_function (fun);
 
   if (SUBRP (fun))
     {
@@ -2819,7 +2877,7 @@ usage: (funcall FUNCTION &rest ARGUMENTS)  */)
   fun = original_fun;
   if (SYMBOLP (fun) && !NILP (fun)
       && (fun = XSYMBOL (fun)->function, SYMBOLP (fun)))
-    fun = indirect_function (fun);
+    fun = cached_indirect_function (fun);
 
   if (SUBRP (fun))
     {
@@ -3208,7 +3266,15 @@ specbind (Lisp_Object symbol, Lisp_Object value)
 	if (sym->redirect == SYMBOL_LOCALIZED)
 	  {
 	    if (!blv_found (SYMBOL_BLV (sym)))
-	      specpdl_ptr->let.kind = SPECPDL_LET_DEFAULT;
+	      {
+		/* The default binding is loaded, so set it directly;
+		   set_internal would search the buffer's local
+		   variables again only to find the default binding.  */
+		specpdl_ptr->let.kind = SPECPDL_LET_DEFAULT;
+		grow_specpdl ();
+		Fset_default (symbol, value);
+		return;
+	      }
 	  }
 	else if (BUFFER_OBJFWDP (SYMBOL_FWD (sym)))
 	  {
@@ -3382,11 +3448,24 @@ unbind_to (ptrdiff_t count, Lisp_Object value)
 	    Lisp_Object symbol = specpdl_symbol (specpdl_ptr);
 	    Lisp_Object where = specpdl_where (specpdl_ptr);
 	    Lisp_Object old_value = specpdl_old_value (specpdl_ptr);
+	    struct Lisp_Symbol *sym = XSYMBOL (symbol);
 	    eassert (BUFFERP (where));
 
+	    if (sym->redirect == SYMBOL_LOCALIZED
+		&& !SYMBOL_BLV (sym)->frame_local
+		&& !EQ (SYMBOL_BLV (sym)->where, where))
+	      {
+		/* WHERE's binding is not the loaded one, so update it in
+		   place instead of loading it with set_internal, which
+		   would force yet another swap when the variable is next
+		   referenced in the current buffer.  */
+		Lisp_Object cell = local_var_binding (XBUFFER (where), symbol);
+		if (CONSP (cell))
+		  XSETCDR (cell, old_value);
+	      }
 	    /* If this was a local binding, reset the value in the appropriate
 	       buffer, but only if that buffer's binding still exists.  */
-	    if (!NILP (Flocal_variable_p (symbol, where)))
+	    else if (!NILP (Flocal_variable_p (symbol, where)))
 	      set_internal (symbol, old_value, where, 1);
 	  }
 	  break;
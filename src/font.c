@@ -188,6 +188,7 @@ font_make_object (int size, Lisp_Object entity, int pixelsize)
   int i;
 
   XSETFONT (font_object, font);
+  font->metrics_cache = NULL;
 
   if (! NILP (entity))
     {
@@ -2502,6 +2503,7 @@ static void font_finish_cache (struct frame *, struct font_driver *);
 static Lisp_Object font_get_cache (struct frame *, struct font_driver *);
 static void font_clear_cache (struct frame *, Lisp_Object,
                               struct font_driver *);
+static void font_free_metrics_cache (struct font *);
 
 static void
 font_prepare_cache (struct frame *f, struct font_driver *driver)
@@ -2592,6 +2594,7 @@ font_clear_cache (struct frame *f, Lisp_Object cache, struct font_driver *driver
 			{
 			  eassert (font && driver == font->driver);
 			  driver->close (f, font);
+			  font_free_metrics_cache (font);
 			}
 		    }
 		  if (driver->free_entity)
@@ -2893,6 +2896,7 @@ font_close_object (struct frame *f, Lisp_Object font_object)
     return;
   FONT_ADD_LOG ("close", font_object, Qnil);
   font->driver->close (f, font);
+  font_free_metrics_cache (font);
 #ifdef HAVE_WINDOW_SYSTEM
   eassert (FRAME_DISPLAY_INFO (f)->n_fonts);
   FRAME_DISPLAY_INFO (f)->n_fonts--;
@@ -2900,6 +2904,98 @@ font_close_object (struct frame *f, Lisp_Object font_object)
 }
 
 
+/* Glyph metrics cache.
+
+   Redisplay asks for the metrics of every character it displays, and
+   some font drivers, like ftfont, load the glyph to answer.  So the
+   answers are remembered in a cache attached to the font object,
+   which all faces and frames using the font share.  Metrics of glyph
+   codes below FONT_METRICS_DIRECT_SIZE are kept in a directly indexed
+   table.  Those of other glyph codes are kept in a direct-mapped hash
+   table of FONT_METRICS_HASH_SIZE entries, allocated when first
+   needed.  */
+
+#define FONT_METRICS_DIRECT_SIZE 256
+#define FONT_METRICS_HASH_SIZE 1024
+
+struct font_metrics_entry
+{
+  /* The glyph code whose metrics these are, or FONT_INVALID_CODE.  */
+  unsigned code;
+
+  struct font_metrics metrics;
+};
+
+struct font_metrics_cache
+{
+  struct font_metrics_entry direct[FONT_METRICS_DIRECT_SIZE];
+  struct font_metrics_entry *hashed;
+};
+
+/* Number of lookups in glyph metrics caches that found the metrics,
+   and number of those that had to ask the font driver.  */
+
+static EMACS_INT font_metrics_hits, font_metrics_misses;
+
+static void
+font_free_metrics_cache (struct font *font)
+{
+  if (font->metrics_cache)
+    {
+      xfree (font->metrics_cache->hashed);
+      xfree (font->metrics_cache);
+      font->metrics_cache = NULL;
+    }
+}
+
+/* Return the entry of FONT's metrics cache for glyph code CODE.  */
+
+static struct font_metrics_entry *
+font_metrics_entry (struct font *font, unsigned code)
+{
+  struct font_metrics_cache *cache = font->metrics_cache;
+  int i;
+
+  if (! cache)
+    {
+      cache = font->metrics_cache = xmalloc (sizeof *cache);
+      for (i = 0; i < FONT_METRICS_DIRECT_SIZE; i++)
+	cache->direct[i].code = FONT_INVALID_CODE;
+      cache->hashed = NULL;
+    }
+  if (code < FONT_METRICS_DIRECT_SIZE)
+    return &cache->direct[code];
+  if (! cache->hashed)
+    {
+      cache->hashed = xmalloc (FONT_METRICS_HASH_SIZE
+			       * sizeof *cache->hashed);
+      for (i = 0; i < FONT_METRICS_HASH_SIZE; i++)
+	cache->hashed[i].code = FONT_INVALID_CODE;
+    }
+  return &cache->hashed[(code ^ (code >> 10)) % FONT_METRICS_HASH_SIZE];
+}
+
+/* Store the metrics of glyph CODE of FONT in *METRICS.  CODE must not
+   be FONT_INVALID_CODE.  */
+
+void
+font_glyph_metrics (struct font *font, unsigned code,
+		    struct font_metrics *metrics)
+{
+  struct font_metrics_entry *entry = font_metrics_entry (font, code);
+
+  if (entry->code == code)
+    font_metrics_hits++;
+  else
+    {
+      font_metrics_misses++;
+      font->driver->text_extents (font, &code, 1, &entry->metrics);
+      entry->code = code;
+    }
+  *metrics = entry->metrics;
+}
+
+
 /* Return 1 if FONT on F has a glyph for character C, 0 if not, -1 if
    FONT is a font-entity and it must be opened to check.  */
 
@@ -4273,7 +4369,10 @@ font_fill_lglyph_metrics (Lisp_Object glyph, Lisp_Object font_object)
   struct font_metrics metrics;
 
   LGLYPH_SET_CODE (glyph, code);
-  font->driver->text_extents (font, &code, 1, &metrics);
+  if (code != FONT_INVALID_CODE)
+    font_glyph_metrics (font, code, &metrics);
+  else
+    font->driver->text_extents (font, &code, 1, &metrics);
   LGLYPH_SET_LBEARING (glyph, metrics.lbearing);
   LGLYPH_SET_RBEARING (glyph, metrics.rbearing);
   LGLYPH_SET_WIDTH (glyph, metrics.width);
@@ -4725,7 +4824,7 @@ the corresponding element is nil.  */)
       LGLYPH_SET_TO (g, i);
       LGLYPH_SET_CHAR (g, c);
       LGLYPH_SET_CODE (g, code);
-      font->driver->text_extents (font, &code, 1, &metrics);
+      font_glyph_metrics (font, code, &metrics);
       LGLYPH_SET_WIDTH (g, metrics.width);
       LGLYPH_SET_LBEARING (g, metrics.lbearing);
       LGLYPH_SET_RBEARING (g, metrics.rbearing);
@@ -4821,6 +4920,18 @@ Type C-l to recover what previously shown.  */)
 
 #endif	/* FONT_DEBUG */
 
+DEFUN ("font-metrics-cache-statistics", Ffont_metrics_cache_statistics,
+       Sfont_metrics_cache_statistics, 0, 0, 0,
+       doc: /* Return statistics about the caches of glyph metrics of fonts.
+The value is a list (HITS MISSES).  HITS is the number of times the
+metrics of a glyph were found in the cache of its font, and MISSES the
+number of times they had to be obtained from the font driver.  */)
+  (void)
+{
+  return list2 (make_number (font_metrics_hits),
+		make_number (font_metrics_misses));
+}
+
 #ifdef HAVE_WINDOW_SYSTEM
 
 DEFUN ("font-info", Ffont_info, Sfont_info, 1, 2, 0,
@@ -5112,6 +5223,7 @@ syms_of_font (void)
   defsubr (&Sdraw_string);
 #endif
 #endif	/* FONT_DEBUG */
+  defsubr (&Sfont_metrics_cache_statistics);
 #ifdef HAVE_WINDOW_SYSTEM
   defsubr (&Sfont_info);
 #endif
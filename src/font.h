@@ -385,6 +385,9 @@ struct font
      determine it.  */
   int repertory_charset;
 
+  /* Cache of glyph metrics, see font_glyph_metrics, or NULL.  */
+  struct font_metrics_cache *metrics_cache;
+
   /* There are more members in this structure, but they are private
      to the font-driver.  */
 };
@@ -782,6 +785,8 @@ extern Lisp_Object font_range (ptrdiff_t, ptrdiff_t, ptrdiff_t *,
 			       struct window *, struct face *,
 			       Lisp_Object);
 extern void font_fill_lglyph_metrics (Lisp_Object, Lisp_Object);
+extern void font_glyph_metrics (struct font *, unsigned,
+				struct font_metrics *);
 
 extern Lisp_Object font_put_extra (Lisp_Object font, Lisp_Object prop,
                                    Lisp_Object val);
@@ -2021,17 +2021,26 @@ whether or not it is currently displayed in some window.  */)
       reseat_at_previous_visible_line_start (&it);
       it.current_x = it.hpos = 0;
       if (IT_CHARPOS (it) != PT)
-	/* We used to temporarily disable selective display here; the
-	   comment said this is "so we don't move too far" (2005-01-19
-	   checkin by kfs).  But this does nothing useful that I can
-	   tell, and it causes Bug#2694 .  -- cyd */
-	/* When the position we started from is covered by a display
-	   string, move_it_to will overshoot it, while vertical-motion
-	   wants to put the cursor _before_ the display string.  So in
-	   that case, we move to buffer position before the display
-	   string, and avoid overshooting.  */
-	move_it_to (&it, disp_string_at_start_p ? PT - 1 : PT,
-		    -1, -1, -1, MOVE_TO_POS);
+	{
+	  ptrdiff_t row = -1, count = SPECPDL_INDEX ();
+
+	  /* In a long line, start from a display line close to PT.  */
+	  if (!disp_string_at_start_p)
+	    row = restore_line_checkpoint (&it, PT, 0);
+	  record_line_checkpoints (&it, row);
+	  /* We used to temporarily disable selective display here; the
+	     comment said this is "so we don't move too far" (2005-01-19
+	     checkin by kfs).  But this does nothing useful that I can
+	     tell, and it causes Bug#2694 .  -- cyd */
+	  /* When the position we started from is covered by a display
+	     string, move_it_to will overshoot it, while vertical-motion
+	     wants to put the cursor _before_ the display string.  So in
+	     that case, we move to buffer position before the display
+	     string, and avoid overshooting.  */
+	  move_it_to (&it, disp_string_at_start_p ? PT - 1 : PT,
+		      -1, -1, -1, MOVE_TO_POS);
+	  unbind_to (count, Qnil);
+	}
 
       /* IT may move too far if truncate-lines is on and PT lies
 	 beyond the right margin.  IT may also move too far if the
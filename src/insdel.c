@@ -1028,6 +1028,42 @@ insert_from_gap (ptrdiff_t nchars, ptrdiff_t nbytes, bool text_at_gap_tail)
   check_markers ();
 }
 
+/* Finish an insertion of the text from FROM (FROM_BYTE) to TO
+   (TO_BYTE) that was decoded straight into the gap of the current
+   buffer (see insert_from_gap), so that the result is the same as if
+   insert_before_markers had inserted it at FROM: move the markers that
+   still point at FROM, and point if it is there, after the new text,
+   then run the after-change functions.  The caller must have called
+   prepare_to_modify_buffer for FROM before inserting the text.  */
+
+void
+finish_insert_before_markers (ptrdiff_t from, ptrdiff_t from_byte,
+			      ptrdiff_t to, ptrdiff_t to_byte)
+{
+  struct Lisp_Marker *m;
+
+  if (from == to)
+    return;
+
+  for (m = BUF_MARKERS (current_buffer); m; m = m->next)
+    if (m->bytepos == from_byte)
+      {
+	m->bytepos = to_byte;
+	m->charpos = to;
+      }
+
+  CHARS_MODIFF = MODIFF;
+  if (Z - to < END_UNCHANGED)
+    END_UNCHANGED = Z - to;
+  if (PT == from)
+    adjust_point (to - from, to_byte - from_byte);
+
+  check_markers ();
+
+  signal_after_change (from, 0, to - from);
+  update_compositions (from, to, CHECK_BORDER);
+}
+
 /* Insert text from BUF, NCHARS characters starting at CHARPOS, into the
    current buffer.  If the text in BUF has properties, they are absorbed
    into the current buffer.
@@ -0,0 +1,1153 @@
+/* JSON parsing and serialization.
+   Copyright (C) 2013 Free Software Foundation, Inc.
+
+This file is part of GNU Emacs.
+
+GNU Emacs is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+GNU Emacs is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.  */
+
+/* This file implements RFC 7159 JSON without any external library.
+   The parser works on the text of a string or buffer in place and
+   builds Lisp objects directly: arrays and objects collect their
+   elements on a value stack first, so that each vector or hash table
+   is allocated once, at its final size.  Nothing here runs Lisp code,
+   so no garbage collection can happen while parsing; that is what
+   makes it safe to keep Lisp objects in the malloc'ed value stack and
+   to point into string and buffer text.  */
+
+#include <config.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <c-ctype.h>
+#include <ftoastr.h>
+
+#include "lisp.h"
+#include "character.h"
+#include "buffer.h"
+#include "composite.h"
+
+/* Arrays and objects may nest this deep, as in the Jansson library.
+   This bounds the C stack used by the recursive parser and printer.  */
+enum { JSON_MAX_DEPTH = 2048 };
+
+static Lisp_Object Qjson_error, Qjson_parse_error, Qjson_end_of_file;
+static Lisp_Object Qjson_trailing_content, Qjson_object_too_deep;
+static Lisp_Object Qjson_value_p, Qutf_8_string_p;
+static Lisp_Object QCobject_type, QCarray_type, QCnull_object, QCfalse_object;
+static Lisp_Object QCnull, QCfalse;
+static Lisp_Object Qhash_table, Qalist, Qplist, Qarray, Qlist;
+
+enum json_object_type
+  {
+    json_object_hashtable,
+    json_object_alist,
+    json_object_plist
+  };
+
+enum json_array_type
+  {
+    json_array_array,
+    json_array_list
+  };
+
+struct json_configuration
+{
+  enum json_object_type object_type;
+  enum json_array_type array_type;
+  Lisp_Object null_object;
+  Lisp_Object false_object;
+};
+
+/* Fill in CONF from the keyword arguments ARGS (NARGS of them).  If
+   PARSE is false, only the keywords that json-serialize accepts are
+   allowed.  */
+
+static void
+json_parse_args (ptrdiff_t nargs, Lisp_Object *args,
+		 struct json_configuration *conf, bool parse)
+{
+  ptrdiff_t i;
+
+  conf->object_type = json_object_hashtable;
+  conf->array_type = json_array_array;
+  conf->null_object = QCnull;
+  conf->false_object = QCfalse;
+
+  if (nargs % 2 != 0)
+    signal_error ("Odd number of arguments to JSON function",
+		  Flist (nargs, args));
+
+  for (i = 0; i < nargs; i += 2)
+    {
+      Lisp_Object key = args[i];
+      Lisp_Object value = args[i + 1];
+
+      if (parse && EQ (key, QCobject_type))
+	{
+	  if (EQ (value, Qhash_table))
+	    conf->object_type = json_object_hashtable;
+	  else if (EQ (value, Qalist))
+	    conf->object_type = json_object_alist;
+	  else if (EQ (value, Qplist))
+	    conf->object_type = json_object_plist;
+	  else
+	    signal_error ("Invalid JSON object type", value);
+	}
+      else if (parse && EQ (key, QCarray_type))
+	{
+	  if (EQ (value, Qarray))
+	    conf->array_type = json_array_array;
+	  else if (EQ (value, Qlist))
+	    conf->array_type = json_array_list;
+	  else
+	    signal_error ("Invalid JSON array type", value);
+	}
+      else if (EQ (key, QCnull_object))
+	conf->null_object = value;
+      else if (EQ (key, QCfalse_object))
+	conf->false_object = value;
+      else
+	signal_error ("Invalid keyword argument to JSON function", key);
+    }
+}
+
+/* If the LEN bytes at P start with a valid UTF-8 sequence for a
+   Unicode scalar value, return its length; otherwise return 0.
+   Since the internal representation of such characters is UTF-8 too,
+   this also accepts exactly the multibyte text that can be written
+   out as JSON.  */
+
+static int
+json_utf_8_length (const unsigned char *p, ptrdiff_t len)
+{
+  int c = p[0];
+
+  if (c < 0x80)
+    return 1;
+  if (c < 0xC2)
+    return 0;
+  if (c < 0xE0)
+    return len >= 2 && (p[1] & 0xC0) == 0x80 ? 2 : 0;
+  if (c < 0xF0)
+    {
+      if (len < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80)
+	return 0;
+      /* Reject overlong forms and surrogates.  */
+      if ((c == 0xE0 && p[1] < 0xA0) || (c == 0xED && p[1] >= 0xA0))
+	return 0;
+      return 3;
+    }
+  if (c < 0xF5)
+    {
+      if (len < 4 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80
+	  || (p[3] & 0xC0) != 0x80)
+	return 0;
+      /* Reject overlong forms and characters beyond U+10FFFF.  */
+      if ((c == 0xF0 && p[1] < 0x90) || (c == 0xF4 && p[1] >= 0x90))
+	return 0;
+      return 4;
+    }
+  return 0;
+}
+
+
+/* Parsing.  */
+
+struct json_parser
+{
+  /* The text being parsed, and how far we got in it.  */
+  const unsigned char *begin, *cur, *end;
+
+  struct json_configuration conf;
+
+  /* Number of arrays and objects we are in.  */
+  int depth;
+
+  /* Scratch space for strings with escapes, and for numbers.  */
+  unsigned char *scratch;
+  ptrdiff_t scratch_size, scratch_used;
+
+  /* Elements of the arrays and objects being parsed.  */
+  Lisp_Object *stack;
+  ptrdiff_t stack_size, stack_used;
+
+  /* The string being parsed, or nil for the current buffer.  */
+  Lisp_Object source;
+  /* Whether the source text is multibyte.  */
+  bool multibyte;
+};
+
+static void
+json_free_parser (void *arg)
+{
+  struct json_parser *parser = arg;
+  xfree (parser->scratch);
+  xfree (parser->stack);
+}
+
+static void
+json_init_parser (struct json_parser *parser, Lisp_Object source,
+		  const unsigned char *begin, ptrdiff_t nbytes,
+		  bool multibyte, struct json_configuration *conf)
+{
+  parser->begin = parser->cur = begin;
+  parser->end = begin + nbytes;
+  parser->conf = *conf;
+  parser->depth = 0;
+  parser->scratch = NULL;
+  parser->scratch_size = parser->scratch_used = 0;
+  parser->stack = NULL;
+  parser->stack_size = parser->stack_used = 0;
+  parser->source = source;
+  parser->multibyte = multibyte;
+  record_unwind_protect_ptr (json_free_parser, parser);
+}
+
+/* Signal ERROR, with MESSAGE and the position of the parser as data.
+   The position is a buffer position when parsing a buffer, and an
+   index into the string when parsing a string.  */
+
+static _Noreturn void
+json_signal_error (struct json_parser *parser, Lisp_Object error,
+		   const char *message)
+{
+  ptrdiff_t offset = parser->cur - parser->begin;
+  ptrdiff_t pos;
+
+  if (NILP (parser->source))
+    pos = BYTE_TO_CHAR (PT_BYTE + offset);
+  else
+    pos = (parser->multibyte
+	   ? multibyte_chars_in_text (parser->begin, offset) : offset);
+  xsignal2 (error, build_string (message), make_number (pos));
+}
+
+/* Signal a parse error with MESSAGE, or an end-of-file error if the
+   parser has run out of input.  */
+
+static _Noreturn void
+json_parse_error (struct json_parser *parser, const char *message)
+{
+  if (parser->cur >= parser->end)
+    json_signal_error (parser, Qjson_end_of_file, "Unexpected end of input");
+  json_signal_error (parser, Qjson_parse_error, message);
+}
+
+static void
+json_skip_whitespace (struct json_parser *parser)
+{
+  while (parser->cur < parser->end
+	 && (*parser->cur == ' ' || *parser->cur == '\t'
+	     || *parser->cur == '\n' || *parser->cur == '\r'))
+    parser->cur++;
+}
+
+/* Skip whitespace, then return the next byte of input without
+   consuming it.  */
+
+static int
+json_peek (struct json_parser *parser)
+{
+  json_skip_whitespace (parser);
+  if (parser->cur >= parser->end)
+    json_parse_error (parser, NULL);
+  return *parser->cur;
+}
+
+static void
+json_scratch_append (struct json_parser *parser, const unsigned char *p,
+		     ptrdiff_t n)
+{
+  if (parser->scratch_size - parser->scratch_used < n)
+    parser->scratch = xpalloc (parser->scratch, &parser->scratch_size,
+			       n - (parser->scratch_size
+				    - parser->scratch_used),
+			       -1, 1);
+  memcpy (parser->scratch + parser->scratch_used, p, n);
+  parser->scratch_used += n;
+}
+
+static void
+json_push (struct json_parser *parser, Lisp_Object value)
+{
+  if (parser->stack_used == parser->stack_size)
+    parser->stack = xpalloc (parser->stack, &parser->stack_size, 1, -1,
+			     sizeof *parser->stack);
+  parser->stack[parser->stack_used++] = value;
+}
+
+/* Parse four hex digits of a \u escape.  */
+
+static int
+json_parse_hex4 (struct json_parser *parser)
+{
+  int i, c = 0;
+
+  if (parser->end - parser->cur < 4)
+    {
+      parser->cur = parser->end;
+      json_parse_error (parser, NULL);
+    }
+  for (i = 0; i < 4; i++)
+    {
+      int d = *parser->cur;
+      if (! c_isxdigit (d))
+	json_parse_error (parser, "Invalid \\u escape");
+      c = 16 * c + (c_isdigit (d) ? d - '0' : c_tolower (d) - 'a' + 10);
+      parser->cur++;
+    }
+  return c;
+}
+
+/* Parse the rest of a JSON string, whose opening quote has just been
+   consumed.  Set *TEXT to its UTF-8 text, which either lies in the
+   input or at the start of the parser's scratch space, and *NBYTES to
+   the length of that.  Return the number of characters.  */
+
+static ptrdiff_t
+json_scan_string (struct json_parser *parser, const unsigned char **text,
+		  ptrdiff_t *nbytes)
+{
+  const unsigned char *start = parser->cur;
+  /* Start of the input not yet copied to scratch space.  */
+  const unsigned char *run = start;
+  ptrdiff_t nchars = 0;
+  bool escaped = false;
+
+  parser->scratch_used = 0;
+  for (;;)
+    {
+      int c;
+
+      if (parser->cur >= parser->end)
+	json_parse_error (parser, NULL);
+      c = *parser->cur;
+      if (c == '"')
+	break;
+      if (c < 0x20)
+	json_parse_error (parser, "Control character in string");
+      if (c == '\\')
+	{
+	  unsigned char buf[MAX_MULTIBYTE_LENGTH];
+	  int len;
+
+	  json_scratch_append (parser, run, parser->cur - run);
+	  escaped = true;
+	  parser->cur++;
+	  if (parser->cur >= parser->end)
+	    json_parse_error (parser, NULL);
+	  switch (*parser->cur++)
+	    {
+	    case '"':  c = '"'; break;
+	    case '\\': c = '\\'; break;
+	    case '/':  c = '/'; break;
+	    case 'b':  c = '\b'; break;
+	    case 'f':  c = '\f'; break;
+	    case 'n':  c = '\n'; break;
+	    case 'r':  c = '\r'; break;
+	    case 't':  c = '\t'; break;
+	    case 'u':
+	      c = json_parse_hex4 (parser);
+	      if (0xDC00 <= c && c <= 0xDFFF)
+		json_parse_error (parser, "Invalid \\u escape");
+	      if (0xD800 <= c && c <= 0xDBFF)
+		{
+		  int lo;
+		  if (! (parser->end - parser->cur >= 2
+			 && parser->cur[0] == '\\' && parser->cur[1] == 'u'))
+		    json_parse_error (parser, "Invalid \\u escape");
+		  parser->cur += 2;
+		  lo = json_parse_hex4 (parser);
+		  if (! (0xDC00 <= lo && lo <= 0xDFFF))
+		    json_parse_error (parser, "Invalid \\u escape");
+		  c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+		}
+	      break;
+	    default:
+	      parser->cur--;
+	      json_parse_error (parser, "Invalid escape sequence");
+	    }
+	  len = CHAR_STRING (c, buf);
+	  json_scratch_append (parser, buf, len);
+	  run = parser->cur;
+	}
+      else if (c < 0x80)
+	parser->cur++;
+      else
+	{
+	  int len = json_utf_8_length (parser->cur,
+				       parser->end - parser->cur);
+	  if (len == 0)
+	    json_parse_error (parser, "Invalid UTF-8");
+	  parser->cur += len;
+	}
+      nchars++;
+    }
+
+  if (escaped)
+    {
+      json_scratch_append (parser, run, parser->cur - run);
+      *text = parser->scratch;
+      *nbytes = parser->scratch_used;
+    }
+  else
+    {
+      *text = start;
+      *nbytes = parser->cur - start;
+    }
+  parser->cur++;
+  return nchars;
+}
+
+static Lisp_Object
+json_parse_string (struct json_parser *parser)
+{
+  const unsigned char *text;
+  ptrdiff_t nbytes;
+  ptrdiff_t nchars = json_scan_string (parser, &text, &nbytes);
+  return make_specified_string ((const char *) text, nchars, nbytes,
+				nchars != nbytes);
+}
+
+/* Parse an object key, and return it as a Lisp object of the kind
+   the parser's object type wants.  */
+
+static Lisp_Object
+json_parse_key (struct json_parser *parser)
+{
+  const unsigned char *text;
+  ptrdiff_t nbytes, nchars;
+
+  if (json_peek (parser) != '"')
+    json_parse_error (parser, "Expected an object key");
+  parser->cur++;
+  nchars = json_scan_string (parser, &text, &nbytes);
+
+  switch (parser->conf.object_type)
+    {
+    case json_object_hashtable:
+      return make_specified_string ((const char *) text, nchars, nbytes,
+				    nchars != nbytes);
+
+    case json_object_plist:
+      {
+	/* Make a keyword: put a colon in front of the text.  */
+	static unsigned char const colon[] = ":";
+	if (text == parser->scratch)
+	  {
+	    json_scratch_append (parser, colon, 1);
+	    memmove (parser->scratch + 1, parser->scratch, nbytes);
+	    parser->scratch[0] = ':';
+	  }
+	else
+	  {
+	    parser->scratch_used = 0;
+	    json_scratch_append (parser, colon, 1);
+	    json_scratch_append (parser, text, nbytes);
+	  }
+	text = parser->scratch;
+	nbytes++;
+      }
+      /* Fall through.  */
+    default:
+      return intern_1 ((const char *) text, nbytes);
+    }
+}
+
+static Lisp_Object
+json_parse_number (struct json_parser *parser)
+{
+  const unsigned char *start = parser->cur;
+  const unsigned char *p = start;
+  const unsigned char *end = parser->end;
+  bool negative = false, integer = true;
+  EMACS_INT n = 0;
+
+  if (p < end && *p == '-')
+    {
+      negative = true;
+      p++;
+    }
+  if (p < end && *p == '0')
+    p++;
+  else if (p < end && c_isdigit (*p))
+    for (; p < end && c_isdigit (*p); p++)
+      {
+	if (integer
+	    && n <= (MOST_POSITIVE_FIXNUM - (*p - '0')) / 10)
+	  n = 10 * n + (*p - '0');
+	else
+	  integer = false;
+      }
+  else
+    {
+      parser->cur = p;
+      json_parse_error (parser, "Invalid number");
+    }
+
+  if (p < end && *p == '.')
+    {
+      p++;
+      integer = false;
+      if (! (p < end && c_isdigit (*p)))
+	{
+	  parser->cur = p;
+	  json_parse_error (parser, "Invalid number");
+	}
+      while (p < end && c_isdigit (*p))
+	p++;
+    }
+  if (p < end && (*p == 'e' || *p == 'E'))
+    {
+      p++;
+      integer = false;
+      if (p < end && (*p == '+' || *p == '-'))
+	p++;
+      if (! (p < end && c_isdigit (*p)))
+	{
+	  parser->cur = p;
+	  json_parse_error (parser, "Invalid number");
+	}
+      while (p < end && c_isdigit (*p))
+	p++;
+    }
+  parser->cur = p;
+
+  if (integer)
+    return make_number (negative ? -n : n);
+  else
+    {
+      /* Integers too big for a fixnum become floats, as in json.el.  */
+      static unsigned char const nul[] = "";
+      parser->scratch_used = 0;
+      json_scratch_append (parser, start, p - start);
+      json_scratch_append (parser, nul, 1);
+      return make_float (strtod ((char *) parser->scratch, NULL));
+    }
+}
+
+/* Consume the literal WORD, whose first byte has been seen.  */
+
+static void
+json_parse_literal (struct json_parser *parser, const char *word)
+{
+  ptrdiff_t len = strlen (word);
+  if (parser->end - parser->cur < len
+      || memcmp (parser->cur, word, len) != 0)
+    json_parse_error (parser, "Invalid literal");
+  parser->cur += len;
+}
+
+static Lisp_Object json_parse_value (struct json_parser *);
+
+static Lisp_Object
+json_parse_array (struct json_parser *parser)
+{
+  ptrdiff_t base = parser->stack_used;
+  ptrdiff_t n, i;
+  Lisp_Object result;
+
+  if (json_peek (parser) == ']')
+    parser->cur++;
+  else
+    for (;;)
+      {
+	int c;
+	json_push (parser, json_parse_value (parser));
+	c = json_peek (parser);
+	parser->cur++;
+	if (c == ']')
+	  break;
+	if (c != ',')
+	  {
+	    parser->cur--;
+	    json_parse_error (parser, "Expected `,' or `]'");
+	  }
+      }
+
+  n = parser->stack_used - base;
+  if (parser->conf.array_type == json_array_array)
+    {
+      result = make_uninit_vector (n);
+      for (i = 0; i < n; i++)
+	ASET (result, i, parser->stack[base + i]);
+    }
+  else
+    {
+      result = Qnil;
+      for (i = n - 1; i >= 0; i--)
+	result = Fcons (parser->stack[base + i], result);
+    }
+  parser->stack_used = base;
+  return result;
+}
+
+static Lisp_Object
+json_parse_object (struct json_parser *parser)
+{
+  ptrdiff_t base = parser->stack_used;
+  ptrdiff_t n, i;
+  Lisp_Object result;
+
+  if (json_peek (parser) == '}')
+    parser->cur++;
+  else
+    for (;;)
+      {
+	int c;
+	json_push (parser, json_parse_key (parser));
+	if (json_peek (parser) != ':')
+	  json_parse_error (parser, "Expected `:'");
+	parser->cur++;
+	json_push (parser, json_parse_value (parser));
+	c = json_peek (parser);
+	parser->cur++;
+	if (c == '}')
+	  break;
+	if (c != ',')
+	  {
+	    parser->cur--;
+	    json_parse_error (parser, "Expected `,' or `}'");
+	  }
+      }
+
+  n = (parser->stack_used - base) / 2;
+  switch (parser->conf.object_type)
+    {
+    case json_object_hashtable:
+      {
+	struct Lisp_Hash_Table *h;
+	result = make_hash_table (hashtest_equal, make_number (n),
+				  make_float (DEFAULT_REHASH_SIZE),
+				  make_float (DEFAULT_REHASH_THRESHOLD),
+				  Qnil);
+	h = XHASH_TABLE (result);
+	for (i = 0; i < n; i++)
+	  {
+	    Lisp_Object key = parser->stack[base + 2 * i];
+	    Lisp_Object value = parser->stack[base + 2 * i + 1];
+	    EMACS_UINT hash;
+	    ptrdiff_t j = hash_lookup (h, key, &hash);
+	    /* The last of several equal keys wins.  */
+	    if (j >= 0)
+	      set_hash_value_slot (h, j, value);
+	    else
+	      hash_put (h, key, value, hash);
+	  }
+      }
+      break;
+
+    case json_object_alist:
+      result = Qnil;
+      for (i = n - 1; i >= 0; i--)
+	result = Fcons (Fcons (parser->stack[base + 2 * i],
+			       parser->stack[base + 2 * i + 1]),
+			result);
+      break;
+
+    default:
+      result = Qnil;
+      for (i = n - 1; i >= 0; i--)
+	result = Fcons (parser->stack[base + 2 * i],
+			Fcons (parser->stack[base + 2 * i + 1], result));
+      break;
+    }
+  parser->stack_used = base;
+  return result;
+}
+
+static Lisp_Object
+json_parse_value (struct json_parser *parser)
+{
+  Lisp_Object result;
+
+  switch (json_peek (parser))
+    {
+    case '{':
+    case '[':
+      if (parser->depth == JSON_MAX_DEPTH)
+	json_signal_error (parser, Qjson_object_too_deep,
+			   "Arrays and objects nested too deeply");
+      parser->depth++;
+      result = (*parser->cur++ == '{'
+		? json_parse_object (parser) : json_parse_array (parser));
+      parser->depth--;
+      return result;
+
+    case '"':
+      parser->cur++;
+      return json_parse_string (parser);
+
+    case 't':
+      json_parse_literal (parser, "true");
+      return Qt;
+
+    case 'f':
+      json_parse_literal (parser, "false");
+      return parser->conf.false_object;
+
+    case 'n':
+      json_parse_literal (parser, "null");
+      return parser->conf.null_object;
+
+    case '-': case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+      return json_parse_number (parser);
+
+    default:
+      json_parse_error (parser, "Unexpected character");
+    }
+}
+
+DEFUN ("json-parse-string", Fjson_parse_string, Sjson_parse_string,
+       1, MANY, 0,
+       doc: /* Parse the JSON text in STRING and return the Lisp object for it.
+STRING must contain exactly one JSON value, optionally surrounded by
+whitespace.  A unibyte STRING is taken to be UTF-8 text.
+
+JSON strings become Lisp strings, numbers become integers or floats,
+and `true' becomes t.  The other values depend on the keyword arguments
+ARGS:
+
+:object-type says what objects become: `hash-table' (the default)
+means hash tables with string keys and `equal' as their test, `alist'
+means alists with symbol keys, and `plist' means plists with keyword
+keys.
+
+:array-type says what arrays become: `array' (the default) means
+vectors, `list' means lists.
+
+:null-object is what `null' becomes; the default is the keyword `:null'.
+
+:false-object is what `false' becomes; the default is the keyword
+`:false'.
+
+Signal a `json-parse-error' (or one of its more specific children,
+`json-end-of-file', `json-trailing-content' and `json-object-too-deep')
+if STRING is not valid JSON.  The error data are a message and the
+index in STRING where the problem was found.
+
+usage: (json-parse-string STRING &rest ARGS) */)
+  (ptrdiff_t nargs, Lisp_Object *args)
+{
+  ptrdiff_t count = SPECPDL_INDEX ();
+  Lisp_Object string = args[0];
+  struct json_configuration conf;
+  struct json_parser parser;
+  Lisp_Object value;
+
+  CHECK_STRING (string);
+  json_parse_args (nargs - 1, args + 1, &conf, true);
+  json_init_parser (&parser, string, SDATA (string), SBYTES (string),
+		    STRING_MULTIBYTE (string), &conf);
+
+  value = json_parse_value (&parser);
+  json_skip_whitespace (&parser);
+  if (parser.cur < parser.end)
+    json_signal_error (&parser, Qjson_trailing_content,
+		       "Trailing content after JSON value");
+  return unbind_to (count, value);
+}
+
+DEFUN ("json-parse-buffer", Fjson_parse_buffer, Sjson_parse_buffer,
+       0, MANY, 0,
+       doc: /* Parse the JSON value after point, and move point past it.
+Return the Lisp object for the value.  Text after it is left alone.
+The text of a unibyte buffer is taken to be UTF-8.
+
+ARGS are the same keyword arguments as for `json-parse-string', which
+see.  Errors are signaled the same way too, but report buffer
+positions.
+
+usage: (json-parse-buffer &rest ARGS) */)
+  (ptrdiff_t nargs, Lisp_Object *args)
+{
+  ptrdiff_t count = SPECPDL_INDEX ();
+  struct json_configuration conf;
+  struct json_parser parser;
+  Lisp_Object value;
+  ptrdiff_t byte;
+
+  json_parse_args (nargs, args, &conf, true);
+
+  /* Make the text after point contiguous, moving as little of it as
+     possible.  */
+  if (PT < GPT && GPT < ZV)
+    {
+      if (GPT - PT < ZV - GPT)
+	move_gap_both (PT, PT_BYTE);
+      else
+	move_gap_both (ZV, ZV_BYTE);
+    }
+
+  json_init_parser (&parser, Qnil, PT_ADDR, ZV_BYTE - PT_BYTE,
+		    !NILP (BVAR (current_buffer,
+				 enable_multibyte_characters)),
+		    &conf);
+  value = json_parse_value (&parser);
+
+  byte = PT_BYTE + (parser.cur - parser.begin);
+  SET_PT_BOTH (BYTE_TO_CHAR (byte), byte);
+  return unbind_to (count, value);
+}
+
+
+/* Serialization.  */
+
+struct json_printer
+{
+  /* The JSON text produced so far.  */
+  unsigned char *buf;
+  ptrdiff_t size, used;
+
+  struct json_configuration conf;
+
+  /* Number of arrays and objects we are in.  */
+  int depth;
+};
+
+static void
+json_free_printer (void *arg)
+{
+  struct json_printer *printer = arg;
+  xfree (printer->buf);
+}
+
+static void
+json_out (struct json_printer *printer, const void *p, ptrdiff_t n)
+{
+  if (printer->size - printer->used < n)
+    printer->buf = xpalloc (printer->buf, &printer->size,
+			    n - (printer->size - printer->used), -1, 1);
+  memcpy (printer->buf + printer->used, p, n);
+  printer->used += n;
+}
+
+static void
+json_out_c_string (struct json_printer *printer, const char *s)
+{
+  json_out (printer, s, strlen (s));
+}
+
+/* Write out the LEN bytes of Lisp string text at P as a JSON string.
+   OBJECT is the Lisp object they come from, for error messages.  */
+
+static void
+json_out_text (struct json_printer *printer, const unsigned char *p,
+	       ptrdiff_t len, Lisp_Object object)
+{
+  const unsigned char *end = p + len;
+
+  json_out (printer, "\"", 1);
+  while (p < end)
+    {
+      /* Copy runs of bytes that need no escaping at once.  */
+      const unsigned char *run = p;
+      while (p < end && *p >= 0x20 && *p != '"' && *p != '\\')
+	{
+	  int n = json_utf_8_length (p, end - p);
+	  if (n == 0)
+	    wrong_type_argument (Qutf_8_string_p, object);
+	  p += n;
+	}
+      json_out (printer, run, p - run);
+
+      if (p < end)
+	{
+	  char esc[7];
+	  int c = *p++;
+	  switch (c)
+	    {
+	    case '"':  strcpy (esc, "\\\""); break;
+	    case '\\': strcpy (esc, "\\\\"); break;
+	    case '\b': strcpy (esc, "\\b"); break;
+	    case '\f': strcpy (esc, "\\f"); break;
+	    case '\n': strcpy (esc, "\\n"); break;
+	    case '\r': strcpy (esc, "\\r"); break;
+	    case '\t': strcpy (esc, "\\t"); break;
+	    default:   sprintf (esc, "\\u%04x", c); break;
+	    }
+	  json_out_c_string (printer, esc);
+	}
+    }
+  json_out (printer, "\"", 1);
+}
+
+static void
+json_out_string (struct json_printer *printer, Lisp_Object string)
+{
+  json_out_text (printer, SDATA (string), SBYTES (string), string);
+}
+
+/* Write out KEY as an object key.  Symbols stand for their names; if
+   STRIP_COLON, keywords stand for their names without the colon.  */
+
+static void
+json_out_key (struct json_printer *printer, Lisp_Object key,
+	      bool strip_colon)
+{
+  if (SYMBOLP (key))
+    {
+      Lisp_Object name = SYMBOL_NAME (key);
+      ptrdiff_t skip = (strip_colon && SBYTES (name) > 0
+			&& SREF (name, 0) == ':');
+      json_out_text (printer, SDATA (name) + skip, SBYTES (name) - skip,
+		     name);
+    }
+  else if (STRINGP (key))
+    json_out_string (printer, key);
+  else
+    wrong_type_argument (Qsymbolp, key);
+  json_out (printer, ":", 1);
+}
+
+static void json_out_value (struct json_printer *, Lisp_Object);
+
+static void
+json_out_list (struct json_printer *printer, Lisp_Object list)
+{
+  bool alist = CONSP (XCAR (list));
+  bool first = true;
+  Lisp_Object tail = list;
+
+  json_out (printer, "{", 1);
+  while (CONSP (tail))
+    {
+      QUIT;
+      if (!first)
+	json_out (printer, ",", 1);
+      first = false;
+      if (alist)
+	{
+	  Lisp_Object pair = XCAR (tail);
+	  CHECK_CONS (pair);
+	  json_out_key (printer, XCAR (pair), false);
+	  json_out_value (printer, XCDR (pair));
+	  tail = XCDR (tail);
+	}
+      else
+	{
+	  json_out_key (printer, XCAR (tail), true);
+	  tail = XCDR (tail);
+	  CHECK_CONS (tail);
+	  json_out_value (printer, XCAR (tail));
+	  tail = XCDR (tail);
+	}
+    }
+  if (!NILP (tail))
+    wrong_type_argument (Qlistp, list);
+  json_out (printer, "}", 1);
+}
+
+static void
+json_out_value (struct json_printer *printer, Lisp_Object object)
+{
+  if (EQ (object, printer->conf.null_object))
+    json_out_c_string (printer, "null");
+  else if (EQ (object, printer->conf.false_object))
+    json_out_c_string (printer, "false");
+  else if (EQ (object, Qt))
+    json_out_c_string (printer, "true");
+  else if (INTEGERP (object))
+    {
+      char buf[INT_BUFSIZE_BOUND (EMACS_INT)];
+      json_out (printer, buf, sprintf (buf, "%"pI"d", XINT (object)));
+    }
+  else if (FLOATP (object))
+    {
+      char buf[DBL_BUFSIZE_BOUND + 2];
+      double d = XFLOAT_DATA (object);
+      int len;
+      if (! isfinite (d))
+	wrong_type_argument (Qjson_value_p, object);
+      len = dtoastr (buf, sizeof buf - 2, 0, 0, d);
+      /* Keep floats floats when they are read back.  */
+      if (! strpbrk (buf, ".e"))
+	{
+	  strcpy (buf + len, ".0");
+	  len += 2;
+	}
+      json_out (printer, buf, len);
+    }
+  else if (STRINGP (object))
+    json_out_string (printer, object);
+  else if (NILP (object))
+    json_out_c_string (printer, "{}");
+  else if (VECTORP (object) || HASH_TABLE_P (object) || CONSP (object))
+    {
+      if (printer->depth == JSON_MAX_DEPTH)
+	xsignal1 (Qjson_object_too_deep, object);
+      printer->depth++;
+      if (VECTORP (object))
+	{
+	  ptrdiff_t i;
+	  json_out (printer, "[", 1);
+	  for (i = 0; i < ASIZE (object); i++)
+	    {
+	      if (i > 0)
+		json_out (printer, ",", 1);
+	      json_out_value (printer, AREF (object, i));
+	    }
+	  json_out (printer, "]", 1);
+	}
+      else if (HASH_TABLE_P (object))
+	{
+	  struct Lisp_Hash_Table *h = XHASH_TABLE (object);
+	  bool first = true;
+	  ptrdiff_t i;
+	  json_out (printer, "{", 1);
+	  for (i = 0; i < HASH_TABLE_SIZE (h); i++)
+	    if (!NILP (HASH_HASH (h, i)))
+	      {
+		if (!first)
+		  json_out (printer, ",", 1);
+		first = false;
+		json_out_key (printer, HASH_KEY (h, i), false);
+		json_out_value (printer, HASH_VALUE (h, i));
+	      }
+	  json_out (printer, "}", 1);
+	}
+      else
+	json_out_list (printer, object);
+      printer->depth--;
+    }
+  else
+    wrong_type_argument (Qjson_value_p, object);
+}
+
+/* Write out OBJECT as JSON into PRINTER, whose buffer is freed when
+   the specpdl is unwound.  */
+
+static void
+json_print (struct json_printer *printer, Lisp_Object object,
+	    ptrdiff_t nargs, Lisp_Object *args)
+{
+  printer->buf = NULL;
+  printer->size = printer->used = 0;
+  printer->depth = 0;
+  record_unwind_protect_ptr (json_free_printer, printer);
+  json_parse_args (nargs, args, &printer->conf, false);
+  json_out_value (printer, object);
+}
+
+DEFUN ("json-serialize", Fjson_serialize, Sjson_serialize, 1, MANY,
+       0,
+       doc: /* Return the JSON representation of OBJECT as a string.
+OBJECT may be t (written as `true'), an integer, a finite float, a
+string, a vector (written as an array), or a hash table, alist or
+plist (written as an object).  Hash tables may have string or symbol
+keys; alists and plists must have symbol keys, and the colon of a
+keyword key is left out.  nil is written as the empty object.  The
+elements of vectors and the values of objects are written the same way.
+
+ARGS are keyword arguments: the value of :null-object (default
+`:null') is written as `null', and that of :false-object (default
+`:false') as `false'.
+
+Strings must contain only Unicode characters; unibyte strings are taken
+to be UTF-8.
+
+usage: (json-serialize OBJECT &rest ARGS) */)
+  (ptrdiff_t nargs, Lisp_Object *args)
+{
+  ptrdiff_t count = SPECPDL_INDEX ();
+  struct json_printer printer;
+
+  json_print (&printer, args[0], nargs - 1, args + 1);
+  return unbind_to (count, make_string ((char *) printer.buf,
+					printer.used));
+}
+
+DEFUN ("json-insert", Fjson_insert, Sjson_insert, 1, MANY, 0,
+       doc: /* Insert the JSON representation of OBJECT before point.
+This is the same as (insert (json-serialize OBJECT ARGS...)), but
+faster.  In a unibyte buffer, the UTF-8 bytes are inserted.
+
+usage: (json-insert OBJECT &rest ARGS) */)
+  (ptrdiff_t nargs, Lisp_Object *args)
+{
+  ptrdiff_t count = SPECPDL_INDEX ();
+  struct json_printer printer;
+  ptrdiff_t nchars, opoint;
+
+  json_print (&printer, args[0], nargs - 1, args + 1);
+  nchars = (NILP (BVAR (current_buffer, enable_multibyte_characters))
+	    ? printer.used
+	    : multibyte_chars_in_text (printer.buf, printer.used));
+  opoint = PT;
+  insert_1_both ((char *) printer.buf, nchars, printer.used, 0, 1, 0);
+  signal_after_change (opoint, 0, PT - opoint);
+  update_compositions (opoint, PT, CHECK_BORDER);
+  return unbind_to (count, Qnil);
+}
+
+
+void
+syms_of_json (void)
+{
+  DEFSYM (QCnull, ":null");
+  DEFSYM (QCfalse, ":false");
+  DEFSYM (QCobject_type, ":object-type");
+  DEFSYM (QCarray_type, ":array-type");
+  DEFSYM (QCnull_object, ":null-object");
+  DEFSYM (QCfalse_object, ":false-object");
+  DEFSYM (Qhash_table, "hash-table");
+  DEFSYM (Qalist, "alist");
+  DEFSYM (Qplist, "plist");
+  DEFSYM (Qarray, "array");
+  DEFSYM (Qlist, "list");
+  DEFSYM (Qjson_value_p, "json-value-p");
+  DEFSYM (Qutf_8_string_p, "utf-8-string-p");
+
+  DEFSYM (Qjson_error, "json-error");
+  DEFSYM (Qjson_parse_error, "json-parse-error");
+  DEFSYM (Qjson_end_of_file, "json-end-of-file");
+  DEFSYM (Qjson_trailing_content, "json-trailing-content");
+  DEFSYM (Qjson_object_too_deep, "json-object-too-deep");
+
+  Fput (Qjson_error, Qerror_conditions,
+	listn (CONSTYPE_PURE, 2, Qjson_error, Qerror));
+  Fput (Qjson_error, Qerror_message,
+	build_pure_c_string ("Unknown JSON error"));
+
+  Fput (Qjson_parse_error, Qerror_conditions,
+	listn (CONSTYPE_PURE, 3, Qjson_parse_error, Qjson_error, Qerror));
+  Fput (Qjson_parse_error, Qerror_message,
+	build_pure_c_string ("Could not parse JSON"));
+
+  Fput (Qjson_end_of_file, Qerror_conditions,
+	listn (CONSTYPE_PURE, 4, Qjson_end_of_file, Qjson_parse_error,
+	       Qjson_error, Qerror));
+  Fput (Qjson_end_of_file, Qerror_message,
+	build_pure_c_string ("End of JSON input"));
+
+  Fput (Qjson_trailing_content, Qerror_conditions,
+	listn (CONSTYPE_PURE, 4, Qjson_trailing_content, Qjson_parse_error,
+	       Qjson_error, Qerror));
+  Fput (Qjson_trailing_content, Qerror_message,
+	build_pure_c_string ("Trailing content after JSON value"));
+
+  Fput (Qjson_object_too_deep, Qerror_conditions,
+	listn (CONSTYPE_PURE, 3, Qjson_object_too_deep, Qjson_error,
+	       Qerror));
+  Fput (Qjson_object_too_deep, Qerror_message,
+	build_pure_c_string ("JSON object too deep"));
+
+  defsubr (&Sjson_parse_string);
+  defsubr (&Sjson_parse_buffer);
+  defsubr (&Sjson_serialize);
+  defsubr (&Sjson_insert);
+}
@@ -291,6 +291,30 @@ static struct input_event * volatile kbd_store_ptr;
    dequeuing functions?  Such a flag could be screwed up by interrupts
    at inopportune times.  */
 
+/* Events for which there was no room in kbd_buffer, oldest first.
+   They come after all the events in kbd_buffer, and move there as it
+   drains; see kbd_buffer_refill.  This is a circular buffer of
+   kbd_overflow_size slots too, but it grows as needed, so that a
+   burst of input is never lost.  Unlike kbd_buffer, it can move when
+   it grows, so nothing may keep pointers into it.  */
+static struct input_event *kbd_overflow;
+static ptrdiff_t kbd_overflow_size;
+
+/* Index in kbd_overflow of its oldest event, and its number of events.  */
+static ptrdiff_t kbd_overflow_head;
+static ptrdiff_t kbd_overflow_count;
+
+/* Number of events stored in the input queue, number of them that
+   had to go into kbd_overflow, and the largest number of events
+   that the queue has held.  */
+static EMACS_INT kbd_events_stored;
+static EMACS_INT kbd_events_overflowed;
+static ptrdiff_t kbd_events_max_queued;
+
+/* Number of mouse movements that replaced one that had not been
+   read yet; see note_mouse_moved.  */
+static EMACS_INT mouse_movements_coalesced;
+
 /* Symbols to head events.  */
 static Lisp_Object Qmouse_movement;
 static Lisp_Object Qscroll_bar_movement;
@@ -412,6 +436,7 @@ static void (*keyboard_init_hook) (void);
 
 static bool get_input_pending (int);
 static bool readable_events (int);
+static void kbd_buffer_refill (void);
 static Lisp_Object read_char_x_menu_prompt (Lisp_Object,
                                             Lisp_Object, bool *);
 static Lisp_Object read_char_minibuf_menu_prompt (int, Lisp_Object);
@@ -3432,6 +3457,8 @@ readable_events (int flags)
   if (flags & READABLE_EVENTS_DO_TIMERS_NOW)
     timer_check ();
 
+  kbd_buffer_refill ();
+
   /* If the buffer contains only FOCUS_IN_EVENT events, and
      READABLE_EVENTS_FILTER_EVENTS is set, report it as empty.  */
   if (kbd_fetch_ptr != kbd_store_ptr)
@@ -3468,6 +3495,11 @@ readable_events (int flags)
                 event = kbd_buffer;
 	    }
 	  while (event != kbd_store_ptr);
+
+	  /* Don't bother to look at the events that didn't fit into
+	     kbd_buffer.  */
+	  if (kbd_overflow_count > 0)
+	    return 1;
         }
       else
 	return 1;
@@ -3513,7 +3545,6 @@ event_to_kboard (struct input_event *event)
     }
 }
 
-#ifdef subprocesses
 /* Return the number of slots occupied in kbd_buffer.  */
 
 static int
@@ -3526,7 +3557,92 @@ kbd_buffer_nr_stored (void)
        : ((kbd_buffer + KBD_BUFFER_SIZE) - kbd_fetch_ptr
           + (kbd_store_ptr - kbd_buffer)));
 }
-#endif	/* Store an event obtained at interrupt level into kbd_buffer, fifo */
+
+/* Return true if kbd_buffer has no room for another event.  The very
+   last slot is never used, since that would make the two pointers
+   equal, and that is indistinguishable from an empty buffer.  */
+
+static bool
+kbd_buffer_full_p (void)
+{
+  return kbd_buffer_nr_stored () >= KBD_BUFFER_SIZE - 1;
+}
+
+/* Return the Ith oldest event in kbd_overflow.  */
+
+static struct input_event *
+kbd_overflow_event (ptrdiff_t i)
+{
+  return &kbd_overflow[(kbd_overflow_head + i) % kbd_overflow_size];
+}
+
+/* Make room in kbd_overflow for one more event.  */
+
+static void
+kbd_overflow_grow (void)
+{
+  struct input_event *new;
+  ptrdiff_t i, new_size;
+
+  if (kbd_overflow_count < kbd_overflow_size)
+    return;
+  new_size = max (KBD_BUFFER_SIZE, 2 * kbd_overflow_size);
+  new = xnmalloc (new_size, sizeof *new);
+  for (i = 0; i < kbd_overflow_count; i++)
+    new[i] = *kbd_overflow_event (i);
+  xfree (kbd_overflow);
+  kbd_overflow = new;
+  kbd_overflow_size = new_size;
+  kbd_overflow_head = 0;
+}
+
+/* Append EVENT to kbd_buffer, which must not be full.  */
+
+static void
+kbd_buffer_put (struct input_event *event)
+{
+  if (kbd_store_ptr - kbd_buffer == KBD_BUFFER_SIZE)
+    kbd_store_ptr = kbd_buffer;
+  *kbd_store_ptr = *event;
+  ++kbd_store_ptr;
+}
+
+/* Move events from kbd_overflow into kbd_buffer, as many as fit.  */
+
+static void
+kbd_buffer_refill (void)
+{
+  while (kbd_overflow_count > 0 && !kbd_buffer_full_p ())
+    {
+      kbd_buffer_put (kbd_overflow_event (0));
+      kbd_overflow_head = (kbd_overflow_head + 1) % kbd_overflow_size;
+      kbd_overflow_count--;
+    }
+}
+
+/* Discard all the events in the input queue.  */
+
+static void
+kbd_buffer_discard (void)
+{
+  kbd_fetch_ptr = kbd_store_ptr;
+  kbd_overflow_count = 0;
+}
+
+/* Record that the mouse moved on frame F, so that a mouse movement
+   event is generated for it.  */
+
+void
+note_mouse_moved (struct frame *f)
+{
+  /* If an earlier movement has not been read yet, this one replaces
+     it.  */
+  if (f->mouse_moved)
+    mouse_movements_coalesced++;
+  f->mouse_moved = 1;
+}
+
+/* Store an event obtained at interrupt level into kbd_buffer, fifo */
 
 void
 kbd_buffer_store_event (register struct input_event *event)
@@ -3569,6 +3685,7 @@ kbd_buffer_store_event_hold (register struct input_event *event,
 	{
 	  KBOARD *kb = FRAME_KBOARD (XFRAME (event->frame_or_window));
 	  struct input_event *sp;
+	  ptrdiff_t i;
 
 	  if (single_kboard && kb != current_kboard)
 	    {
@@ -3588,6 +3705,16 @@ kbd_buffer_store_event_hold (register struct input_event *event,
 		      sp->arg = Qnil;
 		    }
 		}
+	      for (i = 0; i < kbd_overflow_count; i++)
+		{
+		  sp = kbd_overflow_event (i);
+		  if (event_to_kboard (sp) == kb)
+		    {
+		      sp->kind = NO_EVENT;
+		      sp->frame_or_window = Qnil;
+		      sp->arg = Qnil;
+		    }
+		}
 	      return;
 	    }
 
@@ -3626,35 +3753,42 @@ kbd_buffer_store_event_hold (register struct input_event *event,
   /* Don't insert two BUFFER_SWITCH_EVENT's in a row.
      Just ignore the second one.  */
   else if (event->kind == BUFFER_SWITCH_EVENT
-	   && kbd_fetch_ptr != kbd_store_ptr
-	   && ((kbd_store_ptr == kbd_buffer
-		? kbd_buffer + KBD_BUFFER_SIZE - 1
-		: kbd_store_ptr - 1)->kind) == BUFFER_SWITCH_EVENT)
+	   && (kbd_overflow_count > 0
+	       ? kbd_overflow_event (kbd_overflow_count - 1)->kind
+	       : (kbd_fetch_ptr != kbd_store_ptr
+		  ? (kbd_store_ptr == kbd_buffer
+		     ? kbd_buffer + KBD_BUFFER_SIZE - 1
+		     : kbd_store_ptr - 1)->kind
+		  : NO_EVENT)) == BUFFER_SWITCH_EVENT)
     return;
 
-  if (kbd_store_ptr - kbd_buffer == KBD_BUFFER_SIZE)
-    kbd_store_ptr = kbd_buffer;
-
-  /* Don't let the very last slot in the buffer become full,
-     since that would make the two pointers equal,
-     and that is indistinguishable from an empty buffer.
-     Discard the event if it would fill the last slot.  */
-  if (kbd_fetch_ptr - 1 != kbd_store_ptr)
+  /* Events must stay in order, so once one has gone into
+     kbd_overflow, the following ones must go there too until
+     kbd_buffer has taken them.  */
+  kbd_buffer_refill ();
+  if (kbd_overflow_count == 0 && !kbd_buffer_full_p ())
+    kbd_buffer_put (event);
+  else
     {
-      *kbd_store_ptr = *event;
-      ++kbd_store_ptr;
+      kbd_overflow_grow ();
+      *kbd_overflow_event (kbd_overflow_count++) = *event;
+      kbd_events_overflowed++;
+    }
+  kbd_events_stored++;
+  kbd_events_max_queued = max (kbd_events_max_queued,
+			       kbd_buffer_nr_stored () + kbd_overflow_count);
+
 #ifdef subprocesses
-      if (kbd_buffer_nr_stored () > KBD_BUFFER_SIZE/2 && ! kbd_on_hold_p ())
-        {
-          /* Don't read keyboard input until we have processed kbd_buffer.
-             This happens when pasting text longer than KBD_BUFFER_SIZE/2.  */
-          hold_keyboard_input ();
-          if (!noninteractive)
-            ignore_sigio ();
-          stop_polling ();
-        }
-#endif	/* subprocesses */
+  if (kbd_buffer_nr_stored () > KBD_BUFFER_SIZE/2 && ! kbd_on_hold_p ())
+    {
+      /* Don't read keyboard input until we have processed kbd_buffer.
+	 This happens when pasting text longer than KBD_BUFFER_SIZE/2.  */
+      hold_keyboard_input ();
+      if (!noninteractive)
+	ignore_sigio ();
+      stop_polling ();
     }
+#endif	/* subprocesses */
 
   /* If we're inside while-no-input, and this event qualifies
      as input, set quit-flag to cause an interrupt.  */
@@ -3680,15 +3814,24 @@ kbd_buffer_store_event_hold (register struct input_event *event,
 void
 kbd_buffer_unget_event (register struct input_event *event)
 {
-  if (kbd_fetch_ptr == kbd_buffer)
-    kbd_fetch_ptr = kbd_buffer + KBD_BUFFER_SIZE;
-
-  /* Don't let the very last slot in the buffer become full,  */
-  if (kbd_fetch_ptr - 1 != kbd_store_ptr)
+  /* If kbd_buffer is full, make room by moving its newest event to
+     the front of kbd_overflow.  */
+  if (kbd_buffer_full_p ())
     {
-      --kbd_fetch_ptr;
-      *kbd_fetch_ptr = *event;
+      if (kbd_store_ptr == kbd_buffer)
+	kbd_store_ptr = kbd_buffer + KBD_BUFFER_SIZE;
+      --kbd_store_ptr;
+      kbd_overflow_grow ();
+      kbd_overflow_head = ((kbd_overflow_head + kbd_overflow_size - 1)
+			   % kbd_overflow_size);
+      kbd_overflow_count++;
+      *kbd_overflow_event (0) = *kbd_store_ptr;
     }
+
+  if (kbd_fetch_ptr == kbd_buffer)
+    kbd_fetch_ptr = kbd_buffer + KBD_BUFFER_SIZE;
+  --kbd_fetch_ptr;
+  *kbd_fetch_ptr = *event;
 }
 
 
@@ -3738,28 +3881,38 @@ kbd_buffer_store_help_event (Lisp_Object frame, Lisp_Object help)
 }
 
 
+/* Discard EVENT if it is a mouse event, by setting it to NO_EVENT.  */
+
+static void
+discard_mouse_event (struct input_event *event)
+{
+  if (event->kind == MOUSE_CLICK_EVENT
+      || event->kind == WHEEL_EVENT
+      || event->kind == HORIZ_WHEEL_EVENT
+#ifdef HAVE_GPM
+      || event->kind == GPM_CLICK_EVENT
+#endif
+      || event->kind == SCROLL_BAR_CLICK_EVENT)
+    event->kind = NO_EVENT;
+}
+
 /* Discard any mouse events in the event buffer by setting them to
    NO_EVENT.  */
 void
 discard_mouse_events (void)
 {
   struct input_event *sp;
+  ptrdiff_t i;
+
   for (sp = kbd_fetch_ptr; sp != kbd_store_ptr; sp++)
     {
       if (sp == kbd_buffer + KBD_BUFFER_SIZE)
 	sp = kbd_buffer;
 
-      if (sp->kind == MOUSE_CLICK_EVENT
-	  || sp->kind == WHEEL_EVENT
-          || sp->kind == HORIZ_WHEEL_EVENT
-#ifdef HAVE_GPM
-	  || sp->kind == GPM_CLICK_EVENT
-#endif
-	  || sp->kind == SCROLL_BAR_CLICK_EVENT)
-	{
-	  sp->kind = NO_EVENT;
-	}
+      discard_mouse_event (sp);
     }
+  for (i = 0; i < kbd_overflow_count; i++)
+    discard_mouse_event (kbd_overflow_event (i));
 }
 
 
@@ -3774,15 +3927,20 @@ kbd_buffer_events_waiting (void)
 {
   struct input_event *sp;
 
-  for (sp = kbd_fetch_ptr;
-       sp != kbd_store_ptr && sp->kind == NO_EVENT;
-       ++sp)
+  do
     {
-      if (sp == kbd_buffer + KBD_BUFFER_SIZE)
-	sp = kbd_buffer;
-    }
+      kbd_buffer_refill ();
+      for (sp = kbd_fetch_ptr;
+	   sp != kbd_store_ptr && sp->kind == NO_EVENT;
+	   ++sp)
+	{
+	  if (sp == kbd_buffer + KBD_BUFFER_SIZE)
+	    sp = kbd_buffer;
+	}
 
-  kbd_fetch_ptr = sp;
+      kbd_fetch_ptr = sp;
+    }
+  while (sp == kbd_store_ptr && kbd_overflow_count > 0);
   return sp != kbd_store_ptr && sp->kind != NO_EVENT;
 }
 
@@ -3832,6 +3990,8 @@ kbd_buffer_get_event (KBOARD **kbp,
     }
 #endif	/* ! HAVE_DBUS  */
 
+  kbd_buffer_refill ();
+
   /* Wait until there is input available.  */
   for (;;)
     {
@@ -4369,6 +4529,52 @@ decode_timer (Lisp_Object timer, struct timespec *result)
 				 result, 0);
 }
 
+/* Return a copy of the front of the timer list LIST, up to and
+   including the first active timer that is not due by NOW.  LIST is
+   sorted by time, so timer_check_2 has no use for the rest of it.
+   This keeps each pass through timer_check from copying every
+   timer that is scheduled.  */
+static Lisp_Object
+copy_ripe_timers (Lisp_Object list, struct timespec now)
+{
+  Lisp_Object head = Qnil, last = Qnil;
+
+  for (; CONSP (list); list = XCDR (list))
+    {
+      Lisp_Object cell = list1 (XCAR (list));
+      struct timespec time;
+
+      if (NILP (last))
+	head = cell;
+      else
+	XSETCDR (last, cell);
+      last = cell;
+
+      if (decode_timer (XCAR (list), &time)
+	  && timespec_cmp (time, now) > 0)
+	break;
+    }
+  return head;
+}
+
+/* Return the time from NOW until the first active timer in the timer
+   list LIST is due, zero if it is due already, or an invalid value if
+   LIST has no active timers.  */
+static struct timespec
+timer_list_delay (Lisp_Object list, struct timespec now)
+{
+  for (; CONSP (list); list = XCDR (list))
+    {
+      struct timespec time;
+
+      if (decode_timer (XCAR (list), &time))
+	return (timespec_cmp (time, now) <= 0
+		? make_timespec (0, 0)
+		: timespec_sub (time, now));
+    }
+  return invalid_timespec ();
+}
+
 
 /* Check whether a timer has fired.  To prevent larger problems we simply
    disregard elements that are not proper timers.  Do not make a circular
@@ -4543,7 +4749,7 @@ timer_check_2 (Lisp_Object timers, Lisp_Object idle_timers)
 struct timespec
 timer_check (void)
 {
-  struct timespec nexttime;
+  struct timespec nexttime, now;
   Lisp_Object timers, idle_timers;
   struct gcpro gcpro1, gcpro2;
 
@@ -4552,13 +4758,18 @@ timer_check (void)
 
   /* We use copies of the timers' lists to allow a timer to add itself
      again, without locking up Emacs if the newly added timer is
-     already ripe when added.  */
+     already ripe when added.  Only the timers that are due now, and
+     the one after them, need to be copied.  */
+
+  now = current_timespec ();
 
   /* Always consider the ordinary timers.  */
-  timers = Fcopy_sequence (Vtimer_list);
+  timers = copy_ripe_timers (Vtimer_list, now);
   /* Consider the idle timers only if Emacs is idle.  */
   if (timespec_valid_p (timer_idleness_start_time))
-    idle_timers = Fcopy_sequence (Vtimer_idle_list);
+    idle_timers = copy_ripe_timers (Vtimer_idle_list,
+				    timespec_sub (now,
+						  timer_idleness_start_time));
   else
     idle_timers = Qnil;
 
@@ -4572,10 +4783,85 @@ timer_check (void)
     }
   while (nexttime.tv_sec == 0 && nexttime.tv_nsec == 0);
 
+  /* The copies end at the first timer that was not due yet.  If the
+     timers before it took long enough to make it due too, the copies
+     are used up now, but the lists may hold later timers.  */
+  if (! timespec_valid_p (nexttime))
+    {
+      now = current_timespec ();
+      nexttime = timer_list_delay (Vtimer_list, now);
+      if (timespec_valid_p (timer_idleness_start_time))
+	{
+	  struct timespec idle_delay
+	    = timer_list_delay (Vtimer_idle_list,
+				timespec_sub (now, timer_idleness_start_time));
+	  if (timespec_valid_p (idle_delay)
+	      && (! timespec_valid_p (nexttime)
+		  || timespec_cmp (idle_delay, nexttime) < 0))
+	    nexttime = idle_delay;
+	}
+    }
+
   UNGCPRO;
   return nexttime;
 }
 
+DEFUN ("internal-timer-insertion-point", Finternal_timer_insertion_point,
+       Sinternal_timer_insertion_point, 2, 2, 0,
+       doc: /* Return the cell of LIST after which to insert TIMER.
+LIST is a list of timers sorted by time, such as `timer-list'.  The
+value is the last cons cell of LIST whose timer is due before TIMER,
+or nil if TIMER belongs at the front of LIST.  Elements of LIST that
+are not timers are skipped.  This is an internal function for
+timer.el.  */)
+  (Lisp_Object timer, Lisp_Object list)
+{
+  Lisp_Object last = Qnil;
+  Lisp_Object *vector;
+  struct timespec time, elt_time;
+
+  if (! (VECTORP (timer) && ASIZE (timer) == 9))
+    wrong_type_argument (Qvectorp, timer);
+  vector = XVECTOR (timer)->contents;
+  if (! decode_time_components (vector[1], vector[2], vector[3], vector[8],
+				&time, 0))
+    error ("Invalid time specification");
+
+  for (; CONSP (list); list = XCDR (list))
+    {
+      Lisp_Object elt = XCAR (list);
+
+      if (VECTORP (elt) && ASIZE (elt) == 9)
+	{
+	  vector = XVECTOR (elt)->contents;
+	  if (decode_time_components (vector[1], vector[2], vector[3],
+				      vector[8], &elt_time, 0)
+	      && timespec_cmp (elt_time, time) >= 0)
+	    break;
+	}
+      last = list;
+    }
+  return last;
+}
+
+DEFUN ("input-queue-statistics", Finput_queue_statistics,
+       Sinput_queue_statistics, 0, 0, 0,
+       doc: /* Return statistics about the queue of input events.
+The value is a list (STORED OVERFLOWED MAX-QUEUED COALESCED).
+STORED is the number of events that have been put into the queue, and
+OVERFLOWED is how many of them arrived while its fixed-size part was
+full and were kept in its growable part.  MAX-QUEUED is the largest
+number of events that the queue has held at once.  COALESCED is the
+number of mouse movements that replaced an earlier one that had not
+been read yet.  */)
+  (void)
+{
+  return list4 (make_fixnum_or_float (kbd_events_stored),
+		make_fixnum_or_float (kbd_events_overflowed),
+		make_number (kbd_events_max_queued),
+		make_fixnum_or_float (mouse_movements_coalesced));
+}
+
 DEFUN ("current-idle-time", Fcurrent_idle_time, Scurrent_idle_time, 0, 0, 0,
        doc: /* Return the current length of Emacs idleness, or nil.
 The value when Emacs is idle is a list of four integers (HIGH LOW USEC PSEC)
@@ -10119,7 +10405,7 @@ Also end any kbd macro being defined.  */)
 
   discard_tty_input ();
 
-  kbd_fetch_ptr =  kbd_store_ptr;
+  kbd_buffer_discard ();
   input_pending = 0;
 
   return Qnil;
@@ -10220,6 +10506,13 @@ stuff_buffered_input (Lisp_Object stuffstring)
 
       clear_event (kbd_fetch_ptr);
     }
+  for (; kbd_overflow_count > 0; kbd_overflow_count--)
+    {
+      struct input_event *event = kbd_overflow_event (0);
+      if (event->kind == ASCII_KEYSTROKE_EVENT)
+	stuff_char (event->code);
+      kbd_overflow_head = (kbd_overflow_head + 1) % kbd_overflow_size;
+    }
 
   input_pending = 0;
 #endif /* SIGTSTP */
@@ -11113,6 +11406,8 @@ syms_of_keyboard (void)
   help_form_saved_window_configs = Qnil;
   staticpro (&help_form_saved_window_configs);
 
+  defsubr (&Sinternal_timer_insertion_point);
+  defsubr (&Sinput_queue_statistics);
   defsubr (&Scurrent_idle_time);
   defsubr (&Sevent_symbol_parse_modifiers);
   defsubr (&Sevent_convert_list);
@@ -11746,6 +12041,22 @@ keys_of_keyboard (void)
 			    "handle-focus-out");
 }
 
+/* Mark the Lisp objects in EVENT, an event in the input queue.  */
+
+static void
+mark_event (struct input_event *event)
+{
+  /* These two special event types has no Lisp_Objects to mark.  */
+  if (event->kind != SELECTION_REQUEST_EVENT
+      && event->kind != SELECTION_CLEAR_EVENT)
+    {
+      mark_object (event->x);
+      mark_object (event->y);
+      mark_object (event->frame_or_window);
+      mark_object (event->arg);
+    }
+}
+
 /* Mark the pointers in the kboard objects.
    Called by Fgarbage_collect.  */
 void
@@ -11782,15 +12093,12 @@ mark_kboards (void)
       {
 	if (event == kbd_buffer + KBD_BUFFER_SIZE)
 	  event = kbd_buffer;
-	/* These two special event types has no Lisp_Objects to mark.  */
-	if (event->kind != SELECTION_REQUEST_EVENT
-	    && event->kind != SELECTION_CLEAR_EVENT)
-	  {
-	    mark_object (event->x);
-	    mark_object (event->y);
-	    mark_object (event->frame_or_window);
-	    mark_object (event->arg);
-	  }
+	mark_event (event);
       }
   }
+  {
+    ptrdiff_t i;
+    for (i = 0; i < kbd_overflow_count; i++)
+      mark_event (kbd_overflow_event (i));
+  }
 }
@@ -3040,6 +3040,10 @@ set_hash_value_slot (struct Lisp_Hash_Table *h, ptrdiff_t idx, Lisp_Object val)
   gc_aset (h->key_and_value, 2 * idx + 1, val);
 }
 
+/* Defined in eval.c.  Incremented whenever any symbol's function
+   cell changes, to invalidate cached function lookups.  */
+extern EMACS_UINT function_cell_epoch;
+
 /* Use these functions to set Lisp_Object
    or pointer slots of struct Lisp_Symbol.  */
 
@@ -3047,6 +3051,7 @@ LISP_INLINE void
 set_symbol_function (Lisp_Object sym, Lisp_Object function)
 {
   XSYMBOL (sym)->function = function;
+  function_cell_epoch++;
 }
 
 LISP_INLINE void
@@ -3165,6 +3170,7 @@ EXFUN (Fbyteorder, 0) ATTRIBUTE_CONST;
 /* Defined in data.c.  */
 extern Lisp_Object indirect_function (Lisp_Object);
 extern Lisp_Object find_symbol_value (Lisp_Object);
+extern Lisp_Object local_var_binding (struct buffer *, Lisp_Object);
 enum Arith_Comparison {
   ARITH_EQUAL,
   ARITH_NOTEQUAL,
@@ -3320,6 +3326,8 @@ extern void insert_and_inherit (const char *, ptrdiff_t);
 extern void insert_1_both (const char *, ptrdiff_t, ptrdiff_t,
 			   bool, bool, bool);
 extern void insert_from_gap (ptrdiff_t, ptrdiff_t, bool text_at_gap_tail);
+extern void finish_insert_before_markers (ptrdiff_t, ptrdiff_t,
+					  ptrdiff_t, ptrdiff_t);
 extern void insert_from_string (Lisp_Object, ptrdiff_t, ptrdiff_t,
 				ptrdiff_t, ptrdiff_t, bool);
 extern void insert_from_buffer (struct buffer *, ptrdiff_t, ptrdiff_t, bool);
@@ -3734,6 +3742,7 @@ extern void record_in_backtrace (Lisp_Object function,
 extern void mark_specpdl (void);
 extern void get_backtrace (Lisp_Object array);
 Lisp_Object backtrace_top_function (void);
+extern bool set_backtrace_tail_call (ptrdiff_t, Lisp_Object *, ptrdiff_t);
 extern bool let_shadows_buffer_binding_p (struct Lisp_Symbol *symbol);
 extern bool let_shadows_global_binding_p (Lisp_Object symbol);
 
@@ -3984,10 +3993,11 @@ extern void syms_of_process (void);
 extern void setup_process_coding_systems (Lisp_Object);
 
 /* Defined in callproc.c.  */
+extern char **make_environment_block (Lisp_Object);
 #ifndef DOS_NT
  _Noreturn
 #endif
-extern int child_setup (int, int, int, char **, bool, Lisp_Object);
+extern int child_setup (int, int, int, char **, char **, bool, Lisp_Object);
 extern void init_callproc_1 (void);
 extern void init_callproc (void);
 extern void set_initial_environment (void);
@@ -4179,6 +4189,9 @@ extern void syms_of_xml (void);
 extern void xml_cleanup_parser (void);
 #endif
 
+/* Defined in json.c.  */
+extern void syms_of_json (void);
+
 #ifdef HAVE_ZLIB
 /* Defined in decompress.c.  */
 extern void syms_of_decompress (void);
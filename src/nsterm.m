@@ -1754,7 +1754,7 @@ note_mouse_movement (struct frame *frame, CGFloat x, CGFloat y)
       y >= (last_mouse_glyph.origin.y + last_mouse_glyph.size.height))
     {
       ns_update_begin(frame);
-      frame->mouse_moved = 1;
+      note_mouse_moved (frame);
       note_mouse_highlight (frame, x, y);
       remember_mouse_glyph (frame, x, y, &last_mouse_glyph);
       ns_update_end(frame);
@@ -94,6 +94,12 @@ along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.  */
 #include <sig2str.h>
 #include <verify.h>
 
+/* Use epoll to wait for subprocess output if the system has it.  */
+#if defined HAVE_SYS_EPOLL_H && defined HAVE_EPOLL_CREATE1
+#include <sys/epoll.h>
+#define USE_EPOLL
+#endif
+
 #endif	/* subprocesses */
 
 #include "systime.h"
@@ -210,6 +216,7 @@ static Lisp_Object QCsentinel, QClog, QCoptions, QCplist;
 static Lisp_Object Qlast_nonmenu_event;
 static Lisp_Object Qinternal_default_process_sentinel;
 static Lisp_Object Qinternal_default_process_filter;
+static Lisp_Object Qnewline, Qcontent_length;
 
 #define NETCONN_P(p) (EQ (XPROCESS (p)->type, Qnetwork))
 #define NETCONN1_P(p) (EQ (p->type, Qnetwork))
@@ -256,6 +263,9 @@ static EMACS_INT update_tick;
 # define HAVE_SEQPACKET
 #endif
 
+/* The smallest number of bytes read_process_output asks for.  */
+#define READ_PROCESS_OUTPUT_MIN 4096
+
 #if !defined (ADAPTIVE_READ_BUFFERING) && !defined (NO_ADAPTIVE_READ_BUFFERING)
 #define ADAPTIVE_READ_BUFFERING
 #endif
@@ -280,7 +290,8 @@ static bool process_output_skip;
 
 static void create_process (Lisp_Object, char **, Lisp_Object);
 #ifdef USABLE_SIGIO
-static bool keyboard_bit_set (fd_set *);
+struct ready_fd;
+static bool keyboard_bit_set (struct ready_fd *, int);
 #endif
 static void deactivate_process (Lisp_Object);
 static void status_notify (struct Lisp_Process *);
@@ -296,31 +307,30 @@ static void create_pty (Lisp_Object);
 
 static Lisp_Object get_process (register Lisp_Object name);
 static void exec_sentinel (Lisp_Object proc, Lisp_Object reason);
+static void exec_send_callback (Lisp_Object proc);
 
-/* Mask of bits indicating the descriptors that we wait for input on.  */
-
-static fd_set input_wait_mask;
+/* Bits saying which sets of descriptors a descriptor belongs to.
+   They are kept in the `waiting' field of fd_callback_info.  */
 
-/* Mask that excludes keyboard input descriptor(s).  */
+/* The descriptors that we wait for input on.  */
+#define INPUT_WAIT		1
 
-static fd_set non_keyboard_wait_mask;
+/* The input descriptors, except keyboard input descriptor(s).  */
+#define NON_KEYBOARD_WAIT	2
 
-/* Mask that excludes process input descriptor(s).  */
+/* The input descriptors, except process input descriptor(s).  */
+#define NON_PROCESS_WAIT	4
 
-static fd_set non_process_wait_mask;
-
-/* Mask for selecting for write.  */
-
-static fd_set write_mask;
+/* The descriptors that we wait for write on.  */
+#define WRITE_WAIT		8
 
 #ifdef NON_BLOCKING_CONNECT
-/* Mask of bits indicating the descriptors that we wait for connect to
-   complete on.  Once they complete, they are removed from this mask
-   and added to the input_wait_mask and non_keyboard_wait_mask.  */
+/* The descriptors that we wait for connect to complete on.  Once they
+   complete, they are removed from this set and added to INPUT_WAIT
+   and NON_KEYBOARD_WAIT.  */
+#define CONNECT_WAIT		16
 
-static fd_set connect_wait_mask;
-
-/* Number of bits set in connect_wait_mask.  */
+/* Number of descriptors in CONNECT_WAIT.  */
 static int num_pending_connects;
 #endif	/* NON_BLOCKING_CONNECT */
 
@@ -330,8 +340,12 @@ static int max_process_desc;
 /* The largest descriptor currently in use for input; -1 if none.  */
 static int max_input_desc;
 
+/* The tables below are indexed by descriptor.  They have
+   fd_tables_size elements and grow as needed; see grow_fd_tables.  */
+static int fd_tables_size;
+
 /* Indexed by descriptor, gives the process (if any) for that descriptor */
-static Lisp_Object chan_process[FD_SETSIZE];
+static Lisp_Object *chan_process;
 
 /* Alist of elements (NAME . PROCESS) */
 static Lisp_Object Vprocess_alist;
@@ -342,18 +356,18 @@ static Lisp_Object Vprocess_alist;
    output from the process is to read at least one char.
    Always -1 on systems that support FIONREAD.  */
 
-static int proc_buffered_char[FD_SETSIZE];
+static int *proc_buffered_char;
 
 /* Table of `struct coding-system' for each process.  */
-static struct coding_system *proc_decode_coding_system[FD_SETSIZE];
-static struct coding_system *proc_encode_coding_system[FD_SETSIZE];
+static struct coding_system **proc_decode_coding_system;
+static struct coding_system **proc_encode_coding_system;
 
 #ifdef DATAGRAM_SOCKETS
 /* Table of `partner address' for datagram sockets.  */
 static struct sockaddr_and_len {
   struct sockaddr *sa;
   int len;
-} datagram_address[FD_SETSIZE];
+} *datagram_address;
 #define DATAGRAM_CHAN_P(chan)	(datagram_address[chan].sa != 0)
 #define DATAGRAM_CONN_P(proc)	(PROCESSP (proc) && datagram_address[XPROCESS (proc)->infd].sa != 0)
 #else
@@ -448,6 +462,21 @@ pset_write_queue (struct Lisp_Process *p, Lisp_Object val)
 {
   p->write_queue = val;
 }
+static void
+pset_message_framing (struct Lisp_Process *p, Lisp_Object val)
+{
+  p->message_framing = val;
+}
+static void
+pset_message_buf (struct Lisp_Process *p, Lisp_Object val)
+{
+  p->message_buf = val;
+}
+static void
+pset_send_callback (struct Lisp_Process *p, Lisp_Object val)
+{
+  p->send_callback = val;
+}
 
 
 
@@ -458,8 +487,233 @@ static struct fd_callback_data
 #define FOR_READ  1
 #define FOR_WRITE 2
   int condition; /* mask of the defines above.  */
-} fd_callback_info[FD_SETSIZE];
+  /* The sets of descriptors this descriptor belongs to; a mask of
+     INPUT_WAIT, NON_KEYBOARD_WAIT, etc.  */
+  int waiting;
+#ifdef ADAPTIVE_READ_BUFFERING
+  /* If this equals output_skip_tick, do not wait for input on this
+     descriptor in the next wait.  */
+  unsigned skip_tick;
+#endif
+#ifdef USE_EPOLL
+  /* The events epoll_fd reports for this descriptor; zero if it
+     is disarmed.  */
+  int armed;
+  /* True if this descriptor has been added to epoll_fd.  */
+  unsigned int registered : 1;
+  /* True if this descriptor is in epoll_rearm.  */
+  unsigned int rearm : 1;
+  /* True if epoll cannot watch this descriptor (a regular file,
+     say).  Such a descriptor is always ready, as with pselect.  */
+  unsigned int always_ready : 1;
+#endif
+} *fd_callback_info;
+
+#ifdef ADAPTIVE_READ_BUFFERING
+/* Incremented after each wait for descriptors.  */
+static unsigned output_skip_tick;
+#endif
+
+#ifdef USE_EPOLL
+/* The epoll instance used to wait for descriptors; -1 if none, in
+   which case we use pselect instead.
+
+   Descriptors are added with EPOLLONESHOT, so that epoll disarms
+   each descriptor it reports.  Before each wait, the descriptors
+   that we want to hear about and that are not armed are armed again,
+   so the cost of a wait is proportional to the number of ready
+   descriptors rather than to the largest descriptor in use.  */
+static int epoll_fd;
+
+/* Descriptors that are not armed for all the events they are
+   interested in, and so may need to be armed before the next wait.  */
+static int *epoll_rearm;
+static ptrdiff_t epoll_rearm_count, epoll_rearm_size;
+#endif
+
+/* The largest number of ready descriptors handled by one wait.  Any
+   others are reported by the next wait.  */
+#define MAX_READY_FDS 256
+
+/* A descriptor found ready by wait_for_descriptors.  */
+struct ready_fd
+{
+  int fd;
+  int condition;	/* FOR_READ and/or FOR_WRITE.  */
+};
+
+/* Make sure that the tables indexed by descriptor have room for FD.  */
+
+static void
+grow_fd_tables (int fd)
+{
+  ptrdiff_t i, old_size = fd_tables_size, new_size;
+  struct fd_callback_data *info, *old_info = fd_callback_info;
+  sigset_t blocked, oldset;
+
+  if (fd < old_size)
+    return;
+
+  new_size = max (max (fd + 1, 2 * old_size), FD_SETSIZE);
+  chan_process = xnrealloc (chan_process, new_size, sizeof *chan_process);
+  proc_buffered_char = xnrealloc (proc_buffered_char, new_size,
+				  sizeof *proc_buffered_char);
+  proc_decode_coding_system
+    = xnrealloc (proc_decode_coding_system, new_size,
+		 sizeof *proc_decode_coding_system);
+  proc_encode_coding_system
+    = xnrealloc (proc_encode_coding_system, new_size,
+		 sizeof *proc_encode_coding_system);
+#ifdef DATAGRAM_SOCKETS
+  datagram_address = xnrealloc (datagram_address, new_size,
+				sizeof *datagram_address);
+#endif
+  for (i = old_size; i < new_size; i++)
+    {
+      chan_process[i] = Qnil;
+      proc_buffered_char[i] = -1;
+      proc_decode_coding_system[i] = NULL;
+      proc_encode_coding_system[i] = NULL;
+#ifdef DATAGRAM_SOCKETS
+      datagram_address[i].sa = NULL;
+      datagram_address[i].len = 0;
+#endif
+    }
+
+  /* The SIGCHLD handler modifies fd_callback_info, so keep it from
+     running while the table is copied.  */
+  info = xnmalloc (new_size, sizeof *info);
+  memset (info + old_size, 0, (new_size - old_size) * sizeof *info);
+  sigemptyset (&blocked);
+  sigaddset (&blocked, SIGCHLD);
+  pthread_sigmask (SIG_BLOCK, &blocked, &oldset);
+  if (old_size)
+    memcpy (info, old_info, old_size * sizeof *info);
+  fd_callback_info = info;
+  fd_tables_size = new_size;
+  pthread_sigmask (SIG_SETMASK, &oldset, 0);
+  xfree (old_info);
+}
+
+#ifdef USE_EPOLL
+
+/* Return the epoll events that descriptor D is interested in.  */
+
+static int
+epoll_interest (struct fd_callback_data *d)
+{
+  return (((d->waiting & (INPUT_WAIT | NON_KEYBOARD_WAIT | NON_PROCESS_WAIT))
+	   ? EPOLLIN : 0)
+	  | (d->waiting & WRITE_WAIT ? EPOLLOUT : 0));
+}
+
+/* Arrange for descriptor FD to be looked at before the next wait.  */
+
+static void
+epoll_schedule_rearm (int fd)
+{
+  if (!fd_callback_info[fd].rearm)
+    {
+      if (epoll_rearm_count == epoll_rearm_size)
+	epoll_rearm = xpalloc (epoll_rearm, &epoll_rearm_size, 1, -1,
+			       sizeof *epoll_rearm);
+      epoll_rearm[epoll_rearm_count++] = fd;
+      fd_callback_info[fd].rearm = 1;
+    }
+}
+
+/* Arm descriptor FD in epoll_fd for EVENTS.  */
+
+static void
+epoll_arm_fd (int fd, int events)
+{
+  struct fd_callback_data *d = &fd_callback_info[fd];
+  struct epoll_event ev;
 
+  memset (&ev, 0, sizeof ev);
+  ev.events = events | EPOLLONESHOT;
+  ev.data.fd = fd;
+  if (epoll_ctl (epoll_fd, d->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+		 fd, &ev)
+      != 0)
+    {
+      /* FD may have been closed, which removes it from epoll_fd, and
+	 its number reused without our noticing.  */
+      int op = (errno == ENOENT ? EPOLL_CTL_ADD
+		: errno == EEXIST ? EPOLL_CTL_MOD
+		: -1);
+      if (op < 0 || epoll_ctl (epoll_fd, op, fd, &ev) != 0)
+	{
+	  d->always_ready = errno == EPERM;
+	  d->registered = 0;
+	  d->armed = 0;
+	  return;
+	}
+    }
+  d->registered = 1;
+  d->armed = events;
+}
+
+/* Bring descriptor FD's registration in epoll_fd up to date after a
+   change to the sets of descriptors it belongs to.  */
+
+static void
+epoll_update (int fd)
+{
+  struct fd_callback_data *d = &fd_callback_info[fd];
+
+  if (epoll_fd < 0)
+    return;
+  if (epoll_interest (d) == 0)
+    {
+      if (d->registered)
+	epoll_ctl (epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+      d->registered = 0;
+      d->armed = 0;
+      d->always_ready = 0;
+    }
+  else
+    epoll_schedule_rearm (fd);
+}
+
+#endif /* USE_EPOLL */
+
+/* Add descriptor FD to the sets of descriptors in the mask WAITING.  */
+
+static void
+set_fd_waiting (int fd, int waiting)
+{
+  grow_fd_tables (fd);
+  fd_callback_info[fd].waiting |= waiting;
+#ifdef USE_EPOLL
+  epoll_update (fd);
+#endif
+}
+
+/* Remove descriptor FD from the sets of descriptors in the mask WAITING.
+   Do not call this from a signal handler.  */
+
+static void
+clear_fd_waiting (int fd, int waiting)
+{
+  if (fd < fd_tables_size)
+    {
+      fd_callback_info[fd].waiting &= ~waiting;
+#ifdef USE_EPOLL
+      epoll_update (fd);
+#endif
+    }
+}
+
+/* Return true if descriptor FD belongs to one of the sets of
+   descriptors in the mask WAITING.  */
+
+static bool
+fd_waiting_p (int fd, int waiting)
+{
+  return 0 <= fd && fd < fd_tables_size
+	 && (fd_callback_info[fd].waiting & waiting) != 0;
+}
 
 /* Add a file descriptor FD to be monitored for when read is possible.
    When read is possible, call FUNC with argument DATA.  */
@@ -467,7 +721,6 @@ static struct fd_callback_data
 void
 add_read_fd (int fd, fd_callback func, void *data)
 {
-  eassert (fd < FD_SETSIZE);
   add_keyboard_wait_descriptor (fd);
 
   fd_callback_info[fd].func = func;
@@ -480,7 +733,6 @@ add_read_fd (int fd, fd_callback func, void *data)
 void
 delete_read_fd (int fd)
 {
-  eassert (fd < FD_SETSIZE);
   delete_keyboard_wait_descriptor (fd);
 
   fd_callback_info[fd].condition &= ~FOR_READ;
@@ -497,8 +749,7 @@ delete_read_fd (int fd)
 void
 add_write_fd (int fd, fd_callback func, void *data)
 {
-  eassert (fd < FD_SETSIZE);
-  FD_SET (fd, &write_mask);
+  set_fd_waiting (fd, WRITE_WAIT);
   if (fd > max_input_desc)
     max_input_desc = fd;
 
@@ -516,8 +767,7 @@ delete_input_desc (int fd)
     {
       do
 	fd--;
-      while (0 <= fd && ! (FD_ISSET (fd, &input_wait_mask)
-			   || FD_ISSET (fd, &write_mask)));
+      while (0 <= fd && ! fd_waiting_p (fd, INPUT_WAIT | WRITE_WAIT));
 
       max_input_desc = fd;
     }
@@ -528,8 +778,7 @@ delete_input_desc (int fd)
 void
 delete_write_fd (int fd)
 {
-  eassert (fd < FD_SETSIZE);
-  FD_CLR (fd, &write_mask);
+  clear_fd_waiting (fd, WRITE_WAIT);
   fd_callback_info[fd].condition &= ~FOR_WRITE;
   if (fd_callback_info[fd].condition == 0)
     {
@@ -539,6 +788,239 @@ delete_write_fd (int fd)
     }
 }
 
+/* Return true if we should wait for input on descriptor FD.  READ_SET
+   and READ_FD are as for wait_for_descriptors.  */
+
+static bool
+want_input_p (int fd, int read_set, int read_fd)
+{
+  struct fd_callback_data *d;
+
+  if (0 <= read_fd)
+    return fd == read_fd;
+  d = &fd_callback_info[fd];
+  return ((d->waiting & read_set) != 0
+#ifdef ADAPTIVE_READ_BUFFERING
+	  && d->skip_tick != output_skip_tick
+#endif
+	  );
+}
+
+/* Call pselect, or if TOOLKIT, the window system's replacement for it.  */
+
+static int
+toolkit_select (bool toolkit, int nfds, fd_set *rfds, fd_set *wfds,
+		struct timespec *timeout)
+{
+#if defined (HAVE_NS)
+  if (toolkit)
+    return ns_select (nfds, rfds, wfds, NULL, timeout, NULL);
+#elif defined (HAVE_GLIB)
+  if (toolkit)
+    return xg_select (nfds, rfds, wfds, NULL, timeout, NULL);
+#endif
+  return pselect (nfds, rfds, wfds, NULL, timeout, NULL);
+}
+
+/* Wait for descriptors with pselect.  The arguments and the value
+   are as for wait_for_descriptors.  */
+
+static int
+select_descriptors (int read_set, int read_fd, bool check_write,
+		    struct timespec *timeout, bool toolkit,
+		    struct ready_fd *ready)
+{
+  fd_set Available;
+  fd_set Writeok;
+  int fd, nfds, nready = 0;
+  int max_desc = max (max_process_desc, max_input_desc);
+
+  eassert (max_desc < FD_SETSIZE);
+  FD_ZERO (&Available);
+  FD_ZERO (&Writeok);
+  if (0 <= read_fd)
+    FD_SET (read_fd, &Available);
+  if (read_fd < 0 || check_write)
+    for (fd = 0; fd <= max_desc; fd++)
+      {
+	if (read_fd < 0 && want_input_p (fd, read_set, read_fd))
+	  FD_SET (fd, &Available);
+	if (check_write && fd_waiting_p (fd, WRITE_WAIT))
+	  FD_SET (fd, &Writeok);
+      }
+
+  nfds = toolkit_select (toolkit, max (max_desc, read_fd) + 1, &Available,
+			 check_write ? &Writeok : NULL, timeout);
+  if (nfds <= 0)
+    return nfds;
+
+  for (fd = 0; fd <= max (max_desc, read_fd) && nready < MAX_READY_FDS; fd++)
+    {
+      int condition = ((FD_ISSET (fd, &Available) ? FOR_READ : 0)
+		       | (check_write && FD_ISSET (fd, &Writeok)
+			  ? FOR_WRITE : 0));
+      if (condition)
+	{
+	  ready[nready].fd = fd;
+	  ready[nready++].condition = condition;
+	}
+    }
+  return nready;
+}
+
+#ifdef USE_EPOLL
+
+/* Wait for descriptors with epoll.  The arguments and the value are
+   as for wait_for_descriptors.  */
+
+static int
+epoll_descriptors (int read_set, int read_fd, bool check_write,
+		   struct timespec *timeout, bool toolkit,
+		   struct ready_fd *ready)
+{
+  struct epoll_event events[MAX_READY_FDS];
+  ptrdiff_t i, nrearm;
+  int n, msec, nready;
+  struct timespec end_time = timespec_add (current_timespec (), *timeout);
+
+ retry:
+  nrearm = 0;
+  nready = 0;
+
+  /* Arm the descriptors we want to hear about that are not armed.
+     Keep those that are still not armed for everything they are
+     interested in, to look at them again next time.  */
+  for (i = 0; i < epoll_rearm_count; i++)
+    {
+      int fd = epoll_rearm[i];
+      struct fd_callback_data *d = &fd_callback_info[fd];
+      int interest = epoll_interest (d);
+      int want = (((interest & EPOLLIN) && want_input_p (fd, read_set, -1)
+		   ? EPOLLIN : 0)
+		  | (check_write && (interest & EPOLLOUT) ? EPOLLOUT : 0));
+
+      if (want & ~d->armed && !d->always_ready)
+	epoll_arm_fd (fd, d->armed | want);
+      if (want && d->always_ready && nready < MAX_READY_FDS)
+	{
+	  ready[nready].fd = fd;
+	  ready[nready++].condition = ((want & EPOLLIN ? FOR_READ : 0)
+				       | (want & EPOLLOUT ? FOR_WRITE : 0));
+	}
+      if (interest & ~d->armed)
+	epoll_rearm[nrearm++] = fd;
+      else
+	d->rearm = 0;
+    }
+  epoll_rearm_count = nrearm;
+
+  if (0 <= read_fd && ! (fd_callback_info[read_fd].armed & EPOLLIN))
+    {
+      epoll_arm_fd (read_fd, fd_callback_info[read_fd].armed | EPOLLIN);
+      epoll_schedule_rearm (read_fd);
+    }
+
+  if (toolkit)
+    {
+      /* Let the window system wait, and see its own events, with
+	 epoll_fd standing in for all our descriptors.  */
+      fd_set rfds;
+      struct timespec zero = make_timespec (0, 0);
+
+      FD_ZERO (&rfds);
+      FD_SET (epoll_fd, &rfds);
+      n = toolkit_select (toolkit, epoll_fd + 1, &rfds, NULL,
+			  nready ? &zero : timeout);
+      if (n < 0 || (n == 0 && nready == 0))
+	return n;
+      msec = 0;
+    }
+  else if (nready || timeout->tv_sec < 0)
+    msec = 0;
+  else if (timeout->tv_sec < INT_MAX / 1000 - 1)
+    msec = timeout->tv_sec * 1000 + (timeout->tv_nsec + 999999) / 1000000;
+  else
+    msec = INT_MAX;
+
+  n = epoll_wait (epoll_fd, events, MAX_READY_FDS - nready, msec);
+  if (n < 0)
+    return nready ? nready : n;
+
+  for (i = 0; i < n; i++)
+    {
+      int fd = events[i].data.fd;
+      int condition = 0;
+
+      if (! (0 <= fd && fd < fd_tables_size))
+	continue;
+      /* EPOLLONESHOT has disarmed FD.  */
+      fd_callback_info[fd].armed = 0;
+      epoll_schedule_rearm (fd);
+
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)
+	  && want_input_p (fd, read_set, read_fd))
+	condition |= FOR_READ;
+      if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)
+	  && check_write && fd_waiting_p (fd, WRITE_WAIT))
+	condition |= FOR_WRITE;
+      if (condition)
+	{
+	  ready[nready].fd = fd;
+	  ready[nready++].condition = condition;
+	}
+    }
+
+  /* If we woke up only for descriptors we do not want now, which are
+     disarmed by now, wait for the rest of TIMEOUT.  */
+  if (nready == 0 && (0 < n || toolkit))
+    {
+      struct timespec now = current_timespec ();
+      if (timespec_cmp (now, end_time) < 0)
+	{
+	  *timeout = timespec_sub (end_time, now);
+	  goto retry;
+	}
+    }
+  return nready;
+}
+
+#endif /* USE_EPOLL */
+
+/* Wait until TIMEOUT expires or some descriptors are ready, and store
+   the ready descriptors into READY, which has room for MAX_READY_FDS
+   elements.  Wait for input on the descriptors in READ_SET (a mask of
+   INPUT_WAIT, NON_KEYBOARD_WAIT and NON_PROCESS_WAIT), or, if READ_FD
+   is nonnegative, on READ_FD alone.  If CHECK_WRITE, also wait until
+   the descriptors in WRITE_WAIT can be written.  If TOOLKIT, let the
+   window system process its own events while waiting.
+
+   Return the number of ready descriptors, zero if TIMEOUT expired,
+   or -1 with errno set on failure or interruption.  */
+
+static int
+wait_for_descriptors (int read_set, int read_fd, bool check_write,
+		      struct timespec *timeout, bool toolkit,
+		      struct ready_fd *ready)
+{
+  int nready;
+
+#ifdef USE_EPOLL
+  if (0 <= epoll_fd)
+    nready = epoll_descriptors (read_set, read_fd, check_write,
+				timeout, toolkit, ready);
+  else
+#endif
+    nready = select_descriptors (read_set, read_fd, check_write,
+				 timeout, toolkit, ready);
+
+#ifdef ADAPTIVE_READ_BUFFERING
+  /* Zero is the skip_tick of descriptors that were never skipped.  */
+  if (++output_skip_tick == 0)
+    output_skip_tick = 1;
+#endif
+  return nready;
+}
+
 
 /* Compute the Lisp form of the process status, p->status, from
    the numeric status that was returned by `wait'.  */
@@ -1077,15 +1559,13 @@ The string argument is normally a multibyte string, except:
     {
       if (EQ (filter, Qt) && !EQ (p->status, Qlisten))
 	{
-	  FD_CLR (p->infd, &input_wait_mask);
-	  FD_CLR (p->infd, &non_keyboard_wait_mask);
+	  clear_fd_waiting (p->infd, INPUT_WAIT | NON_KEYBOARD_WAIT);
 	}
       else if (EQ (p->filter, Qt)
 	       /* Network or serial process not stopped:  */
 	       && !EQ (p->command, Qt))
 	{
-	  FD_SET (p->infd, &input_wait_mask);
-	  FD_SET (p->infd, &non_keyboard_wait_mask);
+	  set_fd_waiting (p->infd, INPUT_WAIT | NON_KEYBOARD_WAIT);
 	}
     }
 
@@ -1106,6 +1586,53 @@ See `set-process-filter' for more info on filter functions.  */)
   return XPROCESS (process)->filter;
 }
 
+DEFUN ("set-process-message-framing", Fset_process_message_framing,
+       Sset_process_message_framing, 2, 2, 0,
+       doc: /* Make PROCESS pass its output to its filter one message at a time.
+FRAMING says how to find the messages in the output:
+
+ `newline'  -- Each line is a message.  The filter gets it without
+               the newline.
+ `content-length' -- Each message is a header of CRLF-terminated lines,
+               ended by an empty line, followed by as many bytes as its
+               Content-Length field says, as in the Language Server
+               Protocol.  The filter gets just those bytes.
+ nil        -- Pass the output to the filter as it arrives.  This is
+               the default.
+
+Output that does not make up a whole message yet is kept until the rest
+arrives, so the filter is called exactly once for each message.  Each
+message is decoded on its own with PROCESS's coding system for decoding.
+When PROCESS closes its output, anything left over is passed to the
+filter as it is.  Changing the framing discards any such leftover.  */)
+  (Lisp_Object process, Lisp_Object framing)
+{
+  struct Lisp_Process *p;
+
+  CHECK_PROCESS (process);
+  if (! (NILP (framing) || EQ (framing, Qnewline)
+	 || EQ (framing, Qcontent_length)))
+    signal_error ("Invalid message framing", framing);
+  p = XPROCESS (process);
+  if (!EQ (p->message_framing, framing))
+    {
+      pset_message_framing (p, framing);
+      p->message_start = p->message_end = p->message_scan = 0;
+      p->message_body = p->message_size = 0;
+    }
+  return framing;
+}
+
+DEFUN ("process-message-framing", Fprocess_message_framing,
+       Sprocess_message_framing, 1, 1, 0,
+       doc: /* Return the message framing of PROCESS.
+See `set-process-message-framing' for more info.  */)
+  (Lisp_Object process)
+{
+  CHECK_PROCESS (process);
+  return XPROCESS (process)->message_framing;
+}
+
 DEFUN ("set-process-sentinel", Fset_process_sentinel, Sset_process_sentinel,
        2, 2, 0,
        doc: /* Give PROCESS the sentinel SENTINEL; nil for default.
@@ -1287,6 +1814,23 @@ nil, indicating the current buffer's process.  */)
   return XPROCESS (proc)->type;
 }
 
+DEFUN ("process-output-statistics", Fprocess_output_statistics,
+       Sprocess_output_statistics, 1, 1, 0,
+       doc: /* Return statistics about the output read from PROCESS.
+The value is a list (READS BYTES READ-SIZE), where READS is the number
+of reads that got output from PROCESS, BYTES is the total number of
+bytes they got, and READ-SIZE is the number of bytes Emacs asks for
+when it next reads from PROCESS.  See `read-process-output-max'.
+PROCESS may be a process, a buffer, the name of a process or buffer, or
+nil, indicating the current buffer's process.  */)
+  (Lisp_Object process)
+{
+  struct Lisp_Process *p = XPROCESS (get_process (process));
+  return list3 (make_fixnum_or_float (p->output_reads),
+		make_fixnum_or_float (p->output_bytes),
+		make_number (max (p->read_size, READ_PROCESS_OUTPUT_MIN)));
+}
+
 DEFUN ("format-network-address", Fformat_network_address, Sformat_network_address,
        1, 2, 0,
        doc: /* Convert network ADDRESS from internal format to a string.
@@ -1657,6 +2201,7 @@ create_process (Lisp_Object process, char **new_argv, Lisp_Object current_dir)
   pid_t pid;
   int vfork_errno;
   int forkin, forkout;
+  char **env;
   bool pty_flag = 0;
   char pty_name[PTY_NAME_SIZE];
   Lisp_Object lisp_pty_name = Qnil;
@@ -1704,6 +2249,7 @@ create_process (Lisp_Object process, char **new_argv, Lisp_Object current_dir)
   fcntl (outchannel, F_SETFL, O_NONBLOCK);
 
   /* Record this as an active process, with its channels.  */
+  grow_fd_tables (max (inchannel, outchannel));
   chan_process[inchannel] = process;
   p->infd = inchannel;
   p->outfd = outchannel;
@@ -1716,13 +2262,13 @@ create_process (Lisp_Object process, char **new_argv, Lisp_Object current_dir)
   p->pty_flag = pty_flag;
   pset_status (p, Qrun);
 
-  FD_SET (inchannel, &input_wait_mask);
-  FD_SET (inchannel, &non_keyboard_wait_mask);
+  set_fd_waiting (inchannel, INPUT_WAIT | NON_KEYBOARD_WAIT);
   if (inchannel > max_process_desc)
     max_process_desc = inchannel;
 
   /* This may signal an error. */
   setup_process_coding_systems (process);
+  env = make_environment_block (current_dir);
 
   block_input ();
   block_child_signal ();
@@ -1733,6 +2279,7 @@ create_process (Lisp_Object process, char **new_argv, Lisp_Object current_dir)
     Lisp_Object volatile current_dir_volatile = current_dir;
     Lisp_Object volatile lisp_pty_name_volatile = lisp_pty_name;
     char **volatile new_argv_volatile = new_argv;
+    char **volatile env_volatile = env;
     int volatile forkin_volatile = forkin;
     int volatile forkout_volatile = forkout;
     struct Lisp_Process *p_volatile = p;
@@ -1742,6 +2289,7 @@ create_process (Lisp_Object process, char **new_argv, Lisp_Object current_dir)
     current_dir = current_dir_volatile;
     lisp_pty_name = lisp_pty_name_volatile;
     new_argv = new_argv_volatile;
+    env = env_volatile;
     forkin = forkin_volatile;
     forkout = forkout_volatile;
     p = p_volatile;
@@ -1851,9 +2399,11 @@ create_process (Lisp_Object process, char **new_argv, Lisp_Object current_dir)
       if (pty_flag)
 	child_setup_tty (xforkout);
 #ifdef WINDOWSNT
-      pid = child_setup (xforkin, xforkout, xforkout, new_argv, 1, current_dir);
+      pid = child_setup (xforkin, xforkout, xforkout, new_argv, env, 1,
+			 current_dir);
 #else  /* not WINDOWSNT */
-      child_setup (xforkin, xforkout, xforkout, new_argv, 1, current_dir);
+      child_setup (xforkin, xforkout, xforkout, new_argv, env, 1,
+		   current_dir);
 #endif /* not WINDOWSNT */
     }
 
@@ -1932,6 +2482,7 @@ create_pty (Lisp_Object process)
 
       /* Record this as an active process, with its channels.
 	 As a result, child_setup will close Emacs's side of the pipes.  */
+      grow_fd_tables (pty_fd);
       chan_process[pty_fd] = process;
       p->infd = pty_fd;
       p->outfd = pty_fd;
@@ -1945,8 +2496,7 @@ create_pty (Lisp_Object process)
       pset_status (p, Qrun);
       setup_process_coding_systems (process);
 
-      FD_SET (pty_fd, &input_wait_mask);
-      FD_SET (pty_fd, &non_keyboard_wait_mask);
+      set_fd_waiting (pty_fd, INPUT_WAIT | NON_KEYBOARD_WAIT);
       if (pty_fd > max_process_desc)
 	max_process_desc = pty_fd;
 
@@ -2564,6 +3114,7 @@ usage:  (make-serial-process &rest ARGS)  */)
   p->outfd = fd;
   if (fd > max_process_desc)
     max_process_desc = fd;
+  grow_fd_tables (fd);
   chan_process[fd] = proc;
 
   buffer = Fplist_get (contact, QCbuffer);
@@ -2586,8 +3137,7 @@ usage:  (make-serial-process &rest ARGS)  */)
 
   if (!EQ (p->command, Qt))
     {
-      FD_SET (fd, &input_wait_mask);
-      FD_SET (fd, &non_keyboard_wait_mask);
+      set_fd_waiting (fd, INPUT_WAIT | NON_KEYBOARD_WAIT);
     }
 
   if (BUFFERP (buffer))
@@ -3233,6 +3783,9 @@ usage: (make-network-process &rest ARGS)  */)
 	  int sc;
 	  socklen_t len;
 	  fd_set fdset;
+	  /* S may be past the end of an fd_set if we use epoll.  */
+	  if (FD_SETSIZE <= s)
+	    report_file_errno ("Failed select", Qnil, EMFILE);
 	retry_select:
 	  FD_ZERO (&fdset);
 	  FD_SET (s, &fdset);
@@ -3272,6 +3825,7 @@ usage: (make-network-process &rest ARGS)  */)
 
   if (s >= 0)
     {
+      grow_fd_tables (s);
 #ifdef DATAGRAM_SOCKETS
       if (socktype == SOCK_DGRAM)
 	{
@@ -3390,10 +3944,9 @@ usage: (make-network-process &rest ARGS)  */)
 	 in that case, we still need to signal this like a non-blocking
 	 connection.  */
       pset_status (p, Qconnect);
-      if (!FD_ISSET (inch, &connect_wait_mask))
+      if (!fd_waiting_p (inch, CONNECT_WAIT))
 	{
-	  FD_SET (inch, &connect_wait_mask);
-	  FD_SET (inch, &write_mask);
+	  set_fd_waiting (inch, CONNECT_WAIT | WRITE_WAIT);
 	  num_pending_connects++;
 	}
     }
@@ -3404,8 +3957,7 @@ usage: (make-network-process &rest ARGS)  */)
     if ((!EQ (p->filter, Qt) && !EQ (p->command, Qt))
 	|| (EQ (p->status, Qlisten) && NILP (p->command)))
       {
-	FD_SET (inch, &input_wait_mask);
-	FD_SET (inch, &non_keyboard_wait_mask);
+	set_fd_waiting (inch, INPUT_WAIT | NON_KEYBOARD_WAIT);
       }
 
   if (inch > max_process_desc)
@@ -3831,6 +4383,14 @@ deactivate_process (Lisp_Object proc)
     }
 #endif
 
+  /* Whatever is still queued for the process can't be sent now.  */
+  if (p->write_pending)
+    {
+      delete_write_fd (p->outfd);
+      p->write_pending = 0;
+      pset_write_queue (p, Qnil);
+    }
+
   /* Beware SIGCHLD hereabouts. */
 
   for (i = 0; i < PROCESS_OPEN_FDS; i++)
@@ -3850,13 +4410,11 @@ deactivate_process (Lisp_Object proc)
 	}
 #endif
       chan_process[inchannel] = Qnil;
-      FD_CLR (inchannel, &input_wait_mask);
-      FD_CLR (inchannel, &non_keyboard_wait_mask);
+      clear_fd_waiting (inchannel, INPUT_WAIT | NON_KEYBOARD_WAIT);
 #ifdef NON_BLOCKING_CONNECT
-      if (FD_ISSET (inchannel, &connect_wait_mask))
+      if (fd_waiting_p (inchannel, CONNECT_WAIT))
 	{
-	  FD_CLR (inchannel, &connect_wait_mask);
-	  FD_CLR (inchannel, &write_mask);
+	  clear_fd_waiting (inchannel, CONNECT_WAIT | WRITE_WAIT);
 	  if (--num_pending_connects < 0)
 	    emacs_abort ();
 	}
@@ -4087,6 +4645,7 @@ server_accept_connection (Lisp_Object server, int channel)
   name = concat2 (ps->name, caller);
   proc = make_process (name);
 
+  grow_fd_tables (s);
   chan_process[s] = proc;
 
   fcntl (s, F_SETFL, O_NONBLOCK);
@@ -4129,8 +4688,7 @@ server_accept_connection (Lisp_Object server, int channel)
   /* Client processes for accepted connections are not stopped initially.  */
   if (!EQ (p->filter, Qt))
     {
-      FD_SET (s, &input_wait_mask);
-      FD_SET (s, &non_keyboard_wait_mask);
+      set_fd_waiting (s, INPUT_WAIT | NON_KEYBOARD_WAIT);
     }
 
   if (s > max_process_desc)
@@ -4231,9 +4789,8 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 			     Lisp_Object wait_for_cell,
 			     struct Lisp_Process *wait_proc, int just_wait_proc)
 {
-  int channel, nfds;
-  fd_set Available;
-  fd_set Writeok;
+  int channel, nfds, nready, read_set, read_fd, i;
+  struct ready_fd ready[MAX_READY_FDS];
   bool check_write;
   int check_delay;
   bool no_avail;
@@ -4244,9 +4801,6 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
   bool got_some_input = 0;
   ptrdiff_t count = SPECPDL_INDEX ();
 
-  FD_ZERO (&Available);
-  FD_ZERO (&Writeok);
-
   if (time_limit == 0 && nsecs == 0 && wait_proc && !NILP (Vinhibit_quit)
       && !(CONSP (wait_proc->status)
 	   && EQ (XCAR (wait_proc->status), Qexit)))
@@ -4387,25 +4941,15 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 	 timeout to get our attention.  */
       if (update_tick != process_tick)
 	{
-	  fd_set Atemp;
-	  fd_set Ctemp;
-
-          if (kbd_on_hold_p ())
-            FD_ZERO (&Atemp);
-          else
-            Atemp = input_wait_mask;
-	  Ctemp = write_mask;
-
 	  timeout = make_timespec (0, 0);
-	  if ((pselect (max (max_process_desc, max_input_desc) + 1,
-			&Atemp,
+	  if (wait_for_descriptors (kbd_on_hold_p () ? 0 : INPUT_WAIT, -1,
 #ifdef NON_BLOCKING_CONNECT
-			(num_pending_connects > 0 ? &Ctemp : NULL),
+				    num_pending_connects > 0,
 #else
-			NULL,
+				    0,
 #endif
-			NULL, &timeout, NULL)
-	       <= 0))
+				    &timeout, 0, ready)
+	      <= 0)
 	    {
 	      /* It's okay for us to do this and then continue with
 		 the loop, since timeout has already been zeroed out.  */
@@ -4457,23 +5001,22 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 	{
 	  if (wait_proc->infd < 0)  /* Terminated */
 	    break;
-	  FD_SET (wait_proc->infd, &Available);
+	  read_set = 0;
+	  read_fd = wait_proc->infd;
 	  check_delay = 0;
           check_write = 0;
 	}
       else if (!NILP (wait_for_cell))
 	{
-	  Available = non_process_wait_mask;
+	  read_set = NON_PROCESS_WAIT;
+	  read_fd = -1;
 	  check_delay = 0;
 	  check_write = 0;
 	}
       else
 	{
-	  if (! read_kbd)
-	    Available = non_keyboard_wait_mask;
-	  else
-	    Available = input_wait_mask;
-          Writeok = write_mask;
+	  read_set = read_kbd ? INPUT_WAIT : NON_KEYBOARD_WAIT;
+	  read_fd = -1;
 #ifdef SELECT_CANT_DO_WRITE_MASK
           check_write = 0;
 #else
@@ -4533,7 +5076,7 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 		      check_delay--;
 		      if (!XPROCESS (proc)->read_output_skip)
 			continue;
-		      FD_CLR (channel, &Available);
+		      fd_callback_info[channel].skip_tick = output_skip_tick;
 		      XPROCESS (proc)->read_output_skip = 0;
 		      if (XPROCESS (proc)->read_output_delay < nsecs)
 			nsecs = XPROCESS (proc)->read_output_delay;
@@ -4544,17 +5087,8 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 	    }
 #endif
 
-#if defined (HAVE_NS)
-          nfds = ns_select
-#elif defined (HAVE_GLIB)
-	  nfds = xg_select
-#else
-	  nfds = pselect
-#endif
-            (max (max_process_desc, max_input_desc) + 1,
-             &Available,
-             (check_write ? &Writeok : 0),
-             NULL, &timeout, NULL);
+	  nfds = wait_for_descriptors (read_set, read_fd, check_write,
+				       &timeout, 1, ready);
 
 #ifdef HAVE_GNUTLS
           /* GnuTLS buffers data internally.  In lowat mode it leaves
@@ -4571,18 +5105,19 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 		     the gnutls library -- 2.12.14 has been confirmed
 		     to need it.  See
 		     http://comments.gmane.org/gmane.emacs.devel/145074 */
-		  for (channel = 0; channel < FD_SETSIZE; ++channel)
+		  for (channel = 0; channel <= max_process_desc; ++channel)
 		    if (! NILP (chan_process[channel]))
 		      {
 			struct Lisp_Process *p =
 			  XPROCESS (chan_process[channel]);
 			if (p && p->gnutls_p && p->infd
+			    && nfds < MAX_READY_FDS
 			    && ((emacs_gnutls_record_check_pending
 				 (p->gnutls_state))
 				> 0))
 			  {
-			    nfds++;
-			    FD_SET (p->infd, &Available);
+			    ready[nfds].fd = p->infd;
+			    ready[nfds++].condition = FOR_READ;
 			  }
 		      }
 		}
@@ -4597,7 +5132,8 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 		    {
 		      nfds = 1;
 		      /* Set to Available.  */
-		      FD_SET (wait_proc->infd, &Available);
+		      ready[0].fd = wait_proc->infd;
+		      ready[0].condition = FOR_READ;
 		    }
 		}
 	    }
@@ -4605,6 +5141,7 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 	}
 
       xerrno = errno;
+      nready = no_avail ? 0 : max (nfds, 0);
 
       /* Make C-g and alarm signals set flags again */
       clear_waiting_for_input ();
@@ -4627,7 +5164,7 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 
       if (no_avail)
 	{
-	  FD_ZERO (&Available);
+	  nready = 0;
 	  check_write = 0;
 	}
 
@@ -4693,7 +5230,7 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 	 but select says there is input.  */
 
       if (read_kbd && interrupt_input
-	  && keyboard_bit_set (&Available) && ! noninteractive)
+	  && keyboard_bit_set (ready, nready) && ! noninteractive)
 	handle_input_available_signal (SIGIO);
 #endif
 
@@ -4709,22 +5246,19 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
       if (no_avail || nfds == 0)
 	continue;
 
-      for (channel = 0; channel <= max_input_desc; ++channel)
+      for (i = 0; i < nready; i++)
         {
-          struct fd_callback_data *d = &fd_callback_info[channel];
-          if (d->func
-	      && ((d->condition & FOR_READ
-		   && FD_ISSET (channel, &Available))
-		  || (d->condition & FOR_WRITE
-		      && FD_ISSET (channel, &write_mask))))
-            d->func (channel, d->data);
+          struct fd_callback_data *d = &fd_callback_info[ready[i].fd];
+          if (d->func && (d->condition & ready[i].condition))
+            d->func (ready[i].fd, d->data);
 	}
 
-      for (channel = 0; channel <= max_process_desc; channel++)
+      for (i = 0; i < nready; i++)
 	{
-	  if (FD_ISSET (channel, &Available)
-	      && FD_ISSET (channel, &non_keyboard_wait_mask)
-              && !FD_ISSET (channel, &non_process_wait_mask))
+	  channel = ready[i].fd;
+	  if (ready[i].condition & FOR_READ
+	      && fd_waiting_p (channel, NON_KEYBOARD_WAIT)
+              && !fd_waiting_p (channel, NON_PROCESS_WAIT))
 	    {
 	      int nread;
 
@@ -4758,7 +5292,9 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 		     which can call accept-process-output,
 		     don't try to read from any other processes
 		     before doing the select again.  */
-		  FD_ZERO (&Available);
+		  int j;
+		  for (j = i + 1; j < nready; j++)
+		    ready[j].condition &= ~FOR_READ;
 
 		  if (do_display)
 		    redisplay_preserve_echo_area (12);
@@ -4792,8 +5328,7 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 
 		  /* Clear the descriptor now, so we only raise the
 		     signal once.  */
-		  FD_CLR (channel, &input_wait_mask);
-		  FD_CLR (channel, &non_keyboard_wait_mask);
+		  clear_fd_waiting (channel, INPUT_WAIT | NON_KEYBOARD_WAIT);
 
 		  if (p->pid == -2)
 		    {
@@ -4822,13 +5357,12 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 		}
 	    }
 #ifdef NON_BLOCKING_CONNECT
-	  if (FD_ISSET (channel, &Writeok)
-	      && FD_ISSET (channel, &connect_wait_mask))
+	  if (ready[i].condition & FOR_WRITE
+	      && fd_waiting_p (channel, CONNECT_WAIT))
 	    {
 	      struct Lisp_Process *p;
 
-	      FD_CLR (channel, &connect_wait_mask);
-              FD_CLR (channel, &write_mask);
+	      clear_fd_waiting (channel, CONNECT_WAIT | WRITE_WAIT);
 	      if (--num_pending_connects < 0)
 		emacs_abort ();
 
@@ -4878,8 +5412,7 @@ wait_reading_process_output (intmax_t time_limit, int nsecs, int read_kbd,
 		  exec_sentinel (proc, build_string ("open\n"));
 		  if (!EQ (p->filter, Qt) && !EQ (p->command, Qt))
 		    {
-		      FD_SET (p->infd, &input_wait_mask);
-		      FD_SET (p->infd, &non_keyboard_wait_mask);
+		      set_fd_waiting (p->infd, INPUT_WAIT | NON_KEYBOARD_WAIT);
 		    }
 		}
 	    }
@@ -4925,11 +5458,35 @@ read_and_dispose_of_process_output (struct Lisp_Process *p, char *chars,
 				    ssize_t nbytes,
 				    struct coding_system *coding);
 
+/* Output read from a process that is to be decoded straight into its
+   buffer, without making a string of it first.  */
+
+struct process_output
+{
+  struct Lisp_Process *p;
+  char *chars;
+  ssize_t nbytes;
+  struct coding_system *coding;
+};
+
+static void insert_process_output (struct Lisp_Process *, Lisp_Object,
+				   struct process_output *);
+
+static Lisp_Object
+read_process_output_insert (Lisp_Object arg)
+{
+  struct process_output *out = XSAVE_POINTER (arg, 0);
+  insert_process_output (out->p, Qnil, out);
+  return Qnil;
+}
+
 /* Read pending output from the process channel,
    starting with our buffered-ahead character if we have one.
    Yield number of decoded characters read.
 
-   This function reads at most 4096 characters.
+   This function reads at most PROC's read_size bytes.  That starts
+   at READ_PROCESS_OUTPUT_MIN, doubles (up to `read-process-output-max')
+   whenever a read fills it, and halves when reads get much smaller.
    If you want to read all available subprocess output,
    you must call it repeatedly until it returns zero.
 
@@ -4944,11 +5501,12 @@ read_process_output (Lisp_Object proc, register int channel)
   register struct Lisp_Process *p = XPROCESS (proc);
   struct coding_system *coding = proc_decode_coding_system[channel];
   int carryover = p->decoding_carryover;
-  int readmax = 4096;
+  int readmax = max (p->read_size, READ_PROCESS_OUTPUT_MIN);
   ptrdiff_t count = SPECPDL_INDEX ();
   Lisp_Object odeactivate;
+  USE_SAFE_ALLOCA;
 
-  chars = alloca (carryover + readmax);
+  chars = SAFE_ALLOCA (carryover + (ptrdiff_t) readmax);
   if (carryover)
     /* See the comment above.  */
     memcpy (chars, SDATA (p->decoding_buf), carryover);
@@ -5009,6 +5567,21 @@ read_process_output (Lisp_Object proc, register int channel)
       nbytes += buffered && nbytes <= 0;
     }
 
+  if (nbytes > 0)
+    {
+      p->output_reads++;
+      p->output_bytes += nbytes;
+
+      /* Read more at once from processes that produce a lot of
+	 output, and less again once they calm down.  */
+      if (nbytes == readmax && readmax < read_process_output_max)
+	p->read_size = min (min (2 * (EMACS_INT) readmax,
+				 read_process_output_max),
+			    INT_MAX);
+      else if (nbytes < readmax / 4 && READ_PROCESS_OUTPUT_MIN < readmax)
+	p->read_size = readmax / 2;
+    }
+
   p->decoding_carryover = 0;
 
   /* At this point, NBYTES holds number of bytes just received
@@ -5016,7 +5589,10 @@ read_process_output (Lisp_Object proc, register int channel)
   if (nbytes <= 0)
     {
       if (nbytes < 0 || coding->mode & CODING_MODE_LAST_BLOCK)
-	return nbytes;
+	{
+	  SAFE_FREE ();
+	  return nbytes;
+	}
       coding->mode |= CODING_MODE_LAST_BLOCK;
     }
 
@@ -5034,62 +5610,26 @@ read_process_output (Lisp_Object proc, register int channel)
   /* Handling the process output should not deactivate the mark.  */
   Vdeactivate_mark = odeactivate;
 
+  SAFE_FREE ();
   unbind_to (count, Qnil);
   return nbytes;
 }
 
+/* Note that CODING has just been used to decode output from process P,
+   which may have found the coding system to use.  */
+
 static void
-read_and_dispose_of_process_output (struct Lisp_Process *p, char *chars,
-				    ssize_t nbytes,
-				    struct coding_system *coding)
+note_process_decoding (struct Lisp_Process *p, struct coding_system *coding)
 {
-  Lisp_Object outstream = p->filter;
-  Lisp_Object text;
-  bool outer_running_asynch_code = running_asynch_code;
-  int waiting = waiting_for_user_input_p;
+  Vlast_coding_system_used = CODING_ID_NAME (coding->id);
+  /* A new coding system might be found.  */
+  if (!EQ (p->decode_coding_system, Vlast_coding_system_used))
+    {
+      pset_decode_coding_system (p, Vlast_coding_system_used);
 
-  /* No need to gcpro these, because all we do with them later
-     is test them for EQness, and none of them should be a string.  */
-#if 0
-  Lisp_Object obuffer, okeymap;
-  XSETBUFFER (obuffer, current_buffer);
-  okeymap = BVAR (current_buffer, keymap);
-#endif
-
-  /* We inhibit quit here instead of just catching it so that
-     hitting ^G when a filter happens to be running won't screw
-     it up.  */
-  specbind (Qinhibit_quit, Qt);
-  specbind (Qlast_nonmenu_event, Qt);
-
-  /* In case we get recursively called,
-     and we already saved the match data nonrecursively,
-     save the same match data in safely recursive fashion.  */
-  if (outer_running_asynch_code)
-    {
-      Lisp_Object tem;
-      /* Don't clobber the CURRENT match data, either!  */
-      tem = Fmatch_data (Qnil, Qnil, Qnil);
-      restore_search_regs ();
-      record_unwind_save_match_data ();
-      Fset_match_data (tem, Qt);
-    }
-
-  /* For speed, if a search happens within this code,
-     save the match data in a special nonrecursive fashion.  */
-  running_asynch_code = 1;
-
-  decode_coding_c_string (coding, (unsigned char *) chars, nbytes, Qt);
-  text = coding->dst_object;
-  Vlast_coding_system_used = CODING_ID_NAME (coding->id);
-  /* A new coding system might be found.  */
-  if (!EQ (p->decode_coding_system, Vlast_coding_system_used))
-    {
-      pset_decode_coding_system (p, Vlast_coding_system_used);
-
-      /* Don't call setup_coding_system for
-	 proc_decode_coding_system[channel] here.  It is done in
-	 detect_coding called via decode_coding above.  */
+      /* Don't call setup_coding_system for
+	 proc_decode_coding_system[channel] here.  It is done in
+	 detect_coding called via decode_coding above.  */
 
       /* If a coding system for encoding is not yet decided, we set
 	 it as the same as coding-system for decoding.
@@ -5107,6 +5647,73 @@ read_and_dispose_of_process_output (struct Lisp_Process *p, char *chars,
 			       proc_encode_coding_system[p->outfd]);
 	}
     }
+}
+
+/* Call the filter of process P with the decoded output TEXT.  */
+
+static void
+call_process_filter (struct Lisp_Process *p, Lisp_Object text)
+{
+  /* FIXME: It's wrong to wrap or not based on debug-on-error, and
+     sometimes it's simply wrong to wrap (e.g. when called from
+     accept-process-output).  */
+  internal_condition_case_1 (read_process_output_call,
+			     list3 (p->filter, make_lisp_proc (p), text),
+			     !NILP (Vdebug_on_error) ? Qnil : Qerror,
+			     read_process_output_error_handler);
+}
+
+/* Return true if the output of process P is inserted in its buffer
+   by internal-default-process-filter, which has not been redefined or
+   advised, so that what the filter does can be done directly.  */
+
+static bool
+default_filter_p (struct Lisp_Process *p)
+{
+  Lisp_Object function = XSYMBOL (Qinternal_default_process_filter)->function;
+
+  return (EQ (p->filter, Qinternal_default_process_filter)
+	  && SUBRP (function)
+	  && XSUBR (function)->function.a2 == Finternal_default_process_filter);
+}
+
+/* Decode the output CHARS (NBYTES bytes) of process P with CODING and
+   pass it to P's filter.  */
+
+static void
+dispose_of_process_output (struct Lisp_Process *p, char *chars,
+			   ssize_t nbytes, struct coding_system *coding)
+{
+  Lisp_Object text;
+
+  /* When the output just goes into the process buffer, as it does
+     for most processes that produce a lot of it, decode it right into
+     the buffer's gap instead of consing a string that the default
+     filter would only copy there.  Small chunks gain nothing from
+     this.  */
+  if (default_filter_p (p)
+      && nbytes >= READ_PROCESS_OUTPUT_MIN
+      && !NILP (p->buffer) && BUFFER_LIVE_P (XBUFFER (p->buffer)))
+    {
+      struct process_output out;
+
+      out.p = p;
+      out.chars = chars;
+      out.nbytes = nbytes;
+      out.coding = coding;
+      coding->carryover_bytes = 0;
+      internal_condition_case_1 (read_process_output_insert,
+				 make_save_ptr_int (&out, 0),
+				 !NILP (Vdebug_on_error) ? Qnil : Qerror,
+				 read_process_output_error_handler);
+      text = Qnil;
+    }
+  else
+    {
+      decode_coding_c_string (coding, (unsigned char *) chars, nbytes, Qt);
+      text = coding->dst_object;
+    }
+  note_process_decoding (p, coding);
 
   if (coding->carryover_bytes > 0)
     {
@@ -5116,14 +5723,246 @@ read_and_dispose_of_process_output (struct Lisp_Process *p, char *chars,
 	      coding->carryover_bytes);
       p->decoding_carryover = coding->carryover_bytes;
     }
-  if (SBYTES (text) > 0)
-    /* FIXME: It's wrong to wrap or not based on debug-on-error, and
-       sometimes it's simply wrong to wrap (e.g. when called from
-       accept-process-output).  */
-    internal_condition_case_1 (read_process_output_call,
-			       list3 (outstream, make_lisp_proc (p), text),
-			       !NILP (Vdebug_on_error) ? Qnil : Qerror,
-			       read_process_output_error_handler);
+  if (STRINGP (text) && SBYTES (text) > 0)
+    call_process_filter (p, text);
+}
+
+/* Append the output CHARS (NBYTES bytes) of process P to its message
+   buffer.  */
+
+static void
+append_process_message_data (struct Lisp_Process *p, char *chars,
+			     ptrdiff_t nbytes)
+{
+  ptrdiff_t pending = p->message_end - p->message_start;
+  ptrdiff_t size = STRINGP (p->message_buf) ? SBYTES (p->message_buf) : 0;
+
+  if (size - p->message_end < nbytes)
+    {
+      if (size - pending < nbytes)
+	{
+	  /* Grow the buffer geometrically, so that a long message
+	     arriving in many small reads is copied only a few times.  */
+	  Lisp_Object buf;
+	  if (STRING_BYTES_BOUND - pending < nbytes)
+	    string_overflow ();
+	  size = max (pending + nbytes, min (2 * size, STRING_BYTES_BOUND));
+	  size = max (size, READ_PROCESS_OUTPUT_MIN);
+	  buf = make_uninit_string (size);
+	  if (pending)
+	    memcpy (SDATA (buf), SDATA (p->message_buf) + p->message_start,
+		    pending);
+	  pset_message_buf (p, buf);
+	}
+      else
+	memmove (SDATA (p->message_buf),
+		 SDATA (p->message_buf) + p->message_start, pending);
+      p->message_start = 0;
+      p->message_end = pending;
+    }
+  memcpy (SDATA (p->message_buf) + p->message_end, chars, nbytes);
+  p->message_end += nbytes;
+}
+
+/* Return the value of the Content-Length field of the message header
+   in the LEN bytes at HEADER, or -1 if it has no valid one.  */
+
+static ptrdiff_t
+content_length (const unsigned char *header, ptrdiff_t len)
+{
+  static char const field[] = "content-length:";
+  const unsigned char *end = header + len;
+  const unsigned char *line;
+
+  for (line = header; line < end; )
+    {
+      const unsigned char *eol = memchr (line, '\n', end - line);
+      const unsigned char *q = line;
+      int i;
+
+      if (!eol)
+	eol = end;
+      for (i = 0; field[i] && q < eol && c_tolower (*q) == field[i]; i++)
+	q++;
+      if (! field[i])
+	{
+	  ptrdiff_t n = 0;
+	  while (q < eol && (*q == ' ' || *q == '\t'))
+	    q++;
+	  if (! (q < eol && c_isdigit (*q)))
+	    return -1;
+	  for (; q < eol && c_isdigit (*q); q++)
+	    if (INT_MULTIPLY_OVERFLOW (n, 10)
+		|| INT_ADD_OVERFLOW (n * 10, *q - '0'))
+	      return -1;
+	    else
+	      n = n * 10 + *q - '0';
+	  return n;
+	}
+      line = eol + 1;
+    }
+  return -1;
+}
+
+/* Find the next complete message in the output of process P that is
+   waiting in its message buffer.  If there is one, set *BODY and
+   *BODY_LEN to the offset from message_start and the length of its
+   text, and return the number of bytes it takes up in the buffer,
+   header and delimiters included.  Otherwise return 0.  */
+
+static ptrdiff_t
+next_process_message (struct Lisp_Process *p, ptrdiff_t *body,
+		      ptrdiff_t *body_len)
+{
+  unsigned char *data = SDATA (p->message_buf) + p->message_start;
+  ptrdiff_t pending = p->message_end - p->message_start;
+
+  if (EQ (p->message_framing, Qnewline))
+    {
+      unsigned char *nl = memchr (data + p->message_scan, '\n',
+				  pending - p->message_scan);
+      if (!nl)
+	{
+	  p->message_scan = pending;
+	  return 0;
+	}
+      p->message_scan = 0;
+      *body = 0;
+      *body_len = nl - data;
+      return nl - data + 1;
+    }
+
+  if (p->message_size == 0)
+    {
+      /* Look for the empty line that ends the header.  */
+      ptrdiff_t i;
+      for (i = max (p->message_scan, 3); i < pending; i++)
+	if (data[i] == '\n' && data[i - 1] == '\r'
+	    && data[i - 2] == '\n' && data[i - 3] == '\r')
+	  break;
+      if (i >= pending)
+	{
+	  p->message_scan = pending;
+	  return 0;
+	}
+      p->message_scan = 0;
+      p->message_body = i + 1;
+      p->message_size = content_length (data, i + 1);
+      if (p->message_size < 0
+	  || PTRDIFF_MAX - p->message_body < p->message_size)
+	{
+	  /* Pass a header without a usable Content-Length on as it is,
+	     so that the filter at least sees what went wrong.  */
+	  p->message_size = 0;
+	  *body = 0;
+	  *body_len = i + 1;
+	  return i + 1;
+	}
+      p->message_size += p->message_body;
+    }
+
+  if (pending < p->message_size)
+    return 0;
+  *body = p->message_body;
+  *body_len = p->message_size - p->message_body;
+  pending = p->message_size;
+  p->message_size = 0;
+  return pending;
+}
+
+/* Append the output CHARS (NBYTES bytes) of process P to its message
+   buffer, then decode every complete message there with CODING and
+   pass it to P's filter.  If the process has closed its output, pass
+   on what is left as well.  */
+
+static void
+dispose_of_process_messages (struct Lisp_Process *p, char *chars,
+			     ssize_t nbytes, struct coding_system *coding)
+{
+  Lisp_Object framing = p->message_framing;
+  bool eof = (coding->mode & CODING_MODE_LAST_BLOCK) != 0;
+
+  append_process_message_data (p, chars, nbytes);
+
+  /* The filter might change the framing, and reading output while it
+     runs might append to the buffer and take messages from it, so
+     look at P afresh each time around.  */
+  while (EQ (p->message_framing, framing)
+	 && p->message_start < p->message_end)
+    {
+      Lisp_Object buf = p->message_buf;
+      ptrdiff_t body, body_len, from;
+      ptrdiff_t size = next_process_message (p, &body, &body_len);
+
+      if (size == 0)
+	{
+	  if (!eof)
+	    break;
+	  body = 0;
+	  body_len = size = p->message_end - p->message_start;
+	  p->message_scan = p->message_size = 0;
+	}
+
+      from = p->message_start + body;
+      p->message_start += size;
+      if (p->message_start == p->message_end)
+	p->message_start = p->message_end = 0;
+
+      /* Each message is decoded on its own, so it must not leave any
+	 bytes behind for the next one.  */
+      coding->mode |= CODING_MODE_LAST_BLOCK;
+      decode_coding_object (coding, buf, from, from,
+			    from + body_len, from + body_len, Qt);
+      if (!eof)
+	coding->mode &= ~CODING_MODE_LAST_BLOCK;
+      note_process_decoding (p, coding);
+      call_process_filter (p, coding->dst_object);
+    }
+}
+
+static void
+read_and_dispose_of_process_output (struct Lisp_Process *p, char *chars,
+				    ssize_t nbytes,
+				    struct coding_system *coding)
+{
+  bool outer_running_asynch_code = running_asynch_code;
+  int waiting = waiting_for_user_input_p;
+
+  /* No need to gcpro these, because all we do with them later
+     is test them for EQness, and none of them should be a string.  */
+#if 0
+  Lisp_Object obuffer, okeymap;
+  XSETBUFFER (obuffer, current_buffer);
+  okeymap = BVAR (current_buffer, keymap);
+#endif
+
+  /* We inhibit quit here instead of just catching it so that
+     hitting ^G when a filter happens to be running won't screw
+     it up.  */
+  specbind (Qinhibit_quit, Qt);
+  specbind (Qlast_nonmenu_event, Qt);
+
+  /* In case we get recursively called,
+     and we already saved the match data nonrecursively,
+     save the same match data in safely recursive fashion.  */
+  if (outer_running_asynch_code)
+    {
+      Lisp_Object tem;
+      /* Don't clobber the CURRENT match data, either!  */
+      tem = Fmatch_data (Qnil, Qnil, Qnil);
+      restore_search_regs ();
+      record_unwind_save_match_data ();
+      Fset_match_data (tem, Qt);
+    }
+
+  /* For speed, if a search happens within this code,
+     save the match data in a special nonrecursive fashion.  */
+  running_asynch_code = 1;
+
+  if (NILP (p->message_framing))
+    dispose_of_process_output (p, chars, nbytes, coding);
+  else
+    dispose_of_process_messages (p, chars, nbytes, coding);
 
   /* If we saved the match data nonrecursively, restore it now.  */
   restore_search_regs ();
@@ -5151,12 +5990,52 @@ DEFUN ("internal-default-process-filter", Finternal_default_process_filter,
        doc: /* Function used as default process filter.  */)
   (Lisp_Object proc, Lisp_Object text)
 {
-  struct Lisp_Process *p;
-  ptrdiff_t opoint;
-
   CHECK_PROCESS (proc);
-  p = XPROCESS (proc);
   CHECK_STRING (text);
+  insert_process_output (XPROCESS (proc), text, NULL);
+  return Qnil;
+}
+
+/* Decode OUT's bytes into the current buffer at point, as if
+   insert_from_string_before_markers had inserted the decoded text.  */
+
+static void
+decode_process_output (struct process_output *out)
+{
+  ptrdiff_t count = SPECPDL_INDEX ();
+  ptrdiff_t from, from_byte, oz, oz_byte;
+  Lisp_Object curbuf;
+
+  /* Do this first, because the before-change hooks might move point
+     or the gap.  */
+  prepare_to_modify_buffer (PT, PT, NULL);
+  from = PT;
+  from_byte = PT_BYTE;
+  oz = Z;
+  oz_byte = Z_BYTE;
+
+  XSETBUFFER (curbuf, current_buffer);
+  /* As in call-process, the after-change functions must not run
+     while decoding; finish_insert_before_markers runs them.  */
+  specbind (Qinhibit_modification_hooks, Qt);
+  decode_coding_c_string (out->coding, (unsigned char *) out->chars,
+			  out->nbytes, curbuf);
+  unbind_to (count, Qnil);
+
+  TEMP_SET_PT_BOTH (from, from_byte);
+  finish_insert_before_markers (from, from_byte,
+				from + (Z - oz), from_byte + (Z_BYTE - oz_byte));
+}
+
+/* Insert output from process P into its buffer at the process mark,
+   the way `internal-default-process-filter' does.  Insert TEXT if it
+   is a string, otherwise decode OUT's bytes right into the buffer.  */
+
+static void
+insert_process_output (struct Lisp_Process *p, Lisp_Object text,
+		       struct process_output *out)
+{
+  ptrdiff_t opoint;
 
   if (!NILP (p->buffer) && BUFFER_LIVE_P (XBUFFER (p->buffer)))
     {
@@ -5192,16 +6071,21 @@ DEFUN ("internal-default-process-filter", Finternal_default_process_filter,
       if (! (BEGV <= PT && PT <= ZV))
 	Fwiden ();
 
-      /* Adjust the multibyteness of TEXT to that of the buffer.  */
-      if (NILP (BVAR (current_buffer, enable_multibyte_characters))
-	  != ! STRING_MULTIBYTE (text))
-	text = (STRING_MULTIBYTE (text)
-		? Fstring_as_unibyte (text)
-		: Fstring_to_multibyte (text));
-      /* Insert before markers in case we are inserting where
-	 the buffer's mark is, and the user's next command is Meta-y.  */
-      insert_from_string_before_markers (text, 0, 0,
-					 SCHARS (text), SBYTES (text), 0);
+      if (STRINGP (text))
+	{
+	  /* Adjust the multibyteness of TEXT to that of the buffer.  */
+	  if (NILP (BVAR (current_buffer, enable_multibyte_characters))
+	      != ! STRING_MULTIBYTE (text))
+	    text = (STRING_MULTIBYTE (text)
+		    ? Fstring_as_unibyte (text)
+		    : Fstring_to_multibyte (text));
+	  /* Insert before markers in case we are inserting where
+	     the buffer's mark is, and the user's next command is Meta-y.  */
+	  insert_from_string_before_markers (text, 0, 0,
+					     SCHARS (text), SBYTES (text), 0);
+	}
+      else
+	decode_process_output (out);
 
       /* Make sure the process marker's position is valid when the
 	 process buffer is changed in the signal_after_change above.
@@ -5239,7 +6123,6 @@ DEFUN ("internal-default-process-filter", Finternal_default_process_filter,
       bset_read_only (current_buffer, old_read_only);
       SET_PT_BOTH (opoint, opoint_byte);
     }
-  return Qnil;
 }
 
 /* Sending data to subprocess.  */
@@ -5256,7 +6139,12 @@ DEFUN ("internal-default-process-filter", Finternal_default_process_filter,
 
    where STRING is a lisp string, OFFSET is the offset into the
    string's byte sequence from which we should begin to send, and
-   LENGTH is the number of bytes left to send.  */
+   LENGTH is the number of bytes left to send.
+
+   If the process's send_callback is non-nil, send_process does not
+   wait at all: what can't be written right away stays in the
+   write_queue, and send_process_queued sends it when the output
+   descriptor becomes writable.  */
 
 /* Create a new entry in write_queue.
    INPUT_OBJ should be a buffer, string Qt, or Qnil.
@@ -5316,6 +6204,119 @@ write_queue_pop (struct Lisp_Process *p, Lisp_Object *obj,
   return 1;
 }
 
+/* Write up to LEN bytes at BUF to the output descriptor of process
+   PROC.  Return the number of bytes written, or -1 with errno set if
+   nothing could be written.  */
+
+static ptrdiff_t
+write_process_output (Lisp_Object proc, const char *buf, ptrdiff_t len)
+{
+  struct Lisp_Process *p = XPROCESS (proc);
+  ptrdiff_t written;
+  int outfd = p->outfd;
+
+#ifdef DATAGRAM_SOCKETS
+  if (DATAGRAM_CHAN_P (outfd))
+    {
+      ssize_t rv = sendto (outfd, buf, len,
+			   0, datagram_address[outfd].sa,
+			   datagram_address[outfd].len);
+      if (rv < 0 && errno == EMSGSIZE)
+	report_file_error ("Sending datagram", proc);
+      return rv;
+    }
+#endif
+
+#ifdef HAVE_GNUTLS
+  if (p->gnutls_p)
+    written = emacs_gnutls_write (p, buf, len);
+  else
+#endif
+    written = emacs_write_sig (outfd, buf, len);
+#ifdef ADAPTIVE_READ_BUFFERING
+  if (p->read_output_delay > 0
+      && p->adaptive_read_buffering == 1)
+    {
+      p->read_output_delay = 0;
+      process_output_delay_count--;
+      p->read_output_skip = 0;
+    }
+#endif
+  return written ? written : -1;
+}
+
+/* Called by wait_reading_process_output when FD, the output
+   descriptor of the process DATA, becomes writable.  Send as much of
+   the process's write_queue as FD takes.  Once the queue is empty,
+   stop watching FD and call the process's send_callback.  */
+
+static void
+send_process_queued (int fd, void *data)
+{
+  struct Lisp_Process *p = data;
+  Lisp_Object proc, cur_object;
+  const char *cur_buf;
+  ptrdiff_t cur_len;
+
+  XSETPROCESS (proc, p);
+  while (write_queue_pop (p, &cur_object, &cur_buf, &cur_len))
+    while (cur_len > 0)
+      {
+	ptrdiff_t written = write_process_output (proc, cur_buf, cur_len);
+
+	if (written < 0)
+	  {
+	    if (errno == EAGAIN
+#ifdef EWOULDBLOCK
+		|| errno == EWOULDBLOCK
+#endif
+		)
+	      write_queue_push (p, cur_object, cur_buf, cur_len, 1);
+	    else
+	      {
+		/* There is nobody to report the error to here; treat
+		   it as if the process had closed its end.  */
+		p->raw_status_new = 0;
+		pset_status (p, list2 (Qexit, make_number (256)));
+		p->tick = ++process_tick;
+		deactivate_process (proc);
+	      }
+	    return;
+	  }
+	cur_buf += written;
+	cur_len -= written;
+      }
+
+  delete_write_fd (fd);
+  p->write_pending = 0;
+  if (!EQ (p->send_callback, Qt))
+    exec_send_callback (proc);
+}
+
+/* Watch the output descriptor of process P for when the rest of its
+   write_queue can be sent, unless that is already being done.  */
+
+static void
+queue_process_output (struct Lisp_Process *p)
+{
+  if (!p->write_pending)
+    {
+      add_write_fd (p->outfd, send_process_queued, p);
+      p->write_pending = 1;
+    }
+}
+
+/* Wait until everything queued for process PROC has been sent, or
+   the process has gone away.  */
+
+static void
+flush_process_queue (Lisp_Object proc)
+{
+  while (XPROCESS (proc)->write_pending)
+    wait_reading_process_output (0, 20 * 1000 * 1000,
+				 0, 0, Qnil, NULL, 0);
+}
+
 /* Send some data to process PROC.
    BUF is the beginning of the data; LEN is the number of characters.
    OBJECT is the Lisp object that the data comes from.  If OBJECT is
@@ -5324,6 +6325,9 @@ write_queue_pop (struct Lisp_Process *p, Lisp_Object *obj,
    If OBJECT is not nil, the data is encoded by PROC's coding-system
    for encoding before it is sent.
 
+   If PROC's send_callback is non-nil, return as soon as the process
+   stops accepting data, leaving the rest in its write_queue.
+
    This function can evaluate Lisp code and can garbage collect.  */
 
 static void
@@ -5331,7 +6335,6 @@ send_process (Lisp_Object proc, const char *buf, ptrdiff_t len,
 	      Lisp_Object object)
 {
   struct Lisp_Process *p = XPROCESS (proc);
-  ssize_t rv;
   struct coding_system *coding;
 
   if (p->raw_status_new)
@@ -5429,7 +6432,14 @@ send_process (Lisp_Object proc, const char *buf, ptrdiff_t len,
   /* If there is already data in the write_queue, put the new data
      in the back of queue.  Otherwise, ignore it.  */
   if (!NILP (p->write_queue))
-    write_queue_push (p, object, buf, len, 0);
+    {
+      write_queue_push (p, object, buf, len, 0);
+      if (!NILP (p->send_callback))
+	{
+	  queue_process_output (p);
+	  return;
+	}
+    }
 
   do   /* while !NILP (p->write_queue) */
     {
@@ -5448,41 +6458,9 @@ send_process (Lisp_Object proc, const char *buf, ptrdiff_t len,
       while (cur_len > 0)
 	{
 	  /* Send this batch, using one or more write calls.  */
-	  ptrdiff_t written = 0;
-	  int outfd = p->outfd;
-#ifdef DATAGRAM_SOCKETS
-	  if (DATAGRAM_CHAN_P (outfd))
-	    {
-	      rv = sendto (outfd, cur_buf, cur_len,
-			   0, datagram_address[outfd].sa,
-			   datagram_address[outfd].len);
-	      if (rv >= 0)
-		written = rv;
-	      else if (errno == EMSGSIZE)
-		report_file_error ("Sending datagram", proc);
-	    }
-	  else
-#endif
-	    {
-#ifdef HAVE_GNUTLS
-	      if (p->gnutls_p)
-		written = emacs_gnutls_write (p, cur_buf, cur_len);
-	      else
-#endif
-		written = emacs_write_sig (outfd, cur_buf, cur_len);
-	      rv = (written ? 0 : -1);
-#ifdef ADAPTIVE_READ_BUFFERING
-	      if (p->read_output_delay > 0
-		  && p->adaptive_read_buffering == 1)
-		{
-		  p->read_output_delay = 0;
-		  process_output_delay_count--;
-		  p->read_output_skip = 0;
-		}
-#endif
-	    }
+	  ptrdiff_t written = write_process_output (proc, cur_buf, cur_len);
 
-	  if (rv < 0)
+	  if (written < 0)
 	    {
 	      if (errno == EAGAIN
 #ifdef EWOULDBLOCK
@@ -5520,6 +6498,11 @@ send_process (Lisp_Object proc, const char *buf, ptrdiff_t len,
 
 		  /* Put what we should have written in wait_queue.  */
 		  write_queue_push (p, cur_object, cur_buf, cur_len, 1);
+		  if (!NILP (p->send_callback))
+		    {
+		      queue_process_output (p);
+		      return;
+		    }
 		  wait_reading_process_output (0, 20 * 1000 * 1000,
 					       0, 0, Qnil, NULL, 0);
 		  /* Reread queue, to see what is left.  */
@@ -5590,6 +6573,57 @@ Output from processes can arrive in between bunches.  */)
 		SBYTES (string), string);
   return Qnil;
 }
+
+DEFUN ("set-process-nonblocking-send", Fset_process_nonblocking_send,
+       Sset_process_nonblocking_send, 2, 2, 0,
+       doc: /* Control whether sending input to PROCESS may make Emacs wait.
+If CALLBACK is nil, functions such as `process-send-string' and
+`process-send-region' do not return until PROCESS has accepted all of
+the input.  This is the default.
+
+Otherwise, they return as soon as PROCESS stops accepting input, and
+the rest is queued and sent while Emacs waits for input, in the order
+it was given.  Then, if CALLBACK is a function, it is called with
+PROCESS as its argument whenever the queue has been sent in full.
+CALLBACK t means just not to wait.  Use `process-send-queue-size' to
+see how much input is still queued.
+
+Setting CALLBACK to nil waits until the queue has been sent.  */)
+  (Lisp_Object process, Lisp_Object callback)
+{
+  CHECK_PROCESS (process);
+  if (NILP (callback))
+    flush_process_queue (process);
+  pset_send_callback (XPROCESS (process), callback);
+  return callback;
+}
+
+DEFUN ("process-nonblocking-send", Fprocess_nonblocking_send,
+       Sprocess_nonblocking_send, 1, 1, 0,
+       doc: /* Return the send callback of PROCESS.
+See `set-process-nonblocking-send' for more info.  */)
+  (Lisp_Object process)
+{
+  CHECK_PROCESS (process);
+  return XPROCESS (process)->send_callback;
+}
+
+DEFUN ("process-send-queue-size", Fprocess_send_queue_size,
+       Sprocess_send_queue_size, 1, 1, 0,
+       doc: /* Return the number of bytes of input queued for PROCESS.
+This is the input that has been given to PROCESS but that PROCESS has
+not accepted yet; see `set-process-nonblocking-send'.  */)
+  (Lisp_Object process)
+{
+  Lisp_Object tail;
+  EMACS_INT size = 0;
+
+  CHECK_PROCESS (process);
+  for (tail = XPROCESS (process)->write_queue; CONSP (tail);
+       tail = XCDR (tail))
+    size += XINT (XCDR (XCDR (XCAR (tail))));
+  return make_number (size);
+}
 
 /* Return the foreground process group for the tty/pty that
    the process P uses.  */
@@ -5853,8 +6887,7 @@ traffic.  */)
       if (NILP (p->command)
 	  && p->infd >= 0)
 	{
-	  FD_CLR (p->infd, &input_wait_mask);
-	  FD_CLR (p->infd, &non_keyboard_wait_mask);
+	  clear_fd_waiting (p->infd, INPUT_WAIT | NON_KEYBOARD_WAIT);
 	}
       pset_command (p, Qt);
       return process;
@@ -5883,8 +6916,7 @@ traffic.  */)
 	  && p->infd >= 0
 	  && (!EQ (p->filter, Qt) || EQ (p->status, Qlisten)))
 	{
-	  FD_SET (p->infd, &input_wait_mask);
-	  FD_SET (p->infd, &non_keyboard_wait_mask);
+	  set_fd_waiting (p->infd, INPUT_WAIT | NON_KEYBOARD_WAIT);
 #ifdef WINDOWSNT
 	  if (fd_info[ p->infd ].flags & FILE_SERIAL)
 	    PurgeComm (fd_info[ p->infd ].hnd, PURGE_RXABORT | PURGE_RXCLEAR);
@@ -6011,6 +7043,9 @@ process has been transmitted to the serial port.  */)
   if (! EQ (XPROCESS (proc)->status, Qrun))
     error ("Process %s not running", SDATA (XPROCESS (proc)->name));
 
+  /* EOF must come after any input that is still queued.  */
+  flush_process_queue (proc);
+
   if (CODING_REQUIRE_FLUSHING (coding))
     {
       coding->mode |= CODING_MODE_LAST_BLOCK;
@@ -6047,6 +7082,7 @@ process has been transmitted to the serial port.  */)
 	report_file_error ("Opening null device", Qnil);
       XPROCESS (proc)->open_fd[WRITE_TO_SUBPROCESS] = new_outfd;
       XPROCESS (proc)->outfd = new_outfd;
+      grow_fd_tables (new_outfd);
 
       if (!proc_encode_coding_system[new_outfd])
 	proc_encode_coding_system[new_outfd]
@@ -6177,8 +7213,10 @@ handle_child_signal (int sig)
 	      /* clear_desc_flag avoids a compiler bug in Microsoft C.  */
 	      if (clear_desc_flag)
 		{
-		  FD_CLR (p->infd, &input_wait_mask);
-		  FD_CLR (p->infd, &non_keyboard_wait_mask);
+		  /* This is a signal handler, so leave epoll_fd alone;
+		     wait_for_descriptors copes with stale registrations.  */
+		  fd_callback_info[p->infd].waiting
+		    &= ~(INPUT_WAIT | NON_KEYBOARD_WAIT);
 		}
 	    }
 	}
@@ -6209,18 +7247,28 @@ exec_sentinel_error_handler (Lisp_Object error_val)
   return Qt;
 }
 
+static Lisp_Object
+exec_send_callback_error_handler (Lisp_Object error_val)
+{
+  cmd_error_internal (error_val, "error in process send callback: ");
+  Vinhibit_quit = Qt;
+  update_echo_area ();
+  Fsleep_for (make_number (2), Qnil);
+  return Qt;
+}
+
+/* Call FUNCTION with ARGS, a list whose first element is a process,
+   as for a process sentinel.  HANDLER handles errors.  */
+
 static void
-exec_sentinel (Lisp_Object proc, Lisp_Object reason)
+exec_process_function (Lisp_Object function, Lisp_Object args,
+		       Lisp_Object (*handler) (Lisp_Object))
 {
-  Lisp_Object sentinel, odeactivate;
-  struct Lisp_Process *p = XPROCESS (proc);
+  Lisp_Object odeactivate;
   ptrdiff_t count = SPECPDL_INDEX ();
   bool outer_running_asynch_code = running_asynch_code;
   int waiting = waiting_for_user_input_p;
 
-  if (inhibit_sentinels)
-    return;
-
   /* No need to gcpro these, because all we do with them later
      is test them for EQness, and none of them should be a string.  */
   odeactivate = Vdeactivate_mark;
@@ -6235,8 +7283,6 @@ exec_sentinel (Lisp_Object proc, Lisp_Object reason)
      friends don't expect current-buffer to be changed from under them.  */
   record_unwind_current_buffer ();
 
-  sentinel = p->sentinel;
-
   /* Inhibit quit so that random quits don't screw up a running filter.  */
   specbind (Qinhibit_quit, Qt);
   specbind (Qlast_nonmenu_event, Qt); /* Why? --Stef  */
@@ -6258,9 +7304,9 @@ exec_sentinel (Lisp_Object proc, Lisp_Object reason)
   running_asynch_code = 1;
 
   internal_condition_case_1 (read_process_output_call,
-			     list3 (sentinel, proc, reason),
+			     Fcons (function, args),
 			     !NILP (Vdebug_on_error) ? Qnil : Qerror,
-			     exec_sentinel_error_handler);
+			     handler);
 
   /* If we saved the match data nonrecursively, restore it now.  */
   restore_search_regs ();
@@ -6285,6 +7331,25 @@ exec_sentinel (Lisp_Object proc, Lisp_Object reason)
   unbind_to (count, Qnil);
 }
 
+static void
+exec_sentinel (Lisp_Object proc, Lisp_Object reason)
+{
+  if (!inhibit_sentinels)
+    exec_process_function (XPROCESS (proc)->sentinel, list2 (proc, reason),
+			   exec_sentinel_error_handler);
+}
+
+/* Call the send_callback of process PROC, whose write_queue has just
+   been sent.  */
+
+static void
+exec_send_callback (Lisp_Object proc)
+{
+  if (!inhibit_sentinels)
+    exec_process_function (XPROCESS (proc)->send_callback, list1 (proc),
+			   exec_send_callback_error_handler);
+}
+
 /* Report all recent events of a change in process status
    (either run the sentinel or output a message).
    This is usually done while Emacs is waiting for keyboard input
@@ -6517,17 +7582,18 @@ delete_gpm_wait_descriptor (int desc)
 
 # ifdef USABLE_SIGIO
 
-/* Return true if *MASK has a bit set
-   that corresponds to one of the keyboard input descriptors.  */
+/* Return true if one of the NREADY descriptors in READY is a keyboard
+   input descriptor that is ready for reading.  */
 
 static bool
-keyboard_bit_set (fd_set *mask)
+keyboard_bit_set (struct ready_fd *ready, int nready)
 {
-  int fd;
+  int i;
 
-  for (fd = 0; fd <= max_input_desc; fd++)
-    if (FD_ISSET (fd, mask) && FD_ISSET (fd, &input_wait_mask)
-	&& !FD_ISSET (fd, &non_keyboard_wait_mask))
+  for (i = 0; i < nready; i++)
+    if (ready[i].condition & FOR_READ
+	&& fd_waiting_p (ready[i].fd, INPUT_WAIT)
+	&& !fd_waiting_p (ready[i].fd, NON_KEYBOARD_WAIT))
       return 1;
 
   return 0;
@@ -6772,8 +7838,7 @@ void
 add_keyboard_wait_descriptor (int desc)
 {
 #ifdef subprocesses /* actually means "not MSDOS" */
-  FD_SET (desc, &input_wait_mask);
-  FD_SET (desc, &non_process_wait_mask);
+  set_fd_waiting (desc, INPUT_WAIT | NON_PROCESS_WAIT);
   if (desc > max_input_desc)
     max_input_desc = desc;
 #endif
@@ -6785,8 +7850,7 @@ void
 delete_keyboard_wait_descriptor (int desc)
 {
 #ifdef subprocesses
-  FD_CLR (desc, &input_wait_mask);
-  FD_CLR (desc, &non_process_wait_mask);
+  clear_fd_waiting (desc, INPUT_WAIT | NON_PROCESS_WAIT);
   delete_input_desc (desc);
 #endif
 }
@@ -6808,8 +7872,7 @@ setup_process_coding_systems (Lisp_Object process)
   if (!proc_decode_coding_system[inch])
     proc_decode_coding_system[inch] = xmalloc (sizeof (struct coding_system));
   coding_system = p->decode_coding_system;
-  if (EQ (p->filter, Qinternal_default_process_filter)
-      && BUFFERP (p->buffer))
+  if (default_filter_p (p) && BUFFERP (p->buffer))
     {
       if (NILP (BVAR (XBUFFER (p->buffer), enable_multibyte_characters)))
 	coding_system = raw_text_coding_system (coding_system);
@@ -7023,8 +8086,6 @@ void
 init_process_emacs (void)
 {
 #ifdef subprocesses
-  register int i;
-
   inhibit_sentinels = 0;
 
 #ifndef CANNOT_DUMP
@@ -7041,42 +8102,45 @@ init_process_emacs (void)
       catch_child_signal ();
     }
 
-  FD_ZERO (&input_wait_mask);
-  FD_ZERO (&non_keyboard_wait_mask);
-  FD_ZERO (&non_process_wait_mask);
-  FD_ZERO (&write_mask);
   max_process_desc = max_input_desc = -1;
-  memset (fd_callback_info, 0, sizeof (fd_callback_info));
+
+  /* Start with fresh descriptor tables; anything that was allocated
+     before dumping describes descriptors that are long gone.  */
+  fd_tables_size = 0;
+  chan_process = NULL;
+  proc_buffered_char = NULL;
+  proc_decode_coding_system = proc_encode_coding_system = NULL;
+#ifdef DATAGRAM_SOCKETS
+  datagram_address = NULL;
+#endif
+  fd_callback_info = NULL;
+  grow_fd_tables (0);
+
+#ifdef USE_EPOLL
+  epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  epoll_rearm = NULL;
+  epoll_rearm_count = epoll_rearm_size = 0;
+#endif
 
 #ifdef NON_BLOCKING_CONNECT
-  FD_ZERO (&connect_wait_mask);
   num_pending_connects = 0;
 #endif
 
 #ifdef ADAPTIVE_READ_BUFFERING
   process_output_delay_count = 0;
   process_output_skip = 0;
+  output_skip_tick = 1;
 #endif
 
   /* Don't do this, it caused infinite select loops.  The display
      method should call add_keyboard_wait_descriptor on stdin if it
      needs that.  */
 #if 0
-  FD_SET (0, &input_wait_mask);
+  set_fd_waiting (0, INPUT_WAIT);
 #endif
 
   Vprocess_alist = Qnil;
   deleted_pid_list = Qnil;
-  for (i = 0; i < FD_SETSIZE; i++)
-    {
-      chan_process[i] = Qnil;
-      proc_buffered_char[i] = -1;
-    }
-  memset (proc_decode_coding_system, 0, sizeof proc_decode_coding_system);
-  memset (proc_encode_coding_system, 0, sizeof proc_encode_coding_system);
-#ifdef DATAGRAM_SOCKETS
-  memset (datagram_address, 0, sizeof datagram_address);
-#endif
 
  {
    Lisp_Object subfeatures = Qnil;
@@ -7223,6 +8287,8 @@ syms_of_process (void)
   DEFSYM (Qctime, "ctime");
   DEFSYM (Qinternal_default_process_sentinel,
 	  "internal-default-process-sentinel");
+  DEFSYM (Qnewline, "newline");
+  DEFSYM (Qcontent_length, "content-length");
   DEFSYM (Qinternal_default_process_filter,
 	  "internal-default-process-filter");
   DEFSYM (Qpri, "pri");
@@ -7265,6 +8331,18 @@ The variable takes effect when `start-process' is called.  */);
   Vprocess_adaptive_read_buffering = Qt;
 #endif
 
+  DEFVAR_INT ("read-process-output-max", read_process_output_max,
+	      doc: /* Maximum number of bytes to read from a subprocess in one go.
+Emacs starts out reading 4096 bytes at a time from each subprocess, and
+reads twice as much at once whenever a read fills the whole buffer, up
+to this many bytes.  Larger values make processes that produce a lot of
+output, such as compilations and `shell-command' with big outputs,
+faster to read from, at the expense of more memory in use while reading.
+Values smaller than 4096 mean to always read 4096 bytes at a time.
+`call-process' likewise reads up to this many bytes at once, but no
+fewer than 16384.  */);
+  read_process_output_max = 1024 * 1024;
+
   defsubr (&Sprocessp);
   defsubr (&Sget_process);
   defsubr (&Sdelete_process);
@@ -7279,6 +8357,8 @@ The variable takes effect when `start-process' is called.  */);
   defsubr (&Sprocess_mark);
   defsubr (&Sset_process_filter);
   defsubr (&Sprocess_filter);
+  defsubr (&Sset_process_message_framing);
+  defsubr (&Sprocess_message_framing);
   defsubr (&Sset_process_sentinel);
   defsubr (&Sprocess_sentinel);
   defsubr (&Sset_process_window_size);
@@ -7310,6 +8390,9 @@ The variable takes effect when `start-process' is called.  */);
   defsubr (&Saccept_process_output);
   defsubr (&Sprocess_send_region);
   defsubr (&Sprocess_send_string);
+  defsubr (&Sset_process_nonblocking_send);
+  defsubr (&Sprocess_nonblocking_send);
+  defsubr (&Sprocess_send_queue_size);
   defsubr (&Sinterrupt_process);
   defsubr (&Skill_process);
   defsubr (&Squit_process);
@@ -7320,6 +8403,7 @@ The variable takes effect when `start-process' is called.  */);
   defsubr (&Ssignal_process);
   defsubr (&Swaiting_for_user_input_p);
   defsubr (&Sprocess_type);
+  defsubr (&Sprocess_output_statistics);
   defsubr (&Sinternal_default_process_sentinel);
   defsubr (&Sinternal_default_process_filter);
   defsubr (&Sset_process_coding_system);
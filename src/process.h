@@ -104,6 +104,19 @@ struct Lisp_Process
     /* Queue for storing waiting writes */
     Lisp_Object write_queue;
 
+    /* How to split the output into messages for the filter: nil,
+       `newline' or `content-length'.  */
+    Lisp_Object message_framing;
+
+    /* Unibyte string holding output that does not make up a whole
+       message yet; see message_start.  */
+    Lisp_Object message_buf;
+
+    /* Non-nil if sending to this process must not wait for the
+       process to accept the data; the function to call when the
+       write_queue drains, or t.  */
+    Lisp_Object send_callback;
+
 #ifdef HAVE_GNUTLS
     Lisp_Object gnutls_cred_type;
 #endif
@@ -129,6 +142,21 @@ struct Lisp_Process
     EMACS_INT update_tick;
     /* Size of carryover in decoding.  */
     int decoding_carryover;
+    /* Number of bytes to ask for when reading output from this
+       process; zero means READ_PROCESS_OUTPUT_MIN.  See
+       read_process_output.  */
+    int read_size;
+    /* Number of reads that got output from this process, and the
+       number of bytes they got.  */
+    EMACS_INT output_reads;
+    EMACS_INT output_bytes;
+    /* The bytes of message_buf from message_start to message_end have
+       not been passed to the filter yet.  The first message_scan of
+       them have been searched in vain for the end of a line or header.
+       Once a Content-Length header has been parsed, message_body is
+       its length and message_size that of the whole message.  */
+    ptrdiff_t message_start, message_end, message_scan;
+    ptrdiff_t message_body, message_size;
     /* Hysteresis to try to read process output in larger blocks.
        On some systems, e.g. GNU/Linux, Emacs is seen as
        an interactive app also when reading process output, meaning
@@ -158,6 +186,9 @@ struct Lisp_Process
        flag indicates that `raw_status' contains a new status that still
        needs to be synced to `status'.  */
     unsigned int raw_status_new : 1;
+    /* True if the output descriptor is being watched for when the
+       write_queue can be sent; see send_process_queued.  */
+    unsigned int write_pending : 1;
     int raw_status;
 
 #ifdef HAVE_GNUTLS
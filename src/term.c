@@ -2509,7 +2509,7 @@ term_mouse_movement (struct frame *frame, Gpm_Event *event)
   /* Has the mouse moved off the glyph it was on at the last sighting?  */
   if (event->x != last_mouse_x || event->y != last_mouse_y)
     {
-      frame->mouse_moved = 1;
+      note_mouse_moved (frame);
       note_mouse_highlight (frame, event->x, event->y);
       /* Remember which glyph we're now on.  */
       last_mouse_x = event->x;
@@ -425,7 +425,7 @@ mouse_moved_to (int x, int y)
   /* If we're in the same place, ignore it.  */
   if (x != movement_pos.X || y != movement_pos.Y)
     {
-      SELECTED_FRAME ()->mouse_moved = 1;
+      note_mouse_moved (SELECTED_FRAME ());
       movement_pos.X = x;
       movement_pos.Y = y;
       movement_time = GetTickCount ();
@@ -3325,7 +3325,7 @@ note_mouse_movement (struct frame *frame, MSG *msg)
 
   if (msg->hwnd != FRAME_W32_WINDOW (frame))
     {
-      frame->mouse_moved = 1;
+      note_mouse_moved (frame);
       last_mouse_scroll_bar = Qnil;
       note_mouse_highlight (frame, -1, -1);
       last_mouse_glyph_frame = 0;
@@ -3339,7 +3339,7 @@ note_mouse_movement (struct frame *frame, MSG *msg)
       || mouse_y < last_mouse_glyph.top
       || mouse_y >= last_mouse_glyph.bottom)
     {
-      frame->mouse_moved = 1;
+      note_mouse_moved (frame);
       last_mouse_scroll_bar = Qnil;
       note_mouse_highlight (frame, mouse_x, mouse_y);
       /* Remember the mouse position here, as w32_mouse_position only
@@ -272,7 +272,7 @@ along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.  */
    buffer_posn_from_coords in dispnew.c for how this is handled.  */
 
 #include <config.h>
-#include <stdio.h>
+#include "sysstdio.h"
 #include <limits.h>
 
 #include "lisp.h"
@@ -342,6 +342,12 @@ static Lisp_Object Qwrap_prefix;
 static Lisp_Object Qline_prefix;
 static Lisp_Object Qredisplay_internal;
 
+/* Names of redisplay methods in the redisplay profile.  */
+
+static Lisp_Object Qthis_line, Qcursor_in_line, Qunchanged;
+static Lisp_Object Qcursor_movement, Qtry_window_id, Qreuse_current_matrix;
+static Lisp_Object Qtry_window, Qforced_start, Qscrolling, Qrecenter;
+
 /* Non-nil means don't actually do any redisplay.  */
 
 Lisp_Object Qinhibit_redisplay;
@@ -516,6 +522,11 @@ int update_mode_lines;
 
 int windows_or_buffers_changed;
 
+/* Incremented by each redisplay, which makes the glyph rows that
+   earlier redisplays offered for sharing between windows obsolete.  */
+
+static EMACS_UINT shared_rows_generation;
+
 /* Nonzero after display_mode_line if %l was used and it displayed a
    line number.  */
 
@@ -742,6 +753,17 @@ ptrdiff_t help_echo_pos;
 
 Lisp_Object previous_help_echo_string;
 
+/* The text glyph under the mouse when note_mouse_highlight last
+   computed mouse highlighting and help echo, or null if the display
+   has changed since.  While the mouse stays on that glyph, the help
+   echo found there is reused instead of being computed again.  */
+
+struct glyph *mouse_highlight_glyph;
+static Lisp_Object mouse_highlight_help_string;
+static Lisp_Object mouse_highlight_help_window;
+static Lisp_Object mouse_highlight_help_object;
+static ptrdiff_t mouse_highlight_help_pos;
+
 /* Platform-independent portion of hourglass implementation. */
 
 #ifdef HAVE_WINDOW_SYSTEM
@@ -868,6 +890,7 @@ static void reseat (struct it *, struct text_pos, int);
 static void reseat_1 (struct it *, struct text_pos, int);
 static void back_to_previous_visible_line_start (struct it *);
 static void reseat_at_next_visible_line_start (struct it *, int);
+static void line_checkpoint_bidi_start (struct it *, ptrdiff_t *, ptrdiff_t *);
 static int next_element_from_ellipsis (struct it *);
 static int next_element_from_display_vector (struct it *);
 static int next_element_from_string (struct it *);
@@ -2989,9 +3012,13 @@ start_display (struct it *it, struct window *w, struct text_pos pos)
       if (!start_at_line_beg_p)
 	{
 	  int new_x;
+	  ptrdiff_t row, count = SPECPDL_INDEX ();
 
 	  reseat_at_previous_visible_line_start (it);
+	  row = restore_line_checkpoint (it, CHARPOS (pos), 0);
+	  record_line_checkpoints (it, row);
 	  move_it_to (it, CHARPOS (pos), -1, -1, -1, MOVE_TO_POS);
+	  unbind_to (count, Qnil);
 
 	  new_x = it->current_x + it->pixel_width;
 
@@ -3677,6 +3704,12 @@ compute_display_string_end (ptrdiff_t charpos, struct bidi_string_data *string)
 			    Fontification
  ***********************************************************************/
 
+/* The windows in which handle_fontified_prop left text unfontified
+   because input was pending.  The next redisplay must not reuse glyphs
+   produced from that text in them.  */
+
+static Lisp_Object fontification_skipped_windows;
+
 /* Handle changes in the `fontified' property of the current buffer by
    calling hook functions from Qfontification_functions to fontify
    regions of text.  */
@@ -3709,6 +3742,21 @@ handle_fontified_prop (struct it *it)
       struct buffer *obuf = current_buffer;
       int begv = BEGV, zv = ZV;
       int old_clip_changed = current_buffer->clip_changed;
+      struct timespec start;
+
+      /* Fontifying can take long enough for the user to notice.
+	 Leave the text alone if the user is waiting for Emacs; it is
+	 fontified when it is displayed again.  */
+      if (redisplay_skip_fontification_on_input
+	  && detect_input_pending ())
+	{
+	  if (NILP (Fmemq (it->window, fontification_skipped_windows)))
+	    fontification_skipped_windows
+	      = Fcons (it->window, fontification_skipped_windows);
+	  return handled;
+	}
+
+      start = REDISPLAY_PHASE_START ();
 
       val = Vfontification_functions;
       specbind (Qfontification_functions, Qnil);
@@ -3753,6 +3801,7 @@ handle_fontified_prop (struct it *it)
 	}
 
       unbind_to (count, Qnil);
+      REDISPLAY_PHASE_END (it->w, REDISPLAY_PHASE_FONTIFICATION, start);
 
       /* Fontification functions routinely call `save-restriction'.
 	 Normally, this tags clip_changed, which can confuse redisplay
@@ -7628,9 +7677,14 @@ get_visually_first_element (struct it *it)
       if (string_p)
 	it->bidi_it.charpos = it->bidi_it.bytepos = 0;
       else
-	it->bidi_it.charpos = find_newline_no_quit (IT_CHARPOS (*it),
-						    IT_BYTEPOS (*it), -1,
-						    &it->bidi_it.bytepos);
+	{
+	  it->bidi_it.charpos = find_newline_no_quit (IT_CHARPOS (*it),
+						      IT_BYTEPOS (*it), -1,
+						      &it->bidi_it.bytepos);
+	  /* In a long line, start closer to IT's position if we can.  */
+	  line_checkpoint_bidi_start (it, &it->bidi_it.charpos,
+				      &it->bidi_it.bytepos);
+	}
       bidi_paragraph_init (it->paragraph_embedding, &it->bidi_it, 1);
       do
 	{
@@ -8899,6 +8953,481 @@ move_it_in_display_line (struct it *it,
 }
 
 
+/***********************************************************************
+			 Long line checkpoints
+ ***********************************************************************/
+
+/* To find out where the display lines of a continued line start,
+   the move_it_* functions have to lay out the line from its
+   beginning.  In a line several megabytes long that makes every
+   redisplay and vertical motion near the end of the line take
+   seconds.  To avoid that, while moving through a long line we
+   remember the starts of some of its display lines, and later start
+   from the closest remembered one instead of from the beginning of
+   the line.
+
+   A checkpoint is only usable as long as nothing the layout of the
+   line depends on has changed, so each set of checkpoints records
+   those things and is emptied when one of them differs.  */
+
+/* Record a checkpoint at most every this many display lines.  */
+
+#define LINE_CHECKPOINT_INTERVAL 16
+
+/* Don't bother with checkpoints when moving less than this many
+   characters into a line.  */
+
+#define LINE_CHECKPOINT_MIN_CHARS 8000
+
+/* Number of lines for which checkpoints are remembered.  */
+
+#define N_LINE_CHECKPOINTS 4
+
+struct line_checkpoint
+{
+  /* Position of the first character of a display line.  */
+  ptrdiff_t charpos, bytepos;
+
+  /* Number of display lines between the start of the line and this
+     one.  */
+  ptrdiff_t row;
+
+  /* The value of it->continuation_lines_width there.  */
+  int continuation_lines_width;
+};
+
+struct line_checkpoints
+{
+  /* The window and buffer displaying the line, and the line's
+     start.  */
+  struct window *w;
+  struct buffer *buffer;
+  ptrdiff_t line_start;
+
+  /* What the layout of the line depends on.  The Lisp objects here
+     and the window and buffer above are kept from being collected
+     through line_checkpoint_owners.  */
+  EMACS_INT modiff, overlay_modiff;
+  ptrdiff_t begv;
+  int face_change_count;
+  struct frame *f;
+  int first_visible_x, last_visible_x;
+  ptrdiff_t selective;
+  short tab_width;
+  enum line_wrap_method line_wrap;
+  bidi_dir_t paragraph_embedding;
+  int base_face_id;
+  bool multibyte_p, bidi_p, ctl_arrow_p;
+
+  /* Copies of these lists and of the display table, since they can be
+     changed in place.  */
+  Lisp_Object invisibility_spec, face_remapping_alist, display_table;
+
+  /* The values of wrap-prefix and line-prefix.  Prefixes from text
+     properties and overlays are covered by modiff and overlay_modiff.  */
+  Lisp_Object wrap_prefix, line_prefix;
+
+  /* The checkpoints, in increasing order of position.  */
+  struct line_checkpoint *checkpoints;
+  ptrdiff_t n, size;
+
+  /* Value of line_checkpoints_clock when last used.  */
+  EMACS_UINT used;
+};
+
+static struct line_checkpoints line_checkpoints[N_LINE_CHECKPOINTS];
+static EMACS_UINT line_checkpoints_clock;
+
+/* A vector holding the window, the buffer and the Lisp objects of
+   each element of line_checkpoints, so that they are not freed while
+   in use.  */
+
+static Lisp_Object line_checkpoint_owners;
+
+/* Number of elements of line_checkpoint_owners per element of
+   line_checkpoints.  */
+
+#define LINE_CHECKPOINT_OWNERS 7
+
+/* Store OBJ as the Ith owner of LC.  */
+
+static void
+set_line_checkpoint_owner (struct line_checkpoints *lc, int i,
+			   Lisp_Object obj)
+{
+  ASET (line_checkpoint_owners,
+	LINE_CHECKPOINT_OWNERS * (lc - line_checkpoints) + i, obj);
+}
+
+/* Return a copy of LIST that shares no conses with it.  If ELEMENTS,
+   copy the elements that are lists too.  face-remap.el and
+   remove-from-invisibility-spec modify such lists in place.  */
+
+static Lisp_Object
+copy_layout_list (Lisp_Object list, bool elements)
+{
+  Lisp_Object copy, tail;
+
+  if (!CONSP (list))
+    return list;
+  copy = tail = Fcons (elements ? copy_layout_list (XCAR (list), 0)
+		       : XCAR (list), Qnil);
+  for (list = XCDR (list); CONSP (list); list = XCDR (list))
+    {
+      Lisp_Object cell = Fcons (elements ? copy_layout_list (XCAR (list), 0)
+				: XCAR (list), Qnil);
+      XSETCDR (tail, cell);
+      tail = cell;
+    }
+  XSETCDR (tail, list);
+  return copy;
+}
+
+/* The iterator for which move_it_to records checkpoints, if any, the
+   checkpoints it records them in, and the value its vpos had at the
+   start of the line.  */
+
+static struct
+{
+  struct it *it;
+  struct line_checkpoints *lc;
+  ptrdiff_t vpos0;
+} line_checkpoint_recorder;
+
+/* Value is IT's display table, or nil if it has none.  */
+
+static Lisp_Object
+display_table_object (struct it *it)
+{
+  Lisp_Object dp = Qnil;
+
+  if (it->dp)
+    XSETCHAR_TABLE (dp, it->dp);
+  return dp;
+}
+
+/* Set the layout description of LC from IT and the current buffer.
+   If ASSIGN is false, just return whether it is still the same.
+   Buffer modifications are handled by discard_changed_line_checkpoints.  */
+
+static bool
+line_checkpoints_layout (struct line_checkpoints *lc, struct it *it,
+			 bool assign)
+{
+  Lisp_Object spec = BVAR (current_buffer, invisibility_spec);
+
+  if (!assign)
+    return (lc->begv == BEGV
+	    && lc->face_change_count == face_change_count
+	    && lc->f == it->f
+	    && lc->first_visible_x == it->first_visible_x
+	    && lc->last_visible_x == it->last_visible_x
+	    && lc->selective == it->selective
+	    && lc->tab_width == it->tab_width
+	    && lc->line_wrap == it->line_wrap
+	    && lc->paragraph_embedding == it->paragraph_embedding
+	    && lc->base_face_id == it->base_face_id
+	    && lc->multibyte_p == it->multibyte_p
+	    && lc->bidi_p == it->bidi_p
+	    && lc->ctl_arrow_p == it->ctl_arrow_p
+	    && EQ (lc->wrap_prefix, Vwrap_prefix)
+	    && EQ (lc->line_prefix, Vline_prefix)
+	    && !NILP (Fequal (lc->invisibility_spec, spec))
+	    && !NILP (Fequal (lc->face_remapping_alist,
+			      Vface_remapping_alist))
+	    && !NILP (Fequal (lc->display_table,
+			      display_table_object (it))));
+
+  lc->modiff = BUF_MODIFF (current_buffer);
+  lc->overlay_modiff = BUF_OVERLAY_MODIFF (current_buffer);
+  lc->begv = BEGV;
+  lc->face_change_count = face_change_count;
+  lc->f = it->f;
+  lc->first_visible_x = it->first_visible_x;
+  lc->last_visible_x = it->last_visible_x;
+  lc->selective = it->selective;
+  lc->tab_width = it->tab_width;
+  lc->line_wrap = it->line_wrap;
+  lc->paragraph_embedding = it->paragraph_embedding;
+  lc->base_face_id = it->base_face_id;
+  lc->multibyte_p = it->multibyte_p;
+  lc->bidi_p = it->bidi_p;
+  lc->ctl_arrow_p = it->ctl_arrow_p;
+  lc->wrap_prefix = Vwrap_prefix;
+  lc->line_prefix = Vline_prefix;
+  set_line_checkpoint_owner (lc, 2, lc->wrap_prefix);
+  set_line_checkpoint_owner (lc, 3, lc->line_prefix);
+  lc->invisibility_spec = copy_layout_list (spec, 1);
+  set_line_checkpoint_owner (lc, 4, lc->invisibility_spec);
+  lc->face_remapping_alist = copy_layout_list (Vface_remapping_alist, 1);
+  set_line_checkpoint_owner (lc, 5, lc->face_remapping_alist);
+  lc->display_table = Fcopy_sequence (display_table_object (it));
+  set_line_checkpoint_owner (lc, 6, lc->display_table);
+  lc->n = 0;
+  return true;
+}
+
+/* Discard the checkpoints of LC that changes to the current buffer
+   since they were recorded may have made wrong.  Value is the
+   position of the first change, or ZV if there was none.  */
+
+static ptrdiff_t
+discard_changed_line_checkpoints (struct line_checkpoints *lc)
+{
+  struct buffer *b = current_buffer;
+  ptrdiff_t changed = BEGV, n = 0;
+
+  if (lc->modiff == BUF_MODIFF (b)
+      && lc->overlay_modiff == BUF_OVERLAY_MODIFF (b))
+    return ZV;
+
+  /* If redisplay has not reset the unchanged text information since
+     the checkpoints were recorded, it covers all the changes made
+     since then.  The last checkpoint before the first change goes
+     too, because the change can affect where its display line ends.  */
+  if (lc->modiff >= BUF_UNCHANGED_MODIFIED (b)
+      && lc->overlay_modiff >= BUF_OVERLAY_UNCHANGED_MODIFIED (b))
+    {
+      changed = BUF_BEG (b) + BUF_BEG_UNCHANGED (b);
+      while (n < lc->n && lc->checkpoints[n].charpos < changed)
+	n++;
+      if (n > 0)
+	n--;
+    }
+
+  lc->n = n;
+  lc->modiff = BUF_MODIFF (b);
+  lc->overlay_modiff = BUF_OVERLAY_MODIFF (b);
+  return changed;
+}
+
+/* Return the checkpoints of the line starting at IT's position,
+   creating them if necessary.  */
+
+static struct line_checkpoints *
+get_line_checkpoints (struct it *it)
+{
+  struct line_checkpoints *lc, *lru = line_checkpoints;
+  ptrdiff_t line_start = IT_CHARPOS (*it);
+  int i;
+
+  for (i = 0; i < N_LINE_CHECKPOINTS; i++)
+    {
+      lc = line_checkpoints + i;
+      if (lc->w == it->w && lc->buffer == current_buffer
+	  && lc->line_start == line_start)
+	{
+	  if (!line_checkpoints_layout (lc, it, 0))
+	    line_checkpoints_layout (lc, it, 1);
+	  else
+	    discard_changed_line_checkpoints (lc);
+	  lc->used = ++line_checkpoints_clock;
+	  return lc;
+	}
+      if (lc->used < lru->used)
+	lru = lc;
+    }
+
+  lc = lru;
+  lc->w = it->w;
+  lc->buffer = current_buffer;
+  lc->line_start = line_start;
+  set_line_checkpoint_owner (lc, 0, it->window);
+  set_line_checkpoint_owner (lc, 1, it->w->contents);
+  line_checkpoints_layout (lc, it, 1);
+  lc->used = ++line_checkpoints_clock;
+  return lc;
+}
+
+/* IT is at the start of a line, and is about to be moved forward to
+   CHARPOS.  If there is a checkpoint before CHARPOS with at least
+   ROWS_BACK display lines between the two, move IT to the last such
+   checkpoint.  Return the number of display lines between the start
+   of the line and IT's position, for record_line_checkpoints, or -1
+   if checkpoints are not used for this move.  */
+
+ptrdiff_t
+restore_line_checkpoint (struct it *it, ptrdiff_t charpos,
+			 ptrdiff_t rows_back)
+{
+  struct line_checkpoints *lc;
+  struct line_checkpoint *cp;
+  ptrdiff_t lo, hi, min_row;
+  struct text_pos pos;
+
+  line_checkpoint_recorder.lc = NULL;
+  if (it->method != GET_FROM_BUFFER
+      || it->line_wrap == TRUNCATE
+      || it->current_x != 0
+      || it->continuation_lines_width != 0
+      || !EQ (it->object, it->w->contents)
+      || XBUFFER (it->object) != current_buffer
+      || charpos - IT_CHARPOS (*it) < LINE_CHECKPOINT_MIN_CHARS)
+    return -1;
+
+  lc = line_checkpoint_recorder.lc = get_line_checkpoints (it);
+
+  /* Find the last checkpoint before CHARPOS.  */
+  lo = 0, hi = lc->n;
+  while (lo < hi)
+    {
+      ptrdiff_t mid = lo + (hi - lo) / 2;
+      if (lc->checkpoints[mid].charpos < charpos)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  if (lo == 0)
+    return 0;
+
+  /* CHARPOS is at least that checkpoint's row of display lines into
+     the line; go back far enough to leave ROWS_BACK lines before it.  */
+  cp = lc->checkpoints + lo - 1;
+  min_row = cp->row - rows_back;
+  while (cp->row > min_row)
+    {
+      if (cp == lc->checkpoints)
+	return 0;
+      cp--;
+    }
+
+  SET_TEXT_POS (pos, cp->charpos, cp->bytepos);
+  reseat (it, pos, 1);
+  it->continuation_lines_width = cp->continuation_lines_width;
+  return cp->row;
+}
+
+/* Stop recording checkpoints.  */
+
+static void
+stop_line_checkpoints (void)
+{
+  line_checkpoint_recorder.it = NULL;
+  line_checkpoint_recorder.lc = NULL;
+}
+
+/* Record checkpoints in the line last passed to
+   restore_line_checkpoint while move_it_to moves IT, which is ROW
+   display lines into that line.  Don't record anything if ROW is
+   negative.  Recording stops when the specpdl is unwound, so that a
+   quit or throw out of move_it_to cannot leave a pointer to IT, which
+   is usually on the stack, behind.  */
+
+void
+record_line_checkpoints (struct it *it, ptrdiff_t row)
+{
+  record_unwind_protect_void (stop_line_checkpoints);
+  if (row >= 0 && line_checkpoint_recorder.lc)
+    {
+      line_checkpoint_recorder.it = it;
+      line_checkpoint_recorder.vpos0 = it->vpos - row;
+    }
+  else
+    line_checkpoint_recorder.it = NULL;
+}
+
+/* IT's bidi iterator is about to be primed by iterating from
+   *CHARPOS, the start of IT's line, to IT's position.  If a checkpoint
+   of that line lets it start closer to that position, store where in
+   *CHARPOS and *BYTEPOS.  */
+
+static void
+line_checkpoint_bidi_start (struct it *it, ptrdiff_t *charpos,
+			    ptrdiff_t *bytepos)
+{
+  ptrdiff_t pos = IT_CHARPOS (*it);
+  int i;
+
+  if (pos - *charpos < LINE_CHECKPOINT_MIN_CHARS || !it->multibyte_p)
+    return;
+
+  for (i = 0; i < N_LINE_CHECKPOINTS; i++)
+    {
+      struct line_checkpoints *lc = line_checkpoints + i;
+      struct line_checkpoint *cp;
+      ptrdiff_t lo, hi, start, start_byte;
+
+      if (lc->w != it->w
+	  || lc->buffer != current_buffer
+	  || lc->line_start != *charpos
+	  || !lc->bidi_p
+	  || !line_checkpoints_layout (lc, it, 0))
+	continue;
+
+      discard_changed_line_checkpoints (lc);
+      lo = 0, hi = lc->n;
+      while (lo < hi)
+	{
+	  ptrdiff_t mid = lo + (hi - lo) / 2;
+	  if (lc->checkpoints[mid].charpos <= pos)
+	    lo = mid + 1;
+	  else
+	    hi = mid;
+	}
+      if (lo == 0)
+	return;
+
+      /* Checkpoints are at the base level of a left-to-right
+	 paragraph, so the UBA can be restarted near one; but not
+	 inside text covered by a display property.  */
+      cp = lc->checkpoints + lo - 1;
+      start = bidi_find_restart_position (cp->charpos, cp->bytepos,
+					  max (*charpos, cp->charpos - 1000),
+					  &start_byte);
+      if (start > *charpos
+	  && NILP (Fget_char_property (make_number (start - 1), Qdisplay,
+				       it->window)))
+	{
+	  *charpos = start;
+	  *bytepos = start_byte;
+	}
+      return;
+    }
+}
+
+/* Called by move_it_to when IT has been moved to the start of a
+   continuation line.  Remember that position if it is far enough
+   from the last checkpoint, and if the display line can be laid out
+   by starting from there.  */
+
+static void
+note_line_checkpoint (struct it *it)
+{
+  struct line_checkpoints *lc = line_checkpoint_recorder.lc;
+  ptrdiff_t row = it->vpos - line_checkpoint_recorder.vpos0;
+  struct line_checkpoint *last;
+
+  /* Fontification may have changed the buffer while IT moved.  That
+     is harmless if it happened after IT's position.  */
+  if (discard_changed_line_checkpoints (lc) < IT_CHARPOS (*it))
+    {
+      line_checkpoint_recorder.it = NULL;
+      return;
+    }
+
+  last = lc->n ? lc->checkpoints + lc->n - 1 : NULL;
+  if (row < (last ? last->row : 0) + LINE_CHECKPOINT_INTERVAL
+      || (last && IT_CHARPOS (*it) <= last->charpos)
+      || it->method != GET_FROM_BUFFER
+      || it->current.dpvec_index >= 0
+      || it->current.overlay_string_index >= 0
+      || (it->bidi_p
+	  && (it->bidi_it.paragraph_dir != L2R
+	      || it->bidi_it.resolved_level != 0))
+      || overlay_touches_p (IT_CHARPOS (*it)))
+    return;
+
+  if (lc->n == lc->size)
+    lc->checkpoints = xpalloc (lc->checkpoints, &lc->size, 1, -1,
+			       sizeof *lc->checkpoints);
+  last = lc->checkpoints + lc->n++;
+  last->charpos = IT_CHARPOS (*it);
+  last->bytepos = IT_BYTEPOS (*it);
+  last->row = row;
+  last->continuation_lines_width = it->continuation_lines_width;
+}
+
+
 /* Move IT forward until it satisfies one or more of the criteria in
    TO_CHARPOS, TO_X, TO_Y, and TO_VPOS.
 
@@ -9138,6 +9667,14 @@ move_it_to (struct it *it, ptrdiff_t to_charpos, int to_x, int to_y, int to_vpos
       ++it->vpos;
       last_height = it->max_ascent + it->max_descent;
       it->max_ascent = it->max_descent = 0;
+
+      if (line_checkpoint_recorder.it == it)
+	{
+	  if (skip != MOVE_LINE_CONTINUED)
+	    line_checkpoint_recorder.it = NULL;
+	  else if (it->current_x == 0)
+	    note_line_checkpoint (it);
+	}
     }
 
  out:
@@ -9163,6 +9700,8 @@ move_it_to (struct it *it, ptrdiff_t to_charpos, int to_x, int to_y, int to_vpos
       it->current_y += it->max_ascent + it->max_descent;
       ++it->vpos;
       last_height = it->max_ascent + it->max_descent;
+      if (line_checkpoint_recorder.it == it)
+	line_checkpoint_recorder.it = NULL;
     }
 
   if (backup_data)
@@ -9186,7 +9725,7 @@ move_it_vertically_backward (struct it *it, int dy)
   int nlines, h;
   struct it it2, it3;
   void *it2data = NULL, *it3data = NULL;
-  ptrdiff_t start_pos;
+  ptrdiff_t start_pos, row, count = SPECPDL_INDEX ();
   int nchars_per_row
     = (it->last_visible_x - it->first_visible_x) / FRAME_COLUMN_WIDTH (it->f);
   ptrdiff_t pos_limit;
@@ -9220,12 +9759,20 @@ move_it_vertically_backward (struct it *it, int dy)
 				   reordering is in effect.  */
   it->continuation_lines_width = 0;
 
+  /* In a long line, start from a display line not much more than DY
+     above START_POS, if we know one.  */
+  row = restore_line_checkpoint (it, start_pos,
+				 (dy > 0
+				  ? dy / default_line_pixel_height (it->w) + 1
+				  : 0));
+
   /* Move forward and see what y-distance we moved.  First move to the
      start of the next line so that we get its height.  We need this
      height to be able to tell whether we reached the specified
      y-distance.  */
   SAVE_IT (it2, *it, it2data);
   it2.max_ascent = it2.max_descent = 0;
+  record_line_checkpoints (&it2, row);
   do
     {
       move_it_to (&it2, start_pos, -1, -1, it2.vpos + 1,
@@ -9245,6 +9792,7 @@ move_it_vertically_backward (struct it *it, int dy)
   SAVE_IT (it3, it2, it3data);
 
   move_it_to (&it2, start_pos, -1, -1, -1, MOVE_TO_POS);
+  unbind_to (count, Qnil);
   eassert (IT_CHARPOS (*it) >= BEGV);
   /* H is the actual vertical distance from the position in *IT
      and the starting position.  */
@@ -9437,7 +9985,7 @@ move_it_by_lines (struct it *it, ptrdiff_t dvpos)
     {
       struct it it2;
       void *it2data = NULL;
-      ptrdiff_t start_charpos, i;
+      ptrdiff_t start_charpos, i, row, count = SPECPDL_INDEX ();
       int nchars_per_row
 	= (it->last_visible_x - it->first_visible_x) / FRAME_COLUMN_WIDTH (it->f);
       ptrdiff_t pos_limit;
@@ -9478,11 +10026,17 @@ move_it_by_lines (struct it *it, ptrdiff_t dvpos)
 
       it->current_x = it->hpos = 0;
 
+      /* In a long line, start from a display line not much more than
+	 -DVPOS lines above START_CHARPOS, if we know one.  */
+      row = restore_line_checkpoint (it, start_charpos, -dvpos);
+
       /* Above call may have moved too far if continuation lines
 	 are involved.  Scan forward and see if it did.  */
       SAVE_IT (it2, *it, it2data);
       it2.vpos = it2.current_y = 0;
+      record_line_checkpoints (&it2, row);
       move_it_to (&it2, start_charpos, -1, -1, -1, MOVE_TO_POS);
+      unbind_to (count, Qnil);
       it->vpos -= it2.vpos;
       it->current_y -= it2.current_y;
       it->current_x = it->hpos = 0;
@@ -11021,7 +11575,8 @@ static enum {
   MODE_LINE_DISPLAY = 0,
   MODE_LINE_TITLE,
   MODE_LINE_NOPROP,
-  MODE_LINE_STRING
+  MODE_LINE_STRING,
+  MODE_LINE_KEY
 } mode_line_target;
 
 /* Alist that caches the results of :propertize.
@@ -12960,6 +13515,291 @@ reconsider_clip_changes (struct window *w)
     }
 }
 
+/***********************************************************************
+			  Redisplay Profiling
+ ***********************************************************************/
+
+/* Number of redisplay cycles kept in the profile log.  */
+
+#define REDISPLAY_PROFILE_LOG_SIZE 1024
+
+/* Maximum number of windows recorded for a redisplay cycle.  */
+
+#define REDISPLAY_PROFILE_MAX_WINDOWS 64
+
+/* Time spent by a window in each redisplay phase, in microseconds,
+   and how it was redisplayed.  */
+
+struct redisplay_profile_window
+{
+  struct window *w;
+
+  /* Symbol naming the method used to redisplay W, or nil.  */
+  Lisp_Object path;
+
+  EMACS_INT phase[REDISPLAY_N_PHASES];
+};
+
+/* The redisplay cycle being profiled.  */
+
+static struct
+{
+  struct timespec start;
+  EMACS_INT phase[REDISPLAY_N_PHASES];
+  int nwindows;
+  struct redisplay_profile_window windows[REDISPLAY_PROFILE_MAX_WINDOWS];
+} redisplay_profile;
+
+/* Non-zero while a redisplay cycle is being profiled.  */
+
+bool redisplay_profiling;
+
+/* Vector holding the last REDISPLAY_PROFILE_LOG_SIZE profiled
+   redisplay cycles in a ring, or nil if there are none, and the index
+   of the slot for the next cycle.  */
+
+static Lisp_Object redisplay_profile_log;
+static int redisplay_profile_log_index;
+
+#define NOTE_REDISPLAY_PATH(W, PATH)				\
+  (redisplay_profiling ? note_redisplay_path ((W), (PATH)) : (void) 0)
+
+static EMACS_INT
+usecs_since (struct timespec start)
+{
+  struct timespec t = timespec_sub (current_timespec (), start);
+  return t.tv_sec * (EMACS_INT) 1000000 + t.tv_nsec / 1000;
+}
+
+/* Return the record of window W in the redisplay cycle being
+   profiled, or null if there are too many windows.  */
+
+static struct redisplay_profile_window *
+redisplay_profile_window (struct window *w)
+{
+  struct redisplay_profile_window *pw;
+  int i;
+
+  for (i = 0; i < redisplay_profile.nwindows; i++)
+    if (redisplay_profile.windows[i].w == w)
+      return redisplay_profile.windows + i;
+
+  if (i == REDISPLAY_PROFILE_MAX_WINDOWS)
+    return NULL;
+  redisplay_profile.nwindows++;
+  pw = redisplay_profile.windows + i;
+  memset (pw, 0, sizeof *pw);
+  pw->w = w;
+  pw->path = Qnil;
+  return pw;
+}
+
+void
+add_redisplay_phase_time (struct window *w, enum redisplay_phase phase,
+			  struct timespec start)
+{
+  EMACS_INT usecs = usecs_since (start);
+
+  if (w)
+    {
+      struct redisplay_profile_window *pw = redisplay_profile_window (w);
+      if (pw)
+	pw->phase[phase] += usecs;
+    }
+  else
+    redisplay_profile.phase[phase] += usecs;
+}
+
+/* Record that window W was redisplayed by the method named PATH.  */
+
+static void
+note_redisplay_path (struct window *w, Lisp_Object path)
+{
+  struct redisplay_profile_window *pw = redisplay_profile_window (w);
+  if (pw)
+    pw->path = path;
+}
+
+static void
+start_redisplay_profile (void)
+{
+  redisplay_profiling = 1;
+  redisplay_profile.start = current_timespec ();
+  memset (redisplay_profile.phase, 0, sizeof redisplay_profile.phase);
+  redisplay_profile.nwindows = 0;
+}
+
+/* Add the redisplay cycle being profiled to the profile log.  */
+
+static void
+finish_redisplay_profile (void)
+{
+  EMACS_INT *phase = redisplay_profile.phase;
+  Lisp_Object windows = Qnil, window;
+  int i;
+
+  redisplay_profiling = 0;
+  for (i = redisplay_profile.nwindows - 1; i >= 0; i--)
+    {
+      struct redisplay_profile_window *pw = redisplay_profile.windows + i;
+
+      XSETWINDOW (window, pw->w);
+      windows
+	= Fcons (listn (CONSTYPE_HEAP, 6, window, pw->path,
+			make_number (pw->phase[REDISPLAY_PHASE_WINDOW]),
+			make_number (pw->phase[REDISPLAY_PHASE_MODE_LINES]),
+			make_number (pw->phase[REDISPLAY_PHASE_FONTIFICATION]),
+			make_number (pw->phase[REDISPLAY_PHASE_UPDATE])),
+		 windows);
+      phase[REDISPLAY_PHASE_MODE_LINES]
+	+= pw->phase[REDISPLAY_PHASE_MODE_LINES];
+      phase[REDISPLAY_PHASE_FONTIFICATION]
+	+= pw->phase[REDISPLAY_PHASE_FONTIFICATION];
+    }
+
+  if (NILP (redisplay_profile_log))
+    {
+      redisplay_profile_log
+	= Fmake_vector (make_number (REDISPLAY_PROFILE_LOG_SIZE), Qnil);
+      redisplay_profile_log_index = 0;
+    }
+  ASET (redisplay_profile_log, redisplay_profile_log_index,
+	listn (CONSTYPE_HEAP, 7, make_lisp_time (redisplay_profile.start),
+	       make_number (usecs_since (redisplay_profile.start)),
+	       make_number (phase[REDISPLAY_PHASE_MENU_BARS]),
+	       make_number (phase[REDISPLAY_PHASE_MODE_LINES]),
+	       make_number (phase[REDISPLAY_PHASE_FONTIFICATION]),
+	       make_number (phase[REDISPLAY_PHASE_UPDATE]),
+	       windows));
+  redisplay_profile_log_index
+    = (redisplay_profile_log_index + 1) % REDISPLAY_PROFILE_LOG_SIZE;
+}
+
+/* Return the profiled redisplay cycles as a list, oldest first.  */
+
+static Lisp_Object
+redisplay_profile_cycles (void)
+{
+  Lisp_Object cycles = Qnil;
+  int i;
+
+  if (NILP (redisplay_profile_log))
+    return Qnil;
+  for (i = 0; i < REDISPLAY_PROFILE_LOG_SIZE; i++)
+    {
+      Lisp_Object cycle
+	= AREF (redisplay_profile_log,
+		(redisplay_profile_log_index + i) % REDISPLAY_PROFILE_LOG_SIZE);
+      if (!NILP (cycle))
+	cycles = Fcons (cycle, cycles);
+    }
+  return Fnreverse (cycles);
+}
+
+DEFUN ("redisplay-profile-log", Fredisplay_profile_log,
+       Sredisplay_profile_log, 0, 0, 0,
+       doc: /* Return the redisplay profile log, and start a new one.
+The log is a list of the redisplay cycles recorded while
+`profile-redisplay' was non-nil, oldest first.  Only the last 1024
+cycles are kept.  Each element has the form
+
+  (TIME TOTAL MENU-BARS MODE-LINES FONTIFICATION UPDATE WINDOWS)
+
+TIME is when the cycle started, as a Lisp timestamp.  The other
+numbers are in microseconds: TOTAL is the duration of the cycle,
+and the others are the time spent building menu bar and tool-bar
+items, formatting mode lines and header lines, running
+`fontification-functions', and updating the display.
+
+WINDOWS is a list with an element for each window that was examined
+during the cycle, of the form
+
+  (WINDOW PATH TOTAL MODE-LINES FONTIFICATION UPDATE)
+
+where TOTAL is the time spent redisplaying WINDOW, not including the
+update of the display.  PATH is a symbol naming how the window was
+redisplayed:
+
+  `this-line'            only the line with point was redisplayed
+  `cursor-in-line'       only the cursor moved, within its line
+  `unchanged'            nothing needed to be redisplayed
+  `cursor-movement'      the cursor moved, but the text did not scroll
+  `try-window-id'        the changed lines were redisplayed in place
+  `reuse-current-matrix' the text was redisplayed reusing the rows
+                         already on display
+  `try-window'           the text was redisplayed from the same
+                         window start
+  `forced-start'         the window start was set by Lisp
+  `scrolling'            the window was scrolled a few lines
+  `recenter'             a new window start was chosen
+
+or nil if the window was not redisplayed.  */)
+  (void)
+{
+  Lisp_Object cycles = redisplay_profile_cycles ();
+
+  redisplay_profile_log = Qnil;
+  return cycles;
+}
+
+DEFUN ("redisplay-profile-write", Fredisplay_profile_write,
+       Sredisplay_profile_write, 1, 1,
+       "FWrite redisplay profile to file: ",
+       doc: /* Write the redisplay profile log to FILE as a trace.
+The log is not cleared.  Each redisplay cycle is written as a line of
+tab-separated fields
+
+  cycle TIME TOTAL MENU-BARS MODE-LINES FONTIFICATION UPDATE
+
+where TIME is in seconds since the epoch, followed by a line
+
+  window PATH TOTAL MODE-LINES FONTIFICATION UPDATE BUFFER
+
+for each window, where BUFFER is the name of the buffer the window
+shows now.  See `redisplay-profile-log' for the meaning of the other
+fields.  */)
+  (Lisp_Object file)
+{
+  Lisp_Object cycles;
+  FILE *stream;
+
+  file = Fexpand_file_name (file, Qnil);
+  cycles = redisplay_profile_cycles ();
+  stream = emacs_fopen (SSDATA (ENCODE_FILE (file)), "w");
+  if (!stream)
+    report_file_error ("Writing redisplay profile", file);
+
+  for (; CONSP (cycles); cycles = XCDR (cycles))
+    {
+      Lisp_Object cycle = XCAR (cycles), windows;
+
+      fprintf (stream, "cycle\t%.6f", XFLOAT_DATA (Ffloat_time (XCAR (cycle))));
+      for (cycle = XCDR (cycle); CONSP (XCDR (cycle)); cycle = XCDR (cycle))
+	fprintf (stream, "\t%"pI"d", XINT (XCAR (cycle)));
+      putc ('\n', stream);
+
+      for (windows = XCAR (cycle); CONSP (windows); windows = XCDR (windows))
+	{
+	  Lisp_Object window = XCAR (windows), tail;
+	  Lisp_Object contents = XWINDOW (XCAR (window))->contents;
+
+	  fprintf (stream, "window\t%s",
+		   SYMBOLP (XCAR (XCDR (window)))
+		   ? SSDATA (SYMBOL_NAME (XCAR (XCDR (window)))) : "nil");
+	  for (tail = XCDR (XCDR (window)); CONSP (tail); tail = XCDR (tail))
+	    fprintf (stream, "\t%"pI"d", XINT (XCAR (tail)));
+	  fprintf (stream, "\t%s\n",
+		   BUFFERP (contents) && BUFFER_LIVE_P (XBUFFER (contents))
+		   ? SSDATA (BVAR (XBUFFER (contents), name)) : "");
+	}
+    }
+
+  if (fclose (stream) != 0)
+    report_file_error ("Writing redisplay profile", file);
+  return Qnil;
+}
+
+
 #define STOP_POLLING					\
 do { if (! polling_stopped_here) stop_polling ();	\
        polling_stopped_here = 1; } while (0)
@@ -13031,9 +13871,26 @@ redisplay_internal (void)
   /* Record this function, so it appears on the profiler's backtraces.  */
   record_in_backtrace (Qredisplay_internal, &Qnil, 0);
 
+  if (profile_redisplay)
+    start_redisplay_profile ();
+
   FOR_EACH_FRAME (tail, frame)
     XFRAME (frame)->already_hscrolled_p = 0;
 
+  /* Rows produced by earlier redisplays are not shared.  */
+  ++shared_rows_generation;
+
+  /* Rows of the current matrices may show text that was not fontified
+     because input was pending; don't reuse them.  */
+  while (CONSP (fontification_skipped_windows))
+    {
+      Lisp_Object window = XCAR (fontification_skipped_windows);
+
+      fontification_skipped_windows = XCDR (fontification_skipped_windows);
+      if (WINDOW_LIVE_P (window))
+	Fforce_window_update (window);
+    }
+
  retry:
   /* Remember the currently selected window.  */
   sw = w;
@@ -13103,7 +13960,12 @@ redisplay_internal (void)
 
   /* Build menubar and tool-bar items.  */
   if (NILP (Vmemory_full))
-    prepare_menu_bars ();
+    {
+      struct timespec start = REDISPLAY_PHASE_START ();
+
+      prepare_menu_bars ();
+      REDISPLAY_PHASE_END (NULL, REDISPLAY_PHASE_MENU_BARS, start);
+    }
 
   if (windows_or_buffers_changed)
     update_mode_lines++;
@@ -13340,6 +14202,7 @@ redisplay_internal (void)
 	      *w->desired_matrix->method = 0;
 	      debug_method_add (w, "optimization 1");
 #endif
+	      NOTE_REDISPLAY_PATH (w, Qthis_line);
 #if HAVE_XWIDGETS
               //debug optimization movement issue
               //w->desired_matrix->no_scrolling_p = 1;
@@ -13362,6 +14225,7 @@ redisplay_internal (void)
 	       && 0 <= w->cursor.vpos
 	       && w->cursor.vpos < WINDOW_TOTAL_LINES (w))
 	{
+	  NOTE_REDISPLAY_PATH (w, Qunchanged);
 	  if (!must_finish)
 	    {
 	      do_pending_window_change (1);
@@ -13415,6 +14279,7 @@ redisplay_internal (void)
 	      *w->desired_matrix->method = 0;
 	      debug_method_add (w, "optimization 3");
 #endif
+	      NOTE_REDISPLAY_PATH (w, Qcursor_in_line);
 	      goto update;
 	    }
 	  else
@@ -13685,6 +14550,8 @@ redisplay_internal (void)
 #endif /* HAVE_WINDOW_SYSTEM */
 
  end_of_redisplay:
+  if (redisplay_profiling)
+    finish_redisplay_profile ();
   unbind_to (count, Qnil);
   RESUME_POLLING;
 }
@@ -13727,6 +14594,7 @@ static void
 unwind_redisplay (void)
 {
   redisplaying_p = 0;
+  redisplay_profiling = 0;
 }
 
 
@@ -13835,7 +14703,17 @@ disp_char_vector (struct Lisp_Char_Table *dp, int c)
 			   Window Redisplay
  ***********************************************************************/
 
-/* Redisplay all leaf windows in the window tree rooted at WINDOW.  */
+/* Redisplay all leaf windows in the window tree rooted at WINDOW.
+
+   The windows are redisplayed one after the other, not concurrently.
+   Producing the glyphs of a window selects its buffer as the current
+   buffer, can run Lisp (fontification functions, `:eval' forms in
+   the mode line, `display' property specs), and so allocate and
+   garbage-collect, and it realizes faces in the frame's face cache.
+   The iterator also relies on global state such as displayed_buffer
+   and this_line_buffer.  None of that may be shared between threads,
+   so producing the glyphs of several windows in parallel would need
+   all of it made thread-safe first; that is why it is not done.  */
 
 static void
 redisplay_windows (Lisp_Object window)
@@ -15433,6 +16311,7 @@ redisplay_window (Lisp_Object window, int just_this_one_p)
   int last_line_misfit = 0;
   ptrdiff_t beg_unchanged, end_unchanged;
   int frame_line_height;
+  struct timespec profile_start = REDISPLAY_PHASE_START ();
 
   SET_TEXT_POS (lpoint, PT, PT_BYTE);
   opoint = lpoint;
@@ -15748,6 +16627,7 @@ redisplay_window (Lisp_Object window, int just_this_one_p)
 #ifdef GLYPH_DEBUG
       debug_method_add (w, "forced window start");
 #endif
+      NOTE_REDISPLAY_PATH (w, Qforced_start);
       goto done;
     }
 
@@ -15762,6 +16642,7 @@ redisplay_window (Lisp_Object window, int just_this_one_p)
 	{
 	case CURSOR_MOVEMENT_SUCCESS:
 	  used_current_matrix_p = 1;
+	  NOTE_REDISPLAY_PATH (w, Qcursor_movement);
 	  goto done;
 
 	case CURSOR_MOVEMENT_MUST_SCROLL:
@@ -15795,7 +16676,10 @@ redisplay_window (Lisp_Object window, int just_this_one_p)
       if (f->fonts_changed)
 	goto need_larger_matrices;
       if (tem > 0)
-	goto done;
+	{
+	  NOTE_REDISPLAY_PATH (w, Qtry_window_id);
+	  goto done;
+	}
 
       /* Otherwise try_window_id has returned -1 which means that we
 	 don't want the alternative below this comment to execute.  */
@@ -15885,7 +16769,12 @@ redisplay_window (Lisp_Object window, int just_this_one_p)
 	    }
 	    /* Drop through and scroll.  */
 	  else
-	    goto done;
+	    {
+	      NOTE_REDISPLAY_PATH (w, (used_current_matrix_p
+				       ? Qreuse_current_matrix
+				       : Qtry_window));
+	      goto done;
+	    }
 	}
       else
 	clear_glyph_matrix (w->desired_matrix);
@@ -15918,6 +16807,7 @@ redisplay_window (Lisp_Object window, int just_this_one_p)
       switch (ss)
 	{
 	case SCROLLING_SUCCESS:
+	  NOTE_REDISPLAY_PATH (w, Qscrolling);
 	  goto done;
 
 	case SCROLLING_NEED_LARGER_MATRICES:
@@ -15939,6 +16829,7 @@ redisplay_window (Lisp_Object window, int just_this_one_p)
 #ifdef GLYPH_DEBUG
   debug_method_add (w, "recenter");
 #endif
+  NOTE_REDISPLAY_PATH (w, Qrecenter);
 
   /* Forget any previously recorded base line for line number display.  */
   if (!buffer_unchanged_p)
@@ -16299,6 +17190,7 @@ redisplay_window (Lisp_Object window, int just_this_one_p)
     TEMP_SET_PT_BOTH (CHARPOS (lpoint), BYTEPOS (lpoint));
 
   unbind_to (count, Qnil);
+  REDISPLAY_PHASE_END (w, REDISPLAY_PHASE_WINDOW, profile_start);
 }
 
 
@@ -19340,6 +20232,282 @@ find_row_edges (struct it *it, struct glyph_row *row,
     row->maxpos = it->current.pos;
 }
 
+/***********************************************************************
+		    Sharing Glyph Rows Between Windows
+ ***********************************************************************/
+
+/* When a buffer is shown in several windows of a frame, the same text
+   lines are often displayed in more than one of them.  display_line
+   remembers the rows it produces in shared_rows, indexed by buffer
+   and start position, and copies such a row from the desired matrix
+   of another window instead of producing it again, if the text and
+   the layout of the two windows are the same.  */
+
+/* Number of entries in shared_rows, and the number of entries for
+   rows starting at the same position, which windows with different
+   layouts can record.  Both must be powers of 2.  */
+
+#define N_SHARED_ROWS 256
+#define SHARED_ROW_WAYS 4
+
+struct shared_row
+{
+  /* Vpos of the row in the desired matrix of its window, and its hash
+     code.  */
+  int vpos;
+  unsigned hash;
+
+  /* Buffer text the row was produced from.  */
+  struct buffer *buffer;
+  ptrdiff_t charpos, begv, zv;
+  EMACS_INT modiff, overlay_modiff;
+
+  /* Layout of the window.  */
+  struct Lisp_Char_Table *dp;
+  int first_visible_x, last_visible_x;
+  int text_area_width, left_margin_width, right_margin_width;
+  int left_fringe_width, right_fringe_width;
+  enum line_wrap_method line_wrap;
+
+  /* Value of shared_rows_generation when the row was recorded.  */
+  EMACS_UINT generation;
+};
+
+static struct shared_row shared_rows[N_SHARED_ROWS];
+
+/* The windows of the entries of shared_rows.  */
+
+static Lisp_Object shared_row_windows;
+
+/* Value is the index in shared_rows of the first of the
+   SHARED_ROW_WAYS entries for rows of current_buffer starting at
+   CHARPOS.  */
+
+static int
+shared_row_bucket (ptrdiff_t charpos)
+{
+  EMACS_UINT hash = charpos + ((uintptr_t) current_buffer >> 4);
+
+  return (hash * SHARED_ROW_WAYS) & (N_SHARED_ROWS - 1);
+}
+
+/* Value is non-zero if IT is at the start of a line whose row might
+   be shared with other windows.  */
+
+static bool
+shareable_start_p (struct it *it)
+{
+  return (share_glyph_rows
+	  && redisplaying_p
+	  && it->base_face_id == DEFAULT_FACE_ID
+	  && it->region_beg_charpos <= 0
+	  && it->method == GET_FROM_BUFFER
+	  && it->sp == 0
+	  && it->current_x == 0
+	  && it->continuation_lines_width == 0
+	  && !it->starts_in_middle_of_char_p
+	  && it->start.overlay_string_index < 0
+	  && it->start.dpvec_index < 0
+	  && CHARPOS (it->start.string_pos) < 0
+	  && IT_CHARPOS (*it) == CHARPOS (it->start.pos));
+}
+
+/* Value is non-zero if an overlay specific to some window covers
+   text between BEG and END of current_buffer, or is adjacent to it.  */
+
+static bool
+window_overlays_p (ptrdiff_t beg, ptrdiff_t end)
+{
+  struct Lisp_Overlay *ov;
+  Lisp_Object overlay;
+
+  for (ov = current_buffer->overlays_before; ov; ov = ov->next)
+    {
+      XSETMISC (overlay, ov);
+      if (OVERLAY_POSITION (OVERLAY_END (overlay)) < beg)
+	break;
+      if (OVERLAY_POSITION (OVERLAY_START (overlay)) <= end
+	  && !NILP (Foverlay_get (overlay, Qwindow)))
+	return 1;
+    }
+
+  for (ov = current_buffer->overlays_after; ov; ov = ov->next)
+    {
+      XSETMISC (overlay, ov);
+      if (OVERLAY_POSITION (OVERLAY_START (overlay)) > end)
+	break;
+      if (OVERLAY_POSITION (OVERLAY_END (overlay)) >= beg
+	  && !NILP (Foverlay_get (overlay, Qwindow)))
+	return 1;
+    }
+
+  return 0;
+}
+
+/* Value is non-zero if point is in the text shown by ROW.  Whether
+   compositions and trailing whitespace are shown as such depends on
+   point, so such rows are not shared.  */
+
+static bool
+point_in_row_p (struct glyph_row *row)
+{
+  return (PT >= CHARPOS (row->start.pos)
+	  && PT <= CHARPOS (row->end.pos));
+}
+
+/* Remember ROW, just produced by display_line from IT, so that other
+   windows can use it.  ROW must have started at a position for which
+   shareable_start_p was true.  */
+
+static void
+record_shared_row (struct it *it, struct glyph_row *row)
+{
+  struct window *w = it->w;
+  int bucket = shared_row_bucket (CHARPOS (row->start.pos));
+  int i, way = 0;
+  struct shared_row *sr;
+
+  if (row->continued_p
+      || row->ends_at_zv_p
+      || row->ends_in_ellipsis_p
+      || row->ends_in_newline_from_string_p
+      || MATRIX_ROW_ENDS_IN_MIDDLE_OF_CHAR_P (row)
+      || row->visible_height != row->height
+      || row->mode_line_p
+      || point_in_row_p (row))
+    return;
+
+  /* Replace this window's entry for the position, or an obsolete
+     one.  */
+  for (i = bucket; i < bucket + SHARED_ROW_WAYS; i++)
+    {
+      sr = shared_rows + i;
+      if (sr->generation != shared_rows_generation)
+	way = i - bucket;
+      else if (sr->charpos == CHARPOS (row->start.pos)
+	       && sr->buffer == current_buffer
+	       && EQ (AREF (shared_row_windows, i), it->window))
+	{
+	  way = i - bucket;
+	  break;
+	}
+    }
+
+  i = bucket + way;
+  sr = shared_rows + i;
+  ASET (shared_row_windows, i, it->window);
+  sr->vpos = MATRIX_ROW_VPOS (row, w->desired_matrix);
+  sr->hash = row->hash;
+  sr->buffer = current_buffer;
+  sr->charpos = CHARPOS (row->start.pos);
+  sr->begv = BEGV;
+  sr->zv = ZV;
+  sr->modiff = MODIFF;
+  sr->overlay_modiff = OVERLAY_MODIFF;
+  sr->dp = it->dp;
+  sr->first_visible_x = it->first_visible_x;
+  sr->last_visible_x = it->last_visible_x;
+  sr->text_area_width = window_box_width (w, TEXT_AREA);
+  sr->left_margin_width = WINDOW_LEFT_MARGIN_WIDTH (w);
+  sr->right_margin_width = WINDOW_RIGHT_MARGIN_WIDTH (w);
+  sr->left_fringe_width = WINDOW_LEFT_FRINGE_WIDTH (w);
+  sr->right_fringe_width = WINDOW_RIGHT_FRINGE_WIDTH (w);
+  sr->line_wrap = it->line_wrap;
+  sr->generation = shared_rows_generation;
+}
+
+/* Value is the row of another window that can be used for
+   IT->glyph_row, or null if there is none.  IT must be at a position
+   for which shareable_start_p is true.  */
+
+static struct glyph_row *
+find_shared_row (struct it *it)
+{
+  struct window *w = it->w;
+  int bucket = shared_row_bucket (IT_CHARPOS (*it));
+  int i;
+
+  for (i = bucket; i < bucket + SHARED_ROW_WAYS; i++)
+    {
+      struct shared_row *sr = shared_rows + i;
+      Lisp_Object window = AREF (shared_row_windows, i);
+      struct glyph_row *from;
+
+      if (sr->generation != shared_rows_generation
+	  || !WINDOW_LIVE_P (window)
+	  || EQ (window, it->window)
+	  || XBUFFER (XWINDOW (window)->contents) != current_buffer
+	  || WINDOW_XFRAME (XWINDOW (window)) != it->f
+	  || sr->buffer != current_buffer
+	  || sr->charpos != IT_CHARPOS (*it)
+	  || sr->begv != BEGV || sr->zv != ZV
+	  || sr->modiff != MODIFF || sr->overlay_modiff != OVERLAY_MODIFF
+	  || sr->dp != it->dp
+	  || sr->first_visible_x != it->first_visible_x
+	  || sr->last_visible_x != it->last_visible_x
+	  || sr->line_wrap != it->line_wrap
+	  || sr->text_area_width != window_box_width (w, TEXT_AREA)
+	  || sr->left_margin_width != WINDOW_LEFT_MARGIN_WIDTH (w)
+	  || sr->right_margin_width != WINDOW_RIGHT_MARGIN_WIDTH (w)
+	  || sr->left_fringe_width != WINDOW_LEFT_FRINGE_WIDTH (w)
+	  || sr->right_fringe_width != WINDOW_RIGHT_FRINGE_WIDTH (w)
+	  || sr->vpos >= XWINDOW (window)->desired_matrix->nrows)
+	continue;
+
+      /* The row must still be the one that was recorded.  */
+      from = MATRIX_ROW (XWINDOW (window)->desired_matrix, sr->vpos);
+      if (from->enabled_p
+	  && from->hash == sr->hash
+	  && MATRIX_ROW_START_CHARPOS (from) == IT_CHARPOS (*it)
+	  && from->start.overlay_string_index < 0
+	  && from->start.dpvec_index < 0
+	  && CHARPOS (from->start.string_pos) < 0)
+	return from;
+    }
+
+  return NULL;
+}
+
+/* Try to produce IT->glyph_row by copying a row of another window.
+   IT must be at a position for which shareable_start_p is true.
+   Value is non-zero if successful; IT is then set up at the end of
+   the row, as display_line leaves it.  */
+
+static bool
+share_glyph_row (struct it *it)
+{
+  struct window *w = it->w;
+  struct glyph_row *from = find_shared_row (it), *row = it->glyph_row;
+  struct it saved_it;
+  void *saved_data = NULL;
+
+  if (!from
+      || it->current_y + from->height > it->last_visible_y
+      || point_in_row_p (from)
+      || window_overlays_p (CHARPOS (from->start.pos),
+			    CHARPOS (from->end.pos))
+      || !NILP (overlay_arrow_at_row (it, from))
+      || !copy_glyph_row (row, from))
+    return 0;
+  row->y = it->current_y;
+
+  /* Set up IT at the end of the row like display_line would, keeping
+     its place in the desired matrix.  */
+  SAVE_IT (saved_it, *it, saved_data);
+  if (!init_to_row_end (it, w, row))
+    {
+      RESTORE_IT (it, &saved_it, saved_data);
+      row->enabled_p = 0;
+      return 0;
+    }
+  bidi_unshelve_cache (saved_data, 1);
+  it->vpos = saved_it.vpos;
+  it->glyph_row = row;
+  it->current_y = saved_it.current_y;
+  it->first_vpos = saved_it.first_vpos;
+  return 1;
+}
+
 /* Construct the glyph row IT->glyph_row in the desired matrix of
    IT->w from text at the current position of IT.  See dispextern.h
    for an overview of struct it.  Value is non-zero if
@@ -19363,6 +20531,7 @@ display_line (struct it *it)
   int cvpos;
   ptrdiff_t min_pos = ZV + 1, max_pos = 0;
   ptrdiff_t min_bpos IF_LINT (= 0), max_bpos IF_LINT (= 0);
+  bool shareable_p;
 
   /* We always start displaying at hpos zero even if hscrolled.  */
   eassert (it->hpos == 0 && it->current_x == 0);
@@ -19378,6 +20547,11 @@ display_line (struct it *it)
   /* Is IT->w showing the region?  */
   it->w->region_showing = it->region_beg_charpos > 0 ? it->region_beg_charpos : 0;
 
+  /* Use the row of another window displaying the same line, if any.  */
+  shareable_p = shareable_start_p (it);
+  if (shareable_p && share_glyph_row (it))
+    goto row_done;
+
   /* Clear the result glyph row and enable it.  */
   prepare_desired_row (row);
 
@@ -20051,6 +21225,10 @@ display_line (struct it *it)
   it->right_user_fringe_bitmap = 0;
   it->right_user_fringe_face_id = 0;
 
+  if (shareable_p)
+    record_shared_row (it, row);
+
+ row_done:
   /* Maybe set the cursor.  */
   cvpos = it->w->cursor.vpos;
   if ((cvpos < 0
@@ -20747,6 +21925,347 @@ redisplay_mode_lines (Lisp_Object window, int force)
 }
 
 
+/***********************************************************************
+			   Mode Line Cache
+ ***********************************************************************/
+
+/* A mode or header line is remembered along with the inputs it was
+   produced from: the strings, field widths and %-construct expansions
+   that formatting it met, the face remapping, the display table and
+   the layout of the window.  Formatting
+   a line with the MODE_LINE_KEY target of display_mode_element
+   collects these inputs without producing glyphs.  When they are the
+   same as the remembered ones, the remembered glyphs are used.  */
+
+/* Number of mode and header lines remembered.  */
+
+#define N_MODE_LINE_CACHE 32
+
+struct mode_line_cache
+{
+  /* Window and face of the line.  W is null if the entry is unused.  */
+  struct window *w;
+  int face_id;
+
+  /* Layout of the line.  */
+  int base_face_id, first_visible_x, last_visible_x;
+  int start_x, start_y;
+  unsigned bidi_p : 1;
+
+  /* The %-constructs, each a struct mode_line_spec followed by its
+     expansion and a null byte.  */
+  char *specs;
+  ptrdiff_t nspecs, specs_size;
+
+  /* The row, and the glyphs of its text area.  */
+  struct glyph_row row;
+  struct glyph *glyphs;
+  ptrdiff_t glyphs_size;
+
+  /* Value of mode_line_cache_clock when the entry was last used.  */
+  EMACS_UINT used;
+};
+
+static struct mode_line_cache mode_line_cache[N_MODE_LINE_CACHE];
+static EMACS_UINT mode_line_cache_clock;
+
+/* Lisp data of the entries of mode_line_cache, five slots for each:
+   the window, the list of inputs, the strings displayed by the
+   glyphs, and copies of the face remapping alist and of the display
+   table.  The copies notice changes made to them in place.  */
+
+static Lisp_Object mode_line_cache_data;
+
+/* Index in mode_line_cache_data of slot SLOT of entry MC.  */
+
+#define MODE_LINE_CACHE_SLOT(MC, SLOT)					\
+  (5 * ((MC) - mode_line_cache) + (SLOT))
+
+/* A %-construct in mode_line_key_specs: its character and field
+   width.  The expansion follows it.  */
+
+struct mode_line_spec
+{
+  int c, field;
+};
+
+/* While formatting with the MODE_LINE_KEY target, the inputs met so
+   far, most recent first, and the %-constructs.  */
+
+static Lisp_Object mode_line_key;
+static char *mode_line_key_specs;
+static ptrdiff_t mode_line_key_nspecs, mode_line_key_specs_size;
+
+/* The strings of the %-constructs in mode_line_key_specs, as returned
+   by decode_mode_spec, most recent first.  */
+
+static Lisp_Object mode_line_spec_strings;
+
+/* While formatting with the MODE_LINE_DISPLAY target after the
+   MODE_LINE_KEY target, the offset in mode_line_key_specs of the next
+   %-construct whose expansion can be used again, and the end of the
+   %-constructs.  */
+
+static ptrdiff_t mode_line_spec_pos, mode_line_spec_end;
+
+/* Number of mode and header lines taken from the cache and produced
+   again, for mode-line-cache-statistics.  */
+
+static EMACS_INT mode_line_cache_hits, mode_line_cache_misses;
+
+/* The values of the :eval forms evaluated with the MODE_LINE_KEY
+   target, as (FORM . VALUE).  Formatting the same line again with
+   the MODE_LINE_DISPLAY target uses them instead of evaluating the
+   forms a second time.  */
+
+static Lisp_Object mode_line_eval_values;
+
+static void
+record_mode_line_input (Lisp_Object input)
+{
+  mode_line_key = Fcons (input, mode_line_key);
+}
+
+/* Record the %-construct C with field width FIELD, which expanded to
+   SPEC and STRING.  */
+
+static void
+record_mode_line_spec (int c, int field, const char *spec,
+		       Lisp_Object string)
+{
+  struct mode_line_spec header;
+  ptrdiff_t nbytes = sizeof header + strlen (spec) + 1;
+
+  if (mode_line_key_specs_size - mode_line_key_nspecs < nbytes)
+    mode_line_key_specs
+      = xpalloc (mode_line_key_specs, &mode_line_key_specs_size,
+		 nbytes - (mode_line_key_specs_size - mode_line_key_nspecs),
+		 -1, 1);
+  header.c = c;
+  header.field = field;
+  memcpy (mode_line_key_specs + mode_line_key_nspecs, &header,
+	  sizeof header);
+  strcpy (mode_line_key_specs + mode_line_key_nspecs + sizeof header, spec);
+  mode_line_key_nspecs += nbytes;
+  mode_line_spec_strings = Fcons (string, mode_line_spec_strings);
+}
+
+/* Return the expansion of the %-construct C with field width FIELD
+   recorded with the MODE_LINE_KEY target, and set *STRING to its
+   string.  Return null if the construct was not recorded, like
+   mode_line_eval does for :eval forms.  */
+
+static const char *
+replay_mode_line_spec (int c, int field, Lisp_Object *string)
+{
+  while (mode_line_spec_pos < mode_line_spec_end)
+    {
+      struct mode_line_spec header;
+      const char *spec = (mode_line_key_specs + mode_line_spec_pos
+			  + sizeof header);
+
+      memcpy (&header, mode_line_key_specs + mode_line_spec_pos,
+	      sizeof header);
+      mode_line_spec_pos += sizeof header + strlen (spec) + 1;
+      *string = XCAR (mode_line_spec_strings);
+      mode_line_spec_strings = XCDR (mode_line_spec_strings);
+      if (header.c == c && header.field == field)
+	return spec;
+    }
+  return NULL;
+}
+
+/* Evaluate FORM, the form of an :eval mode line element.  */
+
+static Lisp_Object
+mode_line_eval (Lisp_Object form)
+{
+  Lisp_Object value;
+
+  if (mode_line_target == MODE_LINE_DISPLAY)
+    while (CONSP (mode_line_eval_values))
+      {
+	Lisp_Object entry = XCAR (mode_line_eval_values);
+
+	mode_line_eval_values = XCDR (mode_line_eval_values);
+	if (EQ (XCAR (entry), form))
+	  return XCDR (entry);
+      }
+
+  value = safe_eval (form);
+  if (mode_line_target == MODE_LINE_KEY)
+    mode_line_eval_values = Fcons (Fcons (form, value),
+				   mode_line_eval_values);
+  return value;
+}
+
+static void
+unwind_mode_line_key (void)
+{
+  mode_line_eval_values = Qnil;
+  mode_line_spec_strings = Qnil;
+  mode_line_spec_pos = mode_line_spec_end = 0;
+}
+
+static bool
+mode_line_inputs_equal (Lisp_Object a, Lisp_Object b)
+{
+  for (; CONSP (a) && CONSP (b); a = XCDR (a), b = XCDR (b))
+    {
+      Lisp_Object x = XCAR (a), y = XCAR (b);
+
+      if (!EQ (x, y)
+	  && !(STRINGP (x) && STRINGP (y)
+	       && !NILP (Fequal_including_properties (x, y))))
+	return 0;
+    }
+  return EQ (a, b);
+}
+
+/* Return the entry of mode_line_cache for the line of IT->w with face
+   FACE_ID that is being formatted with the MODE_LINE_KEY target.  Set
+   *HIT if the entry's glyphs can be used for the line; otherwise the
+   entry, perhaps the least recently used one, is to be overwritten
+   with the line's glyphs.  */
+
+static struct mode_line_cache *
+lookup_mode_line_cache (struct it *it, int face_id, bool *hit)
+{
+  struct window *w = it->w;
+  struct glyph_row *row = it->glyph_row;
+  ptrdiff_t vpos = row - w->desired_matrix->rows;
+  struct mode_line_cache *mc, *lru = mode_line_cache;
+  int i;
+
+  *hit = 0;
+  for (i = 0; i < N_MODE_LINE_CACHE; i++)
+    {
+      mc = mode_line_cache + i;
+      if (mc->w == w && mc->face_id == face_id
+	  && EQ (AREF (mode_line_cache_data, MODE_LINE_CACHE_SLOT (mc, 0)),
+		 it->window))
+	break;
+      if (mc->used < lru->used)
+	lru = mc;
+    }
+  if (i == N_MODE_LINE_CACHE)
+    mc = lru;
+  else
+    /* The glyphs refer to realized faces, which are freed only along
+       with the current matrix.  */
+    *hit = (vpos < w->current_matrix->nrows
+	    && MATRIX_ROW (w->current_matrix, vpos)->enabled_p
+	    && mc->base_face_id == it->base_face_id
+	    && mc->first_visible_x == it->first_visible_x
+	    && mc->last_visible_x == it->last_visible_x
+	    && mc->start_x == it->current_x
+	    && mc->start_y == it->current_y
+	    && mc->bidi_p == it->bidi_p
+	    && mc->row.used[TEXT_AREA] <= (row->glyphs[TEXT_AREA + 1]
+					   - row->glyphs[TEXT_AREA])
+	    && !NILP (Fequal (AREF (mode_line_cache_data,
+				    MODE_LINE_CACHE_SLOT (mc, 3)),
+			      Vface_remapping_alist))
+	    && !NILP (Fequal (AREF (mode_line_cache_data,
+				    MODE_LINE_CACHE_SLOT (mc, 4)),
+			      display_table_object (it)))
+	    && mc->nspecs == mode_line_key_nspecs
+	    && memcmp (mc->specs, mode_line_key_specs, mc->nspecs) == 0
+	    && mode_line_inputs_equal (AREF (mode_line_cache_data,
+					     MODE_LINE_CACHE_SLOT (mc, 1)),
+				       mode_line_key));
+
+  if (!*hit)
+    {
+      /* Producing the glyphs moves IT, so remember where it starts.
+	 The entry is unused until store_mode_line_cache is done.  */
+      mc->w = NULL;
+      mc->base_face_id = it->base_face_id;
+      mc->first_visible_x = it->first_visible_x;
+      mc->last_visible_x = it->last_visible_x;
+      mc->start_x = it->current_x;
+      mc->start_y = it->current_y;
+      mc->bidi_p = it->bidi_p;
+    }
+  return mc;
+}
+
+/* Copy the glyphs of entry MC into ROW.  */
+
+static void
+use_mode_line_cache (struct mode_line_cache *mc, struct glyph_row *row)
+{
+  struct glyph *pointers[1 + LAST_AREA];
+
+  memcpy (pointers, row->glyphs, sizeof pointers);
+  *row = mc->row;
+  memcpy (row->glyphs, pointers, sizeof pointers);
+  memcpy (row->glyphs[TEXT_AREA], mc->glyphs,
+	  row->used[TEXT_AREA] * sizeof *mc->glyphs);
+  mc->used = ++mode_line_cache_clock;
+}
+
+/* Remember the line with face FACE_ID just produced by IT in entry MC,
+   with the inputs collected in mode_line_key.  */
+
+static void
+store_mode_line_cache (struct mode_line_cache *mc, struct it *it,
+		       int face_id)
+{
+  struct glyph_row *row = it->glyph_row;
+  struct glyph *glyph = row->glyphs[TEXT_AREA];
+  struct glyph *end = glyph + row->used[TEXT_AREA];
+  Lisp_Object strings = Qnil;
+
+  if (row->used[LEFT_MARGIN_AREA] || row->used[RIGHT_MARGIN_AREA])
+    {
+      mc->w = NULL;
+      return;
+    }
+
+  if (mc->glyphs_size < row->used[TEXT_AREA])
+    mc->glyphs = xpalloc (mc->glyphs, &mc->glyphs_size,
+			  row->used[TEXT_AREA] - mc->glyphs_size, -1,
+			  sizeof *mc->glyphs);
+  memcpy (mc->glyphs, glyph, row->used[TEXT_AREA] * sizeof *glyph);
+  for (; glyph < end; glyph++)
+    if (STRINGP (glyph->object)
+	&& !(CONSP (strings) && EQ (XCAR (strings), glyph->object)))
+      strings = Fcons (glyph->object, strings);
+
+  if (mc->specs_size < mode_line_key_nspecs)
+    mc->specs = xpalloc (mc->specs, &mc->specs_size,
+			 mode_line_key_nspecs - mc->specs_size, -1, 1);
+  memcpy (mc->specs, mode_line_key_specs, mode_line_key_nspecs);
+  mc->nspecs = mode_line_key_nspecs;
+
+  mc->row = *row;
+  mc->w = it->w;
+  mc->face_id = face_id;
+  mc->used = ++mode_line_cache_clock;
+
+  ASET (mode_line_cache_data, MODE_LINE_CACHE_SLOT (mc, 0), it->window);
+  ASET (mode_line_cache_data, MODE_LINE_CACHE_SLOT (mc, 1), mode_line_key);
+  ASET (mode_line_cache_data, MODE_LINE_CACHE_SLOT (mc, 2), strings);
+  ASET (mode_line_cache_data, MODE_LINE_CACHE_SLOT (mc, 3),
+	copy_layout_list (Vface_remapping_alist, 1));
+  ASET (mode_line_cache_data, MODE_LINE_CACHE_SLOT (mc, 4),
+	it->dp ? Fcopy_sequence (display_table_object (it)) : Qnil);
+}
+
+DEFUN ("mode-line-cache-statistics", Fmode_line_cache_statistics,
+       Smode_line_cache_statistics, 0, 0, 0,
+       doc: /* Return statistics about redisplaying mode and header lines.
+The value is a list (HITS MISSES).  HITS is the number of times a mode
+or header line was found among remembered lines, and MISSES the number
+of times it had to be produced again.  See `cache-mode-lines'.  */)
+  (void)
+{
+  return list2 (make_number (mode_line_cache_hits),
+		make_number (mode_line_cache_misses));
+}
+
+
 /* Display the mode and/or header line of window W.  Value is the
    sum number of mode lines and header lines displayed.  */
 
@@ -20758,6 +22277,7 @@ display_mode_lines (struct window *w)
   Lisp_Object new_frame = w->frame;
   Lisp_Object old_frame_selected_window = XFRAME (new_frame)->selected_window;
   int n = 0;
+  struct timespec start = REDISPLAY_PHASE_START ();
 
   selected_frame = new_frame;
   /* FIXME: If we were to allow the mode-line's computation changing the buffer
@@ -20789,6 +22309,7 @@ display_mode_lines (struct window *w)
   XFRAME (new_frame)->selected_window = old_frame_selected_window;
   selected_frame = old_selected_frame;
   selected_window = old_selected_window;
+  REDISPLAY_PHASE_END (w, REDISPLAY_PHASE_MODE_LINES, start);
   return n;
 }
 
@@ -20805,6 +22326,7 @@ display_mode_line (struct window *w, enum face_id face_id, Lisp_Object format)
   struct it it;
   struct face *face;
   ptrdiff_t count = SPECPDL_INDEX ();
+  struct mode_line_cache *mc = NULL;
 
   init_iterator (&it, w, -1, -1, NULL, face_id);
   /* Don't extend on a previously drawn mode-line.
@@ -20821,14 +22343,46 @@ display_mode_line (struct window *w, enum face_id face_id, Lisp_Object format)
 
   record_unwind_protect (unwind_format_mode_line,
 			 format_mode_line_unwind_data (NULL, NULL, Qnil, 0));
-
-  mode_line_target = MODE_LINE_DISPLAY;
+  record_unwind_protect_void (unwind_mode_line_key);
 
   /* Temporarily make frame's keyboard the current kboard so that
      kboard-local variables in the mode_line_format will get the right
      values.  */
   push_kboard (FRAME_KBOARD (it.f));
   record_unwind_save_match_data ();
+
+  /* See whether the line can be taken from the cache.  */
+  if (cache_mode_lines)
+    {
+      bool hit;
+
+      mode_line_target = MODE_LINE_KEY;
+      mode_line_key = Qnil;
+      mode_line_key_nspecs = 0;
+      mode_line_eval_values = Qnil;
+      mode_line_spec_strings = Qnil;
+      display_mode_element (&it, 0, 0, 0, format, Qnil, 0);
+      mc = lookup_mode_line_cache (&it, face_id, &hit);
+      if (hit)
+	{
+	  mode_line_cache_hits++;
+	  pop_kboard ();
+	  unbind_to (count, Qnil);
+	  use_mode_line_cache (mc, it.glyph_row);
+	  mode_line_key = Qnil;
+	  return it.glyph_row->height;
+	}
+      mode_line_cache_misses++;
+
+      /* Use the :eval values and %-construct expansions just computed
+	 to produce the glyphs.  */
+      mode_line_eval_values = Fnreverse (mode_line_eval_values);
+      mode_line_spec_strings = Fnreverse (mode_line_spec_strings);
+      mode_line_spec_pos = 0;
+      mode_line_spec_end = mode_line_key_nspecs;
+    }
+
+  mode_line_target = MODE_LINE_DISPLAY;
   display_mode_element (&it, 0, 0, 0, format, Qnil, 0);
   pop_kboard ();
 
@@ -20853,6 +22407,12 @@ display_mode_line (struct window *w, enum face_id face_id, Lisp_Object format)
       last->right_box_line_p = 1;
     }
 
+  if (mc)
+    {
+      store_mode_line_cache (mc, &it, face_id);
+      mode_line_key = Qnil;
+    }
+
   return it.glyph_row->height;
 }
 
@@ -21021,6 +22581,10 @@ display_mode_element (struct it *it, int depth, int field_width, int precision,
 		n += display_string (NULL, elt, Qnil, 0, 0, it,
 				     0, prec, 0, STRING_MULTIBYTE (elt));
 		break;
+	      case MODE_LINE_KEY:
+		record_mode_line_input (Qt);
+		record_mode_line_input (elt);
+		break;
 	      }
 
 	    break;
@@ -21028,6 +22592,9 @@ display_mode_element (struct it *it, int depth, int field_width, int precision,
 
 	/* Handle the non-literal case.  */
 
+	if (mode_line_target == MODE_LINE_KEY)
+	  record_mode_line_input (elt);
+
 	while ((precision <= 0 || n < precision)
 	       && SREF (elt, offset) != 0
 	       && (mode_line_target != MODE_LINE_DISPLAY
@@ -21084,6 +22651,8 @@ display_mode_element (struct it *it, int depth, int field_width, int precision,
 					   STRING_MULTIBYTE (elt));
 		    }
 		    break;
+		  case MODE_LINE_KEY:
+		    break;
 		  }
 	      }
 	    else /* c == '%' */
@@ -21118,7 +22687,11 @@ display_mode_element (struct it *it, int depth, int field_width, int precision,
 		    charpos = (STRING_MULTIBYTE (elt)
 			       ? string_byte_to_char (elt, bytepos)
 			       : bytepos);
-		    spec = decode_mode_spec (it->w, c, field, &string);
+		    spec = (mode_line_target == MODE_LINE_DISPLAY
+			    ? replay_mode_line_spec (c, field, &string)
+			    : NULL);
+		    if (!spec)
+		      spec = decode_mode_spec (it->w, c, field, &string);
 		    multibyte = STRINGP (string) && STRING_MULTIBYTE (string);
 
 		    switch (mode_line_target)
@@ -21165,6 +22738,9 @@ display_mode_element (struct it *it, int depth, int field_width, int precision,
 			    }
 			}
 			break;
+		      case MODE_LINE_KEY:
+			record_mode_line_spec (c, field, spec, string);
+			break;
 		      }
 		  }
 		else /* c == 0 */
@@ -21231,7 +22807,7 @@ display_mode_element (struct it *it, int depth, int field_width, int precision,
 	    if (CONSP (XCDR (elt)))
 	      {
 		Lisp_Object spec;
-		spec = safe_eval (XCAR (XCDR (elt)));
+		spec = mode_line_eval (XCAR (XCDR (elt)));
 		n += display_mode_element (it, depth, field_width - n,
 					   precision - n, spec, props,
 					   risky);
@@ -21281,6 +22857,8 @@ display_mode_element (struct it *it, int depth, int field_width, int precision,
 	else if (INTEGERP (car))
 	  {
 	    register int lim = XINT (car);
+	    if (mode_line_target == MODE_LINE_KEY)
+	      record_mode_line_input (car);
 	    elt = XCDR (elt);
 	    if (lim < 0)
 	      {
@@ -21354,6 +22932,8 @@ display_mode_element (struct it *it, int depth, int field_width, int precision,
 	  n += display_string ("", Qnil, Qnil, 0, 0, it, field_width - n,
 			       0, 0, 0);
 	  break;
+	case MODE_LINE_KEY:
+	  break;
 	}
     }
 
@@ -22943,7 +24523,11 @@ init_glyph_string (struct glyph_string *s,
   s->hdc = hdc;
 #endif
   s->display = FRAME_X_DISPLAY (s->f);
+#ifdef HAVE_X_WINDOWS
+  s->window = FRAME_X_DRAWABLE (s->f);
+#else
   s->window = FRAME_X_WINDOW (s->f);
+#endif
   s->char2b = char2b;
   s->hl = hl;
   s->row = row;
@@ -23403,7 +24987,7 @@ get_per_char_metric (struct font *font, XChar2b *char2b)
   code = (XCHAR2B_BYTE1 (char2b) << 8) | XCHAR2B_BYTE2 (char2b);
   if (code == FONT_INVALID_CODE)
     return NULL;
-  font->driver->text_extents (font, &code, 1, &metrics);
+  font_glyph_metrics (font, code, &metrics);
   return &metrics;
 }
 
@@ -26980,10 +28564,15 @@ clear_mouse_face (Mouse_HLInfo *hlinfo)
 {
   int cleared = 0;
 
-  if (!hlinfo->mouse_face_hidden && !NILP (hlinfo->mouse_face_window))
+  if (!NILP (hlinfo->mouse_face_window))
     {
-      show_mouse_face (hlinfo, DRAW_NORMAL_TEXT);
-      cleared = 1;
+      /* The highlighting must be computed again.  */
+      mouse_highlight_glyph = NULL;
+      if (!hlinfo->mouse_face_hidden)
+	{
+	  show_mouse_face (hlinfo, DRAW_NORMAL_TEXT);
+	  cleared = 1;
+	}
     }
 
   reset_mouse_highlight (hlinfo);
@@ -28258,6 +29847,7 @@ note_mouse_highlight (struct frame *f, int x, int y)
   Cursor cursor = No_Cursor;
   Lisp_Object pointer = Qnil;  /* Takes precedence over cursor!  */
   struct buffer *b;
+  struct glyph *last_glyph;
 
   /* When a menu is active, don't highlight because this looks odd.  */
 #if defined (USE_X_TOOLKIT) || defined (USE_GTK) || defined (HAVE_NS) || defined (MSDOS)
@@ -28276,6 +29866,9 @@ note_mouse_highlight (struct frame *f, int x, int y)
   if (hlinfo->mouse_face_defer)
     return;
 
+  last_glyph = mouse_highlight_glyph;
+  mouse_highlight_glyph = NULL;
+
   /* Which window is that in?  */
   window = window_from_coordinates (f, x, y, &part, 1);
 
@@ -28350,6 +29943,22 @@ note_mouse_highlight (struct frame *f, int x, int y)
       /* Find the glyph under X/Y.  */
       glyph = x_y_to_hpos_vpos (w, x, y, &hpos, &vpos, &dx, &dy, &area);
 
+      /* If the mouse only moved within the glyph it was on last time,
+	 nothing has changed.  Image maps can give different results
+	 for different parts of an image glyph, so always look again
+	 at those.  */
+      if (glyph != NULL
+	  && glyph == last_glyph
+	  && glyph->type != IMAGE_GLYPH)
+	{
+	  mouse_highlight_glyph = glyph;
+	  help_echo_string = mouse_highlight_help_string;
+	  help_echo_window = mouse_highlight_help_window;
+	  help_echo_object = mouse_highlight_help_object;
+	  help_echo_pos = mouse_highlight_help_pos;
+	  return;
+	}
+
 #ifdef HAVE_WINDOW_SYSTEM
       /* Look for :pointer property on image.  */
       if (glyph != NULL && glyph->type == IMAGE_GLYPH)
@@ -28728,6 +30337,12 @@ note_mouse_highlight (struct frame *f, int x, int y)
       BEGV = obegv;
       ZV = ozv;
       current_buffer = obuf;
+
+      mouse_highlight_glyph = glyph;
+      mouse_highlight_help_string = help_echo_string;
+      mouse_highlight_help_window = help_echo_window;
+      mouse_highlight_help_object = help_echo_object;
+      mouse_highlight_help_pos = help_echo_pos;
     }
 
  set_cursor:
@@ -29325,9 +30940,43 @@ syms_of_xdisp (void)
   Vmessage_stack = Qnil;
   staticpro (&Vmessage_stack);
 
+  line_checkpoint_owners
+    = Fmake_vector (make_number (LINE_CHECKPOINT_OWNERS * N_LINE_CHECKPOINTS),
+		    Qnil);
+  staticpro (&line_checkpoint_owners);
+
+  redisplay_profile_log = Qnil;
+  staticpro (&redisplay_profile_log);
+
+  mode_line_cache_data = Fmake_vector (make_number (5 * N_MODE_LINE_CACHE),
+				       Qnil);
+  staticpro (&mode_line_cache_data);
+  shared_row_windows = Fmake_vector (make_number (N_SHARED_ROWS), Qnil);
+  staticpro (&shared_row_windows);
+  mode_line_key = Qnil;
+  staticpro (&mode_line_key);
+  mode_line_eval_values = Qnil;
+  staticpro (&mode_line_eval_values);
+  mode_line_spec_strings = Qnil;
+  staticpro (&mode_line_spec_strings);
+  fontification_skipped_windows = Qnil;
+  staticpro (&fontification_skipped_windows);
+
   DEFSYM (Qinhibit_redisplay, "inhibit-redisplay");
   DEFSYM (Qredisplay_internal, "redisplay_internal (C function)");
 
+  /* Names of redisplay methods in the redisplay profile.  */
+  DEFSYM (Qthis_line, "this-line");
+  DEFSYM (Qcursor_in_line, "cursor-in-line");
+  DEFSYM (Qunchanged, "unchanged");
+  DEFSYM (Qcursor_movement, "cursor-movement");
+  DEFSYM (Qtry_window_id, "try-window-id");
+  DEFSYM (Qreuse_current_matrix, "reuse-current-matrix");
+  DEFSYM (Qtry_window, "try-window");
+  DEFSYM (Qforced_start, "forced-start");
+  DEFSYM (Qscrolling, "scrolling");
+  DEFSYM (Qrecenter, "recenter");
+
   message_dolog_marker1 = Fmake_marker ();
   staticpro (&message_dolog_marker1);
   message_dolog_marker2 = Fmake_marker ();
@@ -29349,9 +30998,12 @@ syms_of_xdisp (void)
 #endif
   defsubr (&Sline_pixel_height);
   defsubr (&Sformat_mode_line);
+  defsubr (&Smode_line_cache_statistics);
   defsubr (&Sinvisible_p);
   defsubr (&Scurrent_bidi_paragraph_direction);
   defsubr (&Smove_point_visually);
+  defsubr (&Sredisplay_profile_log);
+  defsubr (&Sredisplay_profile_write);
 
   DEFSYM (Qmenu_bar_update_hook, "menu-bar-update-hook");
   DEFSYM (Qoverriding_terminal_local_map, "overriding-terminal-local-map");
@@ -29451,6 +31103,12 @@ syms_of_xdisp (void)
   previous_help_echo_string = Qnil;
   staticpro (&previous_help_echo_string);
   help_echo_pos = -1;
+  mouse_highlight_help_string = Qnil;
+  staticpro (&mouse_highlight_help_string);
+  mouse_highlight_help_window = Qnil;
+  staticpro (&mouse_highlight_help_window);
+  mouse_highlight_help_object = Qnil;
+  staticpro (&mouse_highlight_help_object);
 
   DEFSYM (Qright_to_left, "right-to-left");
   DEFSYM (Qleft_to_right, "left-to-right");
@@ -29735,6 +31393,16 @@ fontified regions the property `fontified'.  */);
   Vfontification_functions = Qnil;
   Fmake_variable_buffer_local (Qfontification_functions);
 
+  DEFVAR_BOOL ("redisplay-skip-fontification-on-input",
+	       redisplay_skip_fontification_on_input,
+    doc: /* Non-nil means don't call `fontification-functions' while input is pending.
+Text that would have been fontified is displayed without its faces,
+and is fontified by a later redisplay, once Emacs has caught up with
+the input.  This keeps Emacs responsive while keys are auto-repeating
+in buffers that are expensive to fontify, at the price of briefly
+showing unfontified text.  */);
+  redisplay_skip_fontification_on_input = 0;
+
   DEFVAR_BOOL ("unibyte-display-via-language-environment",
                unibyte_display_via_language_environment,
     doc: /* Non-nil means display unibyte text according to language environment.
@@ -29873,6 +31541,32 @@ To add a prefix to continuation lines, use `wrap-prefix'.  */);
   inhibit_try_cursor_movement = 0;
 #endif /* GLYPH_DEBUG */
 
+  DEFVAR_BOOL ("share-glyph-rows", share_glyph_rows,
+	       doc: /* Non-nil means windows showing the same text share its display.
+When a line of a buffer is displayed in two windows of a frame, and
+the windows have the same width, margins, fringes and horizontal
+scrolling, the second window copies the display of the line from the
+first one instead of computing it again.  Lines showing overlays that
+are specific to a window are not shared.  */);
+  share_glyph_rows = 0;
+
+  DEFVAR_BOOL ("cache-mode-lines", cache_mode_lines,
+	       doc: /* Non-nil means reuse mode lines whose contents did not change.
+When a mode line or header line is redisplayed, its format is first
+evaluated, including `:eval' forms and %-constructs, without producing
+glyphs.  If that yields the same strings as the last time the line
+was displayed in the same window, the glyphs produced then are used
+again.  A string that is changed in place with `aset' is not noticed,
+so mode line constructs should not be modified that way.  */);
+  cache_mode_lines = 1;
+
+  DEFVAR_BOOL ("profile-redisplay", profile_redisplay,
+	       doc: /* Non-nil means record how long each part of redisplay takes.
+The record of each redisplay cycle is added to a log that
+`redisplay-profile-log' returns and `redisplay-profile-write'
+writes to a file.  */);
+  profile_redisplay = 0;
+
   DEFVAR_INT ("overline-margin", overline_margin,
 	       doc: /* Space between overline and text, in pixels.
 The default value is 2: the height of the overline (1 pixel) plus 1 pixel
@@ -443,6 +443,7 @@ static bool realize_default_face (struct frame *);
 static void realize_named_face (struct frame *, Lisp_Object, int);
 static struct face_cache *make_face_cache (struct frame *);
 static void free_face_cache (struct face_cache *);
+static void clear_face_merge_cache (struct face_cache *);
 static int merge_face_ref (struct frame *, Lisp_Object, Lisp_Object *,
 			   int, struct named_merge_point *);
 
@@ -4165,6 +4166,7 @@ make_face_cache (struct frame *f)
   c->faces_by_id = xmalloc (c->size * sizeof *c->faces_by_id);
   c->f = f;
   c->menu_face_changed_p = menu_face_changed_default;
+  c->merge_cache = NULL;
   return c;
 }
 
@@ -4225,6 +4227,7 @@ free_realized_faces (struct face_cache *c)
       c->used = 0;
       size = FACE_CACHE_BUCKETS_SIZE * sizeof *c->buckets;
       memset (c->buckets, 0, size);
+      clear_face_merge_cache (c);
 
       /* Must do a thorough redisplay the next time.  Mark current
 	 matrices as invalid because they will reference faces freed
@@ -4269,6 +4272,7 @@ free_face_cache (struct face_cache *c)
       free_realized_faces (c);
       xfree (c->buckets);
       xfree (c->faces_by_id);
+      xfree (c->merge_cache);
       xfree (c);
     }
 }
@@ -4367,6 +4371,7 @@ uncache_face (struct face_cache *c, struct face *face)
   c->faces_by_id[face->id] = NULL;
   if (face->id == c->used)
     --c->used;
+  clear_face_merge_cache (c);
 }
 
 
@@ -5907,6 +5912,98 @@ compute_char_face (struct frame *f, int ch, Lisp_Object prop)
   return face_id;
 }
 
+/* Results of face_at_buffer_position.
+
+   Computing the face at a buffer position merges the face
+   specifications from text properties and overlays into a base face,
+   and looks up the result in the face cache.  The same combinations
+   of specifications occur at many positions, so the resulting face ID
+   is remembered in a direct-mapped table of the face cache, keyed by
+   the identity of the specifications, not their contents.  Only face
+   names are remembered, because lists of faces and attributes can be
+   changed in place.  The table is emptied when a realized face is
+   freed, and not used while face_change_count is non-zero, i.e. when
+   realized faces may no longer reflect face definitions, or while
+   face-remapping-alist is non-nil, since face-remap.el changes that
+   in place too.  */
+
+/* Number of times face_at_buffer_position found its result in the
+   table, and number of times it had to merge faces.  */
+
+static EMACS_INT face_merge_hits, face_merge_misses;
+
+/* Empty the table of results of face_at_buffer_position of face
+   cache C.  */
+
+static void
+clear_face_merge_cache (struct face_cache *c)
+{
+  if (c->merge_cache)
+    {
+      int i;
+
+      for (i = 0; i < FACE_MERGE_CACHE_SIZE; i++)
+	c->merge_cache[i].base_face_id = -1;
+    }
+}
+
+/* Return the entry of the table of face cache C for merging the
+   NPROPS face specifications PROPS, and the `region' face if
+   REGION_P, into face BASE_FACE_ID.  */
+
+static struct face_merge_entry *
+face_merge_entry (struct face_cache *c, int base_face_id,
+		  Lisp_Object *props, int nprops, bool region_p)
+{
+  EMACS_UINT hash = base_face_id * 2 + region_p;
+  int i;
+
+  if (! c->merge_cache)
+    {
+      c->merge_cache = xmalloc (FACE_MERGE_CACHE_SIZE
+				* sizeof *c->merge_cache);
+      clear_face_merge_cache (c);
+    }
+
+  for (i = 0; i < nprops; i++)
+    hash = hash * 31 + (XHASH (props[i]) >> GCTYPEBITS);
+  hash ^= hash >> 16;
+  return &c->merge_cache[hash % FACE_MERGE_CACHE_SIZE];
+}
+
+/* Value is non-zero if ENTRY records merging the NPROPS face
+   specifications PROPS, and the `region' face if REGION_P, into face
+   BASE_FACE_ID.  */
+
+static bool
+face_merge_entry_match_p (struct face_merge_entry *entry, int base_face_id,
+			  Lisp_Object *props, int nprops, bool region_p)
+{
+  int i;
+
+  if (entry->base_face_id != base_face_id
+      || entry->nprops != nprops
+      || entry->region_p != region_p)
+    return 0;
+  for (i = 0; i < nprops; i++)
+    if (!EQ (entry->props[i], props[i]))
+      return 0;
+  return 1;
+}
+
+DEFUN ("face-merge-cache-statistics", Fface_merge_cache_statistics,
+       Sface_merge_cache_statistics, 0, 0, 0,
+       doc: /* Return statistics about computing faces at buffer positions.
+The value is a list (HITS MISSES).  HITS is the number of times the
+face at a buffer position was found among remembered results, and
+MISSES the number of times faces had to be merged to compute it.  */)
+  (void)
+{
+  return list2 (make_number (face_merge_hits),
+		make_number (face_merge_misses));
+}
+
+
 /* Return the face ID associated with buffer position POS for
    displaying ASCII characters.  Return in *ENDPTR the position at
    which a different face is needed, as far as text properties and
@@ -5940,6 +6037,10 @@ face_at_buffer_position (struct window *w, ptrdiff_t pos,
   Lisp_Object propname = mouse ? Qmouse_face : Qface;
   Lisp_Object limit1, end;
   struct face *default_face;
+  Lisp_Object props[FACE_MERGE_MAX_PROPS];
+  int nprops;
+  bool region_p, cacheable;
+  struct face_merge_entry *entry;
 
   /* W must display the current buffer.  We could write this function
      to use the frame and buffer of W, but right now it doesn't.  */
@@ -5983,29 +6084,30 @@ face_at_buffer_position (struct window *w, ptrdiff_t pos,
     default_face = FACE_FROM_ID (f, face_id);
   }
 
+  region_p = pos >= region_beg && pos < region_end;
+
   /* Optimize common cases where we can use the default face.  */
-  if (noverlays == 0
-      && NILP (prop)
-      && !(pos >= region_beg && pos < region_end))
+  if (noverlays == 0 && NILP (prop) && !region_p)
     return default_face->id;
 
-  /* Begin with attributes from the default face.  */
-  memcpy (attrs, default_face->lface, sizeof attrs);
-
-  /* Merge in attributes specified via text properties.  */
+  /* Collect the face specifications to merge, and determine where
+     the overlays end.  */
+  nprops = 0;
   if (!NILP (prop))
-    merge_face_ref (f, prop, attrs, 1, 0);
-
-  /* Now merge the overlay data.  */
+    props[nprops++] = prop;
   noverlays = sort_overlays (overlay_vec, noverlays, w);
   for (i = 0; i < noverlays; i++)
     {
-      Lisp_Object oend;
+      Lisp_Object oprop, oend;
       ptrdiff_t oendpos;
 
-      prop = Foverlay_get (overlay_vec[i], propname);
-      if (!NILP (prop))
-	merge_face_ref (f, prop, attrs, 1, 0);
+      oprop = Foverlay_get (overlay_vec[i], propname);
+      if (!NILP (oprop))
+	{
+	  if (nprops < FACE_MERGE_MAX_PROPS)
+	    props[nprops] = oprop;
+	  nprops++;
+	}
 
       oend = OVERLAY_END (overlay_vec[i]);
       oendpos = OVERLAY_POSITION (oend);
@@ -6013,20 +6115,64 @@ face_at_buffer_position (struct window *w, ptrdiff_t pos,
 	endpos = oendpos;
     }
 
-  /* If in the region, merge in the region face.  */
-  if (pos >= region_beg && pos < region_end)
-    {
-      merge_named_face (f, Qregion, attrs, 0);
+  if (region_p && region_end < endpos)
+    endpos = region_end;
 
-      if (region_end < endpos)
-	endpos = region_end;
+  *endptr = endpos;
+
+  /* See if the result of merging these specifications is known.  */
+  entry = NULL;
+  cacheable = (nprops <= FACE_MERGE_MAX_PROPS && face_change_count == 0
+	       && NILP (Vface_remapping_alist));
+  for (i = 0; cacheable && i < nprops; i++)
+    cacheable = SYMBOLP (props[i]);
+  if (cacheable)
+    {
+      entry = face_merge_entry (FRAME_FACE_CACHE (f), default_face->id,
+				props, nprops, region_p);
+      if (face_merge_entry_match_p (entry, default_face->id,
+				    props, nprops, region_p))
+	{
+	  face_merge_hits++;
+	  return entry->face_id;
+	}
     }
+  face_merge_misses++;
 
-  *endptr = endpos;
+  /* Begin with attributes from the default face.  */
+  memcpy (attrs, default_face->lface, sizeof attrs);
+
+  /* Merge in attributes specified via text properties.  */
+  if (!NILP (prop))
+    merge_face_ref (f, prop, attrs, 1, 0);
+
+  /* Now merge the overlay data.  */
+  for (i = 0; i < noverlays; i++)
+    {
+      Lisp_Object oprop = Foverlay_get (overlay_vec[i], propname);
+      if (!NILP (oprop))
+	merge_face_ref (f, oprop, attrs, 1, 0);
+    }
+
+  /* If in the region, merge in the region face.  */
+  if (region_p)
+    merge_named_face (f, Qregion, attrs, 0);
 
   /* Look up a realized face with the given face attributes,
      or realize a new one for ASCII characters.  */
-  return lookup_face (f, attrs);
+  i = lookup_face (f, attrs);
+
+  /* Remember the result.  Realizing a face may have emptied the
+     table, but ENTRY still points into it.  */
+  if (entry)
+    {
+      entry->base_face_id = default_face->id;
+      entry->nprops = nprops;
+      memcpy (entry->props, props, nprops * sizeof *props);
+      entry->region_p = region_p;
+      entry->face_id = i;
+    }
+  return i;
 }
 
 /* Return the face ID at buffer position POS for displaying ASCII
@@ -6500,6 +6646,7 @@ syms_of_xfaces (void)
   defsubr (&Sshow_face_resources);
 #endif /* GLYPH_DEBUG */
   defsubr (&Sclear_face_cache);
+  defsubr (&Sface_merge_cache_statistics);
   defsubr (&Stty_suppress_bold_inverse_default_colors);
 
 #if defined DEBUG_X_COLORS && defined HAVE_X_WINDOWS
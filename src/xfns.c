@@ -998,8 +998,7 @@ x_set_menu_bar_lines (struct frame *f, Lisp_Object value, Lisp_Object oldval)
 	  y = FRAME_TOP_MARGIN_HEIGHT (f);
 
 	  block_input ();
-	  x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-			0, y, width, height);
+	  x_clear_area (f, 0, y, width, height);
 	  unblock_input ();
 	}
 
@@ -1009,8 +1008,7 @@ x_set_menu_bar_lines (struct frame *f, Lisp_Object value, Lisp_Object oldval)
 	  height = nlines * FRAME_LINE_HEIGHT (f) - y;
 
 	  block_input ();
-	  x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-			0, y, width, height);
+	  x_clear_area (f, 0, y, width, height);
 	  unblock_input ();
 	}
 
@@ -1111,8 +1109,7 @@ x_set_tool_bar_lines (struct frame *f, Lisp_Object value, Lisp_Object oldval)
       if (height > 0 && width > 0)
 	{
           block_input ();
-	  x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-			0, y, width, height);
+	  x_clear_area (f, 0, y, width, height);
           unblock_input ();
         }
 
@@ -3610,6 +3607,26 @@ If omitted or nil, that stands for the selected frame's display.  */)
     return Qnil;
 }
 
+DEFUN ("x-display-update-statistics", Fx_display_update_statistics,
+       Sx_display_update_statistics, 0, 1, 0,
+       doc: /* Return statistics about frame updates on the X display TERMINAL.
+The value is a list (UPDATES REQUESTS LAST-REQUESTS).  UPDATES is the
+number of frame updates done by redisplay on the display, REQUESTS is
+the total number of X requests they sent, and LAST-REQUESTS is the
+number of X requests sent by the most recent update.
+
+The optional argument TERMINAL specifies which display to ask about.
+TERMINAL should be a terminal object, a frame or a display name (a string).
+If omitted or nil, that stands for the selected frame's display.  */)
+  (Lisp_Object terminal)
+{
+  struct x_display_info *dpyinfo = check_x_display_info (terminal);
+
+  return list3 (make_number (dpyinfo->n_updates),
+		make_number (dpyinfo->n_update_requests),
+		make_number (dpyinfo->last_update_requests));
+}
+
 /* Store the geometry of the workarea on display DPYINFO into *RECT.
    Return false if and only if the workarea information cannot be
    obtained via the _NET_WORKAREA root window property.  */
@@ -6155,6 +6172,7 @@ When using Gtk+ tooltips, the tooltip face is not used.  */);
   defsubr (&Sx_display_visual_class);
   defsubr (&Sx_display_backing_store);
   defsubr (&Sx_display_save_under);
+  defsubr (&Sx_display_update_statistics);
   defsubr (&Sx_display_monitor_attributes_list);
   defsubr (&Sx_wm_set_size_hint);
   defsubr (&Sx_create_frame);
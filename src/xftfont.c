@@ -605,13 +605,20 @@ xftfont_get_xft_draw (struct frame *f)
     {
       block_input ();
       xft_draw= XftDrawCreate (FRAME_X_DISPLAY (f),
-			       FRAME_X_WINDOW (f),
+			       FRAME_X_DRAWABLE (f),
 			       FRAME_X_VISUAL (f),
 			       FRAME_X_COLORMAP (f));
       unblock_input ();
       eassert (xft_draw != NULL);
       font_put_frame_data (f, &xftfont_driver, xft_draw);
     }
+  else if (XftDrawDrawable (xft_draw) != FRAME_X_DRAWABLE (f))
+    {
+      /* The frame's back buffer was created or freed.  */
+      block_input ();
+      XftDrawChange (xft_draw, FRAME_X_DRAWABLE (f));
+      unblock_input ();
+    }
   return xft_draw;
 }
 
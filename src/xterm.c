@@ -308,6 +308,7 @@ static void x_clip_to_row (struct window *, struct glyph_row *,
 			   enum glyph_row_area, GC);
 static void x_flush (struct frame *f);
 static void x_update_begin (struct frame *);
+static void x_show_back_buffer (struct frame *);
 static void x_update_window_begin (struct window *);
 static struct scroll_bar *x_window_to_scroll_bar (Display *, Window);
 static void x_scroll_bar_report_motion (struct frame **, Lisp_Object *,
@@ -343,6 +344,7 @@ x_flush (struct frame *f)
     return;
 
   block_input ();
+  x_show_back_buffer (f);
   XFlush (FRAME_X_DISPLAY (f));
   unblock_input ();
 }
@@ -357,6 +359,165 @@ x_flush (struct frame *f)
 
 #define XFlush(DISPLAY)	(void) 0
 
+
+/***********************************************************************
+			     Back buffers
+ ***********************************************************************/
+
+/* When x-use-back-buffer is non-nil, display output for a frame is
+   drawn into an off-screen pixmap, the frame's back buffer, instead
+   of its window.  The part of the back buffer drawn into is recorded
+   as the frame's damage rectangle, and copied to the window with a
+   single XCopyArea at the end of each update.  This avoids flicker,
+   and lets Expose events be handled by copying from the back buffer
+   instead of redrawing, once a complete update has drawn everything
+   into it; see x_complete_back_buffer.
+
+   Drawing done outside an update, for the cursor or mouse
+   highlight, is shown as soon as it is done; see x_end_drawing.  */
+
+/* Record that the rectangle X, Y, WIDTH, HEIGHT of frame F's back
+   buffer has been drawn into.  */
+
+static void
+x_damage (struct frame *f, int x, int y, int width, int height)
+{
+  struct x_output *output = f->output_data.x;
+
+  if (output->back_buffer == None || width <= 0 || height <= 0)
+    return;
+
+  if (output->damage_x0 >= output->damage_x1)
+    {
+      output->damage_x0 = x;
+      output->damage_y0 = y;
+      output->damage_x1 = x + width;
+      output->damage_y1 = y + height;
+    }
+  else
+    {
+      output->damage_x0 = min (output->damage_x0, x);
+      output->damage_y0 = min (output->damage_y0, y);
+      output->damage_x1 = max (output->damage_x1, x + width);
+      output->damage_y1 = max (output->damage_y1, y + height);
+    }
+}
+
+/* Copy the damaged part of frame F's back buffer to its window, and
+   clear the damage.  */
+
+static void
+x_show_back_buffer (struct frame *f)
+{
+  struct x_output *output = f->output_data.x;
+  int x0, y0, x1, y1;
+
+  if (output->back_buffer == None
+      || output->damage_x0 >= output->damage_x1)
+    return;
+
+  x0 = max (output->damage_x0, 0);
+  y0 = max (output->damage_y0, 0);
+  x1 = min (output->damage_x1, output->back_buffer_width);
+  y1 = min (output->damage_y1, output->back_buffer_height);
+  if (x0 < x1 && y0 < y1)
+    XCopyArea (FRAME_X_DISPLAY (f), output->back_buffer, FRAME_X_WINDOW (f),
+	       output->back_buffer_gc, x0, y0, x1 - x0, y1 - y0, x0, y0);
+
+  output->damage_x0 = output->damage_x1 = 0;
+  output->damage_y0 = output->damage_y1 = 0;
+}
+
+/* Called after drawing into frame F.  Show the drawing unless it is
+   part of an update, whose output is shown by x_update_end.  */
+
+static void
+x_end_drawing (struct frame *f)
+{
+  if (!f->output_data.x->updating_p)
+    x_show_back_buffer (f);
+}
+
+/* Free frame F's back buffer, if it has one, after showing what has
+   been drawn into it.  */
+
+static void
+x_free_back_buffer (struct frame *f)
+{
+  struct x_output *output = f->output_data.x;
+
+  if (output->back_buffer == None)
+    return;
+
+  x_show_back_buffer (f);
+  XFreePixmap (FRAME_X_DISPLAY (f), output->back_buffer);
+  XFreeGC (FRAME_X_DISPLAY (f), output->back_buffer_gc);
+  output->back_buffer = None;
+  output->back_buffer_gc = 0;
+}
+
+/* Give frame F a back buffer of the frame's current size if
+   x-use-back-buffer is non-nil, or free its back buffer if not.  A
+   new back buffer starts out as a copy of the window's contents,
+   which lacks the parts of the window that are obscured.  */
+
+static void
+x_update_back_buffer (struct frame *f)
+{
+  struct x_output *output = f->output_data.x;
+  Display *dpy = FRAME_X_DISPLAY (f);
+  int width = FRAME_PIXEL_WIDTH (f);
+  int height = FRAME_PIXEL_HEIGHT (f);
+  bool use_p = x_use_back_buffer && FRAME_X_WINDOW (f) != 0;
+
+  if (output->back_buffer != None
+      && (!use_p
+	  || output->back_buffer_width != width
+	  || output->back_buffer_height != height))
+    x_free_back_buffer (f);
+
+  if (use_p && output->back_buffer == None && width > 0 && height > 0)
+    {
+      XGCValues xgcv;
+
+      xgcv.graphics_exposures = False;
+      output->back_buffer_gc = XCreateGC (dpy, FRAME_X_WINDOW (f),
+					  GCGraphicsExposures, &xgcv);
+      output->back_buffer
+	= XCreatePixmap (dpy, FRAME_X_WINDOW (f), width, height,
+			 FRAME_DISPLAY_INFO (f)->n_planes);
+      output->back_buffer_width = width;
+      output->back_buffer_height = height;
+      XFillRectangle (dpy, output->back_buffer, output->reverse_gc,
+		      0, 0, width, height);
+      XCopyArea (dpy, FRAME_X_WINDOW (f), output->back_buffer,
+		 output->back_buffer_gc, 0, 0, width, height, 0, 0);
+      output->damage_x0 = output->damage_x1 = 0;
+      output->damage_y0 = output->damage_y1 = 0;
+      output->back_buffer_complete_p = 0;
+    }
+}
+
+/* Called when the display of frame F is up to date.  If F's back
+   buffer is new, draw all of F into it from the current matrices.  */
+
+static void
+x_complete_back_buffer (struct frame *f)
+{
+  struct x_output *output = f->output_data.x;
+
+  if (output->back_buffer != None
+      && !output->back_buffer_complete_p
+      && !FRAME_GARBAGED_P (f)
+      && FRAME_FACE_CACHE (f)
+      && FRAME_FACE_CACHE (f)->used >= BASIC_FACE_ID_SENTINEL)
+    {
+      expose_frame (f, 0, 0, output->back_buffer_width,
+		    output->back_buffer_height);
+      output->back_buffer_complete_p = 1;
+    }
+}
+
 
 /***********************************************************************
 			      Debugging
@@ -522,13 +683,18 @@ x_display_pixel_width (struct x_display_info *dpyinfo)
 /* Start an update of frame F.  This function is installed as a hook
    for update_begin, i.e. it is called when update_begin is called.
    This function is called prior to calls to x_update_window_begin for
-   each window being updated.  Currently, there is nothing to do here
-   because all interesting stuff is done on a window basis.  */
+   each window being updated.  Most interesting stuff is done on a
+   window basis; here we only set up the frame's back buffer and
+   remember where its X requests start.  */
 
 static void
 x_update_begin (struct frame *f)
 {
-  /* Nothing to do.  */
+  block_input ();
+  f->output_data.x->update_request_serial = XNextRequest (FRAME_X_DISPLAY (f));
+  f->output_data.x->updating_p = 1;
+  x_update_back_buffer (f);
+  unblock_input ();
 }
 
 
@@ -572,8 +738,10 @@ x_draw_vertical_window_border (struct window *w, int x, int y0, int y1)
     XSetForeground (FRAME_X_DISPLAY (f), f->output_data.x->normal_gc,
 		    face->foreground);
 
-  XDrawLine (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
+  XDrawLine (FRAME_X_DISPLAY (f), FRAME_X_DRAWABLE (f),
 	     f->output_data.x->normal_gc, x, y0, x, y1);
+  x_damage (f, x, y0, 1, y1 - y0 + 1);
+  x_end_drawing (f);
 }
 
 /* End update of window W.
@@ -621,9 +789,21 @@ x_update_window_end (struct window *w, bool cursor_on_p,
 static void
 x_update_end (struct frame *f)
 {
+  struct x_display_info *dpyinfo = FRAME_DISPLAY_INFO (f);
+
   /* Mouse highlight may be displayed again.  */
   MOUSE_HL_INFO (f)->mouse_face_defer = 0;
 
+  block_input ();
+  x_show_back_buffer (f);
+  f->output_data.x->updating_p = 0;
+  dpyinfo->last_update_requests
+    = (XNextRequest (FRAME_X_DISPLAY (f))
+       - f->output_data.x->update_request_serial);
+  dpyinfo->n_update_requests += dpyinfo->last_update_requests;
+  dpyinfo->n_updates++;
+  unblock_input ();
+
 #ifndef XFlush
   block_input ();
   XFlush (FRAME_X_DISPLAY (f));
@@ -639,7 +819,13 @@ static void
 XTframe_up_to_date (struct frame *f)
 {
   if (FRAME_X_P (f))
-    FRAME_MOUSE_UPDATE (f);
+    {
+      FRAME_MOUSE_UPDATE (f);
+      block_input ();
+      x_show_back_buffer (f);
+      x_complete_back_buffer (f);
+      unblock_input ();
+    }
 }
 
 
@@ -677,11 +863,8 @@ x_after_update_window_line (struct window *w, struct glyph_row *desired_row)
       int y = WINDOW_TO_FRAME_PIXEL_Y (w, max (0, desired_row->y));
 
       block_input ();
-      x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-		    0, y, width, height);
-      x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-		    FRAME_PIXEL_WIDTH (f) - width,
-		    y, width, height);
+      x_clear_area (f, 0, y, width, height);
+      x_clear_area (f, FRAME_PIXEL_WIDTH (f) - width, y, width, height);
       unblock_input ();
     }
 }
@@ -692,6 +875,7 @@ x_draw_fringe_bitmap (struct window *w, struct glyph_row *row, struct draw_fring
   struct frame *f = XFRAME (WINDOW_FRAME (w));
   Display *display = FRAME_X_DISPLAY (f);
   Window window = FRAME_X_WINDOW (f);
+  Drawable drawable = FRAME_X_DRAWABLE (f);
   GC gc = f->output_data.x->normal_gc;
   struct face *face = p->face;
 
@@ -759,7 +943,10 @@ x_draw_fringe_bitmap (struct window *w, struct glyph_row *row, struct draw_fring
 	}
 #endif
       if (bx >= 0 && nx > 0)
-	XFillRectangle (display, window, face->gc, bx, by, nx, ny);
+	{
+	  XFillRectangle (display, drawable, face->gc, bx, by, nx, ny);
+	  x_damage (f, bx, by, nx, ny);
+	}
 
       if (!face->stipple)
 	XSetForeground (display, face->gc, face->foreground);
@@ -798,9 +985,10 @@ x_draw_fringe_bitmap (struct window *w, struct glyph_row *row, struct draw_fring
 	  XChangeGC (display, gc, GCClipMask | GCClipXOrigin | GCClipYOrigin, &gcv);
 	}
 
-      XCopyArea (display, pixmap, window, gc, 0, 0,
+      XCopyArea (display, pixmap, drawable, gc, 0, 0,
 		 p->wd, p->h, p->x, p->y);
       XFreePixmap (display, pixmap);
+      x_damage (f, p->x, p->y, p->wd, p->h);
 
       if (p->overlay_p)
 	{
@@ -811,6 +999,7 @@ x_draw_fringe_bitmap (struct window *w, struct glyph_row *row, struct draw_fring
     }
 
   XSetClipMask (display, gc, None);
+  x_end_drawing (f);
 }
 
 /***********************************************************************
@@ -1019,10 +1208,14 @@ x_set_glyph_string_clipping (struct glyph_string *s)
 {
   XRectangle *r = s->clip;
   int n = get_glyph_string_clip_rects (s, r, 2);
+  int i;
 
   if (n > 0)
     XSetClipRectangles (s->display, s->gc, 0, 0, r, n, Unsorted);
   s->num_clips = n;
+
+  for (i = 0; i < n; i++)
+    x_damage (s->f, r[i].x, r[i].y, r[i].width, r[i].height);
 }
 
 
@@ -1042,6 +1235,7 @@ x_set_glyph_string_clipping_exactly (struct glyph_string *src, struct glyph_stri
   dst->clip[0] = r;
   dst->num_clips = 1;
   XSetClipRectangles (dst->display, dst->gc, 0, 0, &r, 1, Unsorted);
+  x_damage (dst->f, r.x, r.y, r.width, r.height);
 }
 
 
@@ -1919,10 +2113,12 @@ x_draw_relief_rect (struct frame *f,
 		    XRectangle *clip_rect)
 {
   Display *dpy = FRAME_X_DISPLAY (f);
-  Window window = FRAME_X_WINDOW (f);
+  Drawable window = FRAME_X_DRAWABLE (f);
   int i;
   GC gc;
 
+  x_damage (f, left_x, top_y, right_x - left_x + 1, bottom_y - top_y + 1);
+
   if (raised_p)
     gc = f->output_data.x->white_relief.gc;
   else
@@ -1954,8 +2150,8 @@ x_draw_relief_rect (struct frame *f,
       if (width == 1)
 	XDrawLine (dpy, window, gc, left_x, top_y + 1, left_x, bottom_y);
 
-      XClearArea (dpy, window, left_x, top_y, 1, 1, False);
-      XClearArea (dpy, window, left_x, bottom_y, 1, 1, False);
+      x_clear_area (f, left_x, top_y, 1, 1);
+      x_clear_area (f, left_x, bottom_y, 1, 1);
 
       for (i = (width > 1 ? 1 : 0); i < width; ++i)
 	XDrawLine (dpy, window, gc,
@@ -1998,8 +2194,8 @@ x_draw_relief_rect (struct frame *f,
   /* Right.  */
   if (right_p)
     {
-      XClearArea (dpy, window, right_x, top_y, 1, 1, False);
-      XClearArea (dpy, window, right_x, bottom_y, 1, 1, False);
+      x_clear_area (f, right_x, top_y, 1, 1);
+      x_clear_area (f, right_x, bottom_y, 1, 1);
       for (i = 0; i < width; ++i)
 	XDrawLine (dpy, window, gc,
 		   right_x - i, top_y + (i + 1) * top_p,
@@ -2653,6 +2849,11 @@ x_draw_glyph_string (struct glyph_string *s)
 	  }
     }
 
+  /* S is clipped to its clip rectangles, recorded as damage by
+     x_set_glyph_string_clipping, except when it has none.  */
+  x_damage (s->f, s->x - s->left_overhang, s->y,
+	    s->left_overhang + s->width + s->right_overhang, s->height);
+
   /* Set up S->gc, set clipping and draw S.  */
   x_set_glyph_string_gc (s);
 
@@ -2906,6 +3107,7 @@ x_draw_glyph_string (struct glyph_string *s)
   /* Reset clipping.  */
   XSetClipMask (s->display, s->gc, None);
   s->num_clips = 0;
+  x_end_drawing (s->f);
 }
 
 /* Shift display to make room for inserted glyphs.   */
@@ -2913,10 +3115,12 @@ x_draw_glyph_string (struct glyph_string *s)
 static void
 x_shift_glyphs_for_insert (struct frame *f, int x, int y, int width, int height, int shift_by)
 {
-  XCopyArea (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f), FRAME_X_WINDOW (f),
+  XCopyArea (FRAME_X_DISPLAY (f), FRAME_X_DRAWABLE (f), FRAME_X_DRAWABLE (f),
 	     f->output_data.x->normal_gc,
 	     x, y, width, height,
 	     x + shift_by, y);
+  x_damage (f, x + shift_by, y, width, height);
+  x_end_drawing (f);
 }
 
 /* Delete N glyphs at the nominal cursor position.  Not implemented
@@ -2932,14 +3136,35 @@ x_delete_glyphs (struct frame *f, register int n)
 /* Like XClearArea, but check that WIDTH and HEIGHT are reasonable.
    If they are <= 0, this is probably an error.  */
 
-void
-x_clear_area (Display *dpy, Window window, int x, int y, int width, int height)
+static void
+x_clear_window_area (Display *dpy, Window window,
+		     int x, int y, int width, int height)
 {
   eassert (width > 0 && height > 0);
   XClearArea (dpy, window, x, y, width, height, False);
 }
 
 
+/* Clear the rectangle X, Y, WIDTH, HEIGHT of frame F to the frame's
+   background.  If F has a back buffer, clear it there.  */
+
+void
+x_clear_area (struct frame *f, int x, int y, int width, int height)
+{
+  if (f->output_data.x->back_buffer != None)
+    {
+      eassert (width > 0 && height > 0);
+      XFillRectangle (FRAME_X_DISPLAY (f), f->output_data.x->back_buffer,
+		      f->output_data.x->reverse_gc, x, y, width, height);
+      x_damage (f, x, y, width, height);
+      x_end_drawing (f);
+    }
+  else
+    x_clear_window_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
+			 x, y, width, height);
+}
+
+
 /* Clear an entire frame.  */
 
 static void
@@ -2951,7 +3176,18 @@ x_clear_frame (struct frame *f)
 
   block_input ();
 
-  XClearWindow (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f));
+  if (f->output_data.x->back_buffer != None)
+    {
+      XFillRectangle (FRAME_X_DISPLAY (f), f->output_data.x->back_buffer,
+		      f->output_data.x->reverse_gc, 0, 0,
+		      f->output_data.x->back_buffer_width,
+		      f->output_data.x->back_buffer_height);
+      /* Don't show this until the frame has been redrawn.  */
+      x_damage (f, 0, 0, f->output_data.x->back_buffer_width,
+		f->output_data.x->back_buffer_height);
+    }
+  else
+    XClearWindow (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f));
 
   /* We have to clear the scroll bars.  If we have changed colors or
      something like that, then they should be notified.  */
@@ -3239,11 +3475,12 @@ x_scroll_run (struct window *w, struct run *run)
   x_clear_cursor (w);
 
   XCopyArea (FRAME_X_DISPLAY (f),
-	     FRAME_X_WINDOW (f), FRAME_X_WINDOW (f),
+	     FRAME_X_DRAWABLE (f), FRAME_X_DRAWABLE (f),
 	     f->output_data.x->normal_gc,
 	     x, from_y,
 	     width, height,
 	     x, to_y);
+  x_damage (f, x, to_y, width, height);
 
   unblock_input ();
 }
@@ -3894,7 +4131,7 @@ note_mouse_movement (struct frame *frame, XMotionEvent *event)
 
   if (event->window != FRAME_X_WINDOW (frame))
     {
-      frame->mouse_moved = 1;
+      note_mouse_moved (frame);
       last_mouse_scroll_bar = Qnil;
       note_mouse_highlight (frame, -1, -1);
       last_mouse_glyph_frame = 0;
@@ -3909,7 +4146,7 @@ note_mouse_movement (struct frame *frame, XMotionEvent *event)
       || event->y < last_mouse_glyph.y
       || event->y >= last_mouse_glyph.y + last_mouse_glyph.height)
     {
-      frame->mouse_moved = 1;
+      note_mouse_moved (frame);
       last_mouse_scroll_bar = Qnil;
       note_mouse_highlight (frame, event->x, event->y);
       /* Remember which glyph we're now on.  */
@@ -5038,8 +5275,7 @@ x_scroll_bar_create (struct window *w, int top, int left, int width, int height)
        for the case that a window has been split horizontally.  In
        this case, no clear_frame is generated to reduce flickering.  */
     if (width > 0 && height > 0)
-      x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-		    left, top, width, window_box_height (w));
+      x_clear_area (f, left, top, width, window_box_height (w));
 
     window = XCreateWindow (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
 			    /* Position and size of scroll bar.  */
@@ -5166,10 +5402,10 @@ x_scroll_bar_set_handle (struct scroll_bar *bar, int start, int end, int rebuild
     /* Draw the empty space above the handle.  Note that we can't clear
        zero-height areas; that means "clear to end of window."  */
     if (start > 0)
-      x_clear_area (FRAME_X_DISPLAY (f), w,
-		    VERTICAL_SCROLL_BAR_LEFT_BORDER,
-		    VERTICAL_SCROLL_BAR_TOP_BORDER,
-		    inside_width, start);
+      x_clear_window_area (FRAME_X_DISPLAY (f), w,
+			   VERTICAL_SCROLL_BAR_LEFT_BORDER,
+			   VERTICAL_SCROLL_BAR_TOP_BORDER,
+			   inside_width, start);
 
     /* Change to proper foreground color if one is specified.  */
     if (f->output_data.x->scroll_bar_foreground_pixel != -1)
@@ -5191,10 +5427,10 @@ x_scroll_bar_set_handle (struct scroll_bar *bar, int start, int end, int rebuild
     /* Draw the empty space below the handle.  Note that we can't
        clear zero-height areas; that means "clear to end of window." */
     if (end < inside_height)
-      x_clear_area (FRAME_X_DISPLAY (f), w,
-		    VERTICAL_SCROLL_BAR_LEFT_BORDER,
-		    VERTICAL_SCROLL_BAR_TOP_BORDER + end,
-		    inside_width, inside_height - end);
+      x_clear_window_area (FRAME_X_DISPLAY (f), w,
+			   VERTICAL_SCROLL_BAR_LEFT_BORDER,
+			   VERTICAL_SCROLL_BAR_TOP_BORDER + end,
+			   inside_width, inside_height - end);
   }
 
   unblock_input ();
@@ -5286,12 +5522,10 @@ XTset_vertical_scroll_bar (struct window *w, int portion, int whole, int positio
 	  block_input ();
 #ifdef USE_TOOLKIT_SCROLL_BARS
 	  if (fringe_extended_p)
-	    x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-			  sb_left, top, sb_width, height);
+	    x_clear_area (f, sb_left, top, sb_width, height);
 	  else
 #endif
-	    x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-			  left, top, width, height);
+	    x_clear_area (f, left, top, width, height);
 	  unblock_input ();
 	}
 
@@ -5325,11 +5559,9 @@ XTset_vertical_scroll_bar (struct window *w, int portion, int whole, int positio
 	  if (width > 0 && height > 0)
 	    {
 	      if (fringe_extended_p)
-		x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-			      sb_left, top, sb_width, height);
+		x_clear_area (f, sb_left, top, sb_width, height);
 	      else
-		x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-			      left, top, width, height);
+		x_clear_area (f, left, top, width, height);
 	    }
 #ifdef USE_GTK
           xg_update_scrollbar_pos (f, bar->x_window, top,
@@ -5351,11 +5583,9 @@ XTset_vertical_scroll_bar (struct window *w, int portion, int whole, int positio
 	if (rest > 0 && height > 0)
 	  {
 	    if (WINDOW_HAS_VERTICAL_SCROLL_BAR_ON_LEFT (w))
-	      x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-			    left + area_width - rest, top, rest, height);
+	      x_clear_area (f, left + area_width - rest, top, rest, height);
 	    else
-	      x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f),
-			    left, top, rest, height);
+	      x_clear_area (f, left, top, rest, height);
 	  }
       }
 
@@ -5625,7 +5855,7 @@ x_scroll_bar_note_movement (struct scroll_bar *bar, XMotionEvent *event)
 
   last_mouse_movement_time = event->time;
 
-  f->mouse_moved = 1;
+  note_mouse_moved (f);
   XSETVECTOR (last_mouse_scroll_bar, bar);
 
   /* If we're dragging the bar, display it.  */
@@ -6195,10 +6425,10 @@ handle_one_xevent (struct x_display_info *dpyinfo, XEvent *eventptr,
         {
 #ifdef USE_GTK
           /* This seems to be needed for GTK 2.6.  */
-	  x_clear_area (event.xexpose.display,
-			event.xexpose.window,
-			event.xexpose.x, event.xexpose.y,
-			event.xexpose.width, event.xexpose.height);
+	  x_clear_window_area (event.xexpose.display,
+			       event.xexpose.window,
+			       event.xexpose.x, event.xexpose.y,
+			       event.xexpose.width, event.xexpose.height);
 #endif
           if (!FRAME_VISIBLE_P (f))
             {
@@ -6207,6 +6437,14 @@ handle_one_xevent (struct x_display_info *dpyinfo, XEvent *eventptr,
               f->output_data.x->has_been_visible = 1;
               SET_FRAME_GARBAGED (f);
             }
+          else if (f->output_data.x->back_buffer != None
+		   && f->output_data.x->back_buffer_complete_p)
+	    {
+	      /* The back buffer has what the window should show.  */
+	      x_damage (f, event.xexpose.x, event.xexpose.y,
+			event.xexpose.width, event.xexpose.height);
+	      x_show_back_buffer (f);
+	    }
           else
             expose_frame (f,
 			  event.xexpose.x, event.xexpose.y,
@@ -7114,6 +7352,31 @@ x_dispatch_event (XEvent *event, Display *display)
 }
 #endif
 
+#ifndef USE_GTK
+
+/* EVENT is a MotionNotify event just read from DISPLAY.  If more
+   motion events for the same window and with the same buttons and
+   modifiers follow it in the queue, replace EVENT with the last of
+   them.  Only the final position matters, and handling each of them
+   separately can keep Emacs busy for as long as the mouse moves.  */
+
+static void
+x_compress_motion (Display *display, XEvent *event)
+{
+  XEvent next;
+
+  while (XEventsQueued (display, QueuedAlready) > 0)
+    {
+      XPeekEvent (display, &next);
+      if (next.type != MotionNotify
+	  || next.xmotion.window != event->xmotion.window
+	  || next.xmotion.state != event->xmotion.state)
+	break;
+      XNextEvent (display, event);
+    }
+}
+
+#endif /* not USE_GTK */
 
 /* Read events coming from the X server.
    Return as soon as there are no more events to be read.
@@ -7149,6 +7412,9 @@ XTread_socket (struct terminal *terminal, struct input_event *hold_quit)
 
       XNextEvent (terminal->display_info.x->display, &event);
 
+      if (event.type == MotionNotify)
+	x_compress_motion (terminal->display_info.x->display, &event);
+
 #ifdef HAVE_X_I18N
       /* Filter events for the current X input method.  */
       if (x_filter_event (terminal->display_info.x, &event))
@@ -7258,6 +7524,7 @@ x_clip_to_row (struct window *w, struct glyph_row *row,
   clip_rect.height = row->visible_height;
 
   XSetClipRectangles (FRAME_X_DISPLAY (f), gc, 0, 0, &clip_rect, 1, Unsorted);
+  x_damage (f, clip_rect.x, clip_rect.y, clip_rect.width, clip_rect.height);
 }
 
 
@@ -7296,8 +7563,9 @@ x_draw_hollow_cursor (struct window *w, struct glyph_row *row)
 
   /* Set clipping, draw the rectangle, and reset clipping again.  */
   x_clip_to_row (w, row, TEXT_AREA, gc);
-  XDrawRectangle (dpy, FRAME_X_WINDOW (f), gc, x, y, wd, h - 1);
+  XDrawRectangle (dpy, FRAME_X_DRAWABLE (f), gc, x, y, wd, h - 1);
   XSetClipMask (dpy, gc, None);
+  x_end_drawing (f);
 }
 
 
@@ -7338,7 +7606,7 @@ x_draw_bar_cursor (struct window *w, struct glyph_row *row, int width, enum text
   else
     {
       Display *dpy = FRAME_X_DISPLAY (f);
-      Window window = FRAME_X_WINDOW (f);
+      Drawable window = FRAME_X_DRAWABLE (f);
       GC gc = FRAME_DISPLAY_INFO (f)->scratch_cursor_gc;
       unsigned long mask = GCForeground | GCBackground | GCGraphicsExposures;
       struct face *face = FACE_FROM_ID (f, cursor_glyph->face_id);
@@ -7404,6 +7672,7 @@ x_draw_bar_cursor (struct window *w, struct glyph_row *row, int width, enum text
 	}
 
       XSetClipMask (dpy, gc, None);
+      x_end_drawing (f);
     }
 }
 
@@ -7425,7 +7694,7 @@ x_define_frame_cursor (struct frame *f, Cursor cursor)
 static void
 x_clear_frame_area (struct frame *f, int x, int y, int width, int height)
 {
-  x_clear_area (FRAME_X_DISPLAY (f), FRAME_X_WINDOW (f), x, y, width, height);
+  x_clear_area (f, x, y, width, height);
 #ifdef USE_GTK
   /* Must queue a redraw, because scroll bars might have been cleared.  */
   if (FRAME_GTK_WIDGET (f))
@@ -9415,6 +9684,13 @@ x_free_frame_resources (struct frame *f)
       if (FRAME_FACE_CACHE (f))
 	free_frame_faces (f);
 
+      if (f->output_data.x->back_buffer != None)
+	{
+	  XFreePixmap (FRAME_X_DISPLAY (f), f->output_data.x->back_buffer);
+	  XFreeGC (FRAME_X_DISPLAY (f), f->output_data.x->back_buffer_gc);
+	  f->output_data.x->back_buffer = None;
+	}
+
       if (f->output_data.x->icon_desc)
 	XDestroyWindow (FRAME_X_DISPLAY (f), f->output_data.x->icon_desc);
 
@@ -10761,6 +11037,16 @@ reflect the mouse click position, while a non-nil value means that the
 selected window or cursor position is preserved.  */);
   x_mouse_click_focus_ignore_position = 0;
 
+  DEFVAR_BOOL ("x-use-back-buffer", x_use_back_buffer,
+    doc: /* Non-nil means draw frame contents off-screen before showing them.
+Display output is then drawn into a pixmap of the same size as the
+frame, and the part of it that changed is copied to the frame's window
+in one request when redisplay of the frame is complete.  This avoids
+flicker, and lets the X server redisplay an exposed frame without
+asking Emacs to redraw it, at the cost of the memory for the pixmap.
+Changing this takes effect the next time each frame is redisplayed.  */);
+  x_use_back_buffer = 0;
+
   DEFVAR_LISP ("x-toolkit-scroll-bars", Vx_toolkit_scroll_bars,
     doc: /* Which toolkit scroll bars Emacs uses, if any.
 A value of nil means Emacs doesn't use toolkit scroll bars.
@@ -305,6 +305,11 @@ struct x_display_info
   /* Time of last user interaction as returned in X events on this display.  */
   Time last_user_time;
 
+  /* Number of frame updates done on this display, the number of X
+     requests they generated, and the number of requests generated by
+     the most recent one.  See x_update_begin and x_update_end.  */
+  EMACS_INT n_updates, n_update_requests, last_update_requests;
+
   /* The gray pixmap.  */
   Pixmap gray;
 
@@ -615,6 +620,33 @@ struct x_output
 
   /* Non-zero if _NET_WM_STATE_HIDDEN is set for this frame.  */
   unsigned net_wm_state_hidden_seen : 1;
+
+  /* Non-zero while an update of this frame is in progress, i.e.
+     between x_update_begin and x_update_end.  */
+  unsigned updating_p : 1;
+
+  /* Non-zero if back_buffer has everything the window should show, so
+     that Expose events can be handled by copying from it.  A new back
+     buffer has only what could be copied from the window.  */
+  unsigned back_buffer_complete_p : 1;
+
+  /* Off-screen pixmap that display output is drawn into when
+     x-use-back-buffer is non-nil, or None.  Its size is
+     back_buffer_width x back_buffer_height.  */
+  Pixmap back_buffer;
+  int back_buffer_width, back_buffer_height;
+
+  /* GC used to copy back_buffer to the window.  It has no clip mask
+     and does not generate graphics exposures.  */
+  GC back_buffer_gc;
+
+  /* The part of back_buffer drawn into since it was last copied to
+     the window, as the rectangle [damage_x0, damage_x1) x [damage_y0,
+     damage_y1).  Empty if damage_x0 >= damage_x1.  */
+  int damage_x0, damage_y0, damage_x1, damage_y1;
+
+  /* Serial number of the next X request when the current update began.  */
+  unsigned long update_request_serial;
 };
 
 #define No_Cursor (None)
@@ -638,6 +670,12 @@ enum
 /* Return the X window used for displaying data in frame F.  */
 #define FRAME_X_WINDOW(f) ((f)->output_data.x->window_desc)
 
+/* Return the drawable that display output for frame F goes to.  This
+   is the frame's back buffer if it has one, else its X window.  */
+#define FRAME_X_DRAWABLE(f)				\
+  ((f)->output_data.x->back_buffer != None		\
+   ? (f)->output_data.x->back_buffer : FRAME_X_WINDOW (f))
+
 /* Return the outermost X window associated with the frame F.  */
 #ifdef USE_X_TOOLKIT
 #define FRAME_OUTER_WINDOW(f) ((f)->output_data.x->widget ?             \
@@ -929,7 +967,7 @@ extern bool x_alloc_lighter_color_for_widget (Widget, Display *, Colormap,
 #endif
 extern bool x_alloc_nearest_color (struct frame *, Colormap, XColor *);
 extern void x_query_color (struct frame *f, XColor *);
-extern void x_clear_area (Display *, Window, int, int, int, int);
+extern void x_clear_area (struct frame *, int, int, int, int);
 #if defined HAVE_MENUS && !defined USE_X_TOOLKIT && !defined USE_GTK
 extern void x_mouse_leave (struct x_display_info *);
 #endif
@@ -241,7 +241,15 @@
     (let ((a 3) (b 2) (c 1.0)) (/ 1 a b c))
     (let ((a 3) (b 2) (c 1.0)) (/ a b c 0))
     (let ((a 3) (b 2) (c 1.0)) (/ a b c 1))
-    (let ((a 3) (b 2) (c 1.0)) (/ a b c -1)))
+    (let ((a 3) (b 2) (c 1.0)) (/ a b c -1))
+    ;; Chained float arithmetic, whose intermediate results the
+    ;; byte-code interpreter may compute in place.
+    (let ((a 1.5) (b 2)) (list (* a b) (- (* a b) (+ a b)) (1+ (* a b))))
+    (let ((a 1.5) (b 2)) (list (- (1- (/ a b))) (+ (- a) (* -0.0 b))))
+    (let* ((a 1.5) (b (* a 2)) (c (+ b 1))) (list a b c (* c c)))
+    (let ((s 0.0) (l nil))
+      (dotimes (i 4) (setq s (+ (* s 2) 1.5)) (push s l) (push (1+ s) l))
+      l))
   "List of expression for test.
 Each element will be executed by interpreter and with
 bytecompiled code, and their results compared.")
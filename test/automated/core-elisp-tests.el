@@ -36,5 +36,61 @@
                          c-e-x)
                    '(1 2)))))
 
+;; Calls through an alias must see redefinitions of any function
+;; in the alias chain, even after the call has been cached.
+(defun core-elisp-tests--target () 1)
+(defalias 'core-elisp-tests--alias 'core-elisp-tests--target)
+(ert-deftest core-elisp-tests-alias-redefinition ()
+  "Test that calls through aliases follow `fset' and `defalias'."
+  (dotimes (_ 3)
+    (should (= (core-elisp-tests--alias) 1))
+    (should (= (funcall 'core-elisp-tests--alias) 1)))
+  (unwind-protect
+      (progn
+        (fset 'core-elisp-tests--target (lambda () 2))
+        (should (= (core-elisp-tests--alias) 2))
+        (should (= (funcall 'core-elisp-tests--alias) 2))
+        (defalias 'core-elisp-tests--alias 'car)
+        (should (eq (funcall 'core-elisp-tests--alias '(a)) 'a))
+        (fmakunbound 'core-elisp-tests--alias)
+        (should-error (funcall 'core-elisp-tests--alias)))
+    (defun core-elisp-tests--target () 1)
+    (defalias 'core-elisp-tests--alias 'core-elisp-tests--target)))
+
+;; Unwinding a `let' of a buffer-local variable must restore the
+;; binding of the buffer in which it was made, whichever buffer is
+;; current at that time.
+(defvar core-elisp-tests--local 'default)
+(make-variable-buffer-local 'core-elisp-tests--local)
+(ert-deftest core-elisp-tests-let-buffer-local ()
+  "Test unwinding of `let' bindings of buffer-local variables."
+  (let ((b1 (generate-new-buffer " *core-elisp-tests-1*"))
+        (b2 (generate-new-buffer " *core-elisp-tests-2*")))
+    (unwind-protect
+        (progn
+          (with-current-buffer b1
+            (setq core-elisp-tests--local 'b1)
+            (let ((core-elisp-tests--local 'let-b1))
+              (set-buffer b2)
+              (should (eq core-elisp-tests--local 'default))
+              (setq core-elisp-tests--local 'b2))
+            (should (eq core-elisp-tests--local 'b2))
+            (should (eq (buffer-local-value 'core-elisp-tests--local b1)
+                        'b1)))
+          ;; A binding killed inside the `let' must stay dead.
+          (with-current-buffer b1
+            (let ((core-elisp-tests--local 'let-b1))
+              (set-buffer b2)
+              (with-current-buffer b1
+                (kill-local-variable 'core-elisp-tests--local)))
+            (should-not (local-variable-p 'core-elisp-tests--local b1)))
+          ;; Without a local binding, `let' binds the default value.
+          (with-temp-buffer
+            (let ((core-elisp-tests--local 'tmp))
+              (should (eq (default-value 'core-elisp-tests--local) 'tmp)))
+            (should (eq (default-value 'core-elisp-tests--local) 'default))))
+      (kill-buffer b1)
+      (kill-buffer b2))))
+
 (provide 'core-elisp-tests)
 ;;; core-elisp-tests.el ends here
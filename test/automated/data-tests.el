@@ -71,5 +71,53 @@
   ;; Short circuits before getting to bad arg
   (should-not (>= 8 9 'foo)))
 
+;; Lookups of buffer-local bindings are cached; check that the cache
+;; follows creation and removal of bindings.
+(defvar data-tests--local 'default)
+(ert-deftest data-tests-local-bindings ()
+  (with-temp-buffer
+    (should-not (local-variable-p 'data-tests--local))
+    (should (eq (buffer-local-value 'data-tests--local (current-buffer))
+                'default))
+    (set (make-local-variable 'data-tests--local) 'local)
+    (should (local-variable-p 'data-tests--local))
+    (should (eq (buffer-local-value 'data-tests--local (current-buffer))
+                'local))
+    (with-temp-buffer
+      (should (eq data-tests--local 'default)))
+    (should (eq data-tests--local 'local))
+    (kill-local-variable 'data-tests--local)
+    (should-not (local-variable-p 'data-tests--local))
+    (should (eq data-tests--local 'default))
+    (set (make-local-variable 'data-tests--local) 'again)
+    (kill-all-local-variables)
+    (should-not (local-variable-p 'data-tests--local))
+    (should (eq data-tests--local 'default))))
+
+;; `inhibit-read-only' forwards into a C variable, which `insert' reads
+;; directly.  Switching buffers must load the right binding into it.
+(ert-deftest data-tests-forwarded-local-bindings ()
+  (let ((local (generate-new-buffer " *data-tests*"))
+        (other (generate-new-buffer " *data-tests*")))
+    (unwind-protect
+        (progn
+          (with-current-buffer other
+            (setq buffer-read-only t))
+          (with-current-buffer local
+            (set (make-local-variable 'inhibit-read-only) t)
+            (insert "x"))
+          (with-current-buffer other
+            (should-error (insert "x") :type 'buffer-read-only)
+            (set (make-local-variable 'inhibit-read-only) t))
+          (with-current-buffer local
+            (kill-local-variable 'inhibit-read-only))
+          (with-current-buffer other
+            (insert "x")
+            (kill-local-variable 'inhibit-read-only)
+            (should-error (insert "x") :type 'buffer-read-only))
+          (should (equal (with-current-buffer other (buffer-string)) "x")))
+      (kill-buffer local)
+      (kill-buffer other))))
+
 ;;; data-tests.el ends here
 
@@ -0,0 +1,186 @@
+;;; json-tests.el --- Tests for the JSON primitives in json.c
+
+;; Copyright (C) 2013 Free Software Foundation, Inc.
+
+;; This file is part of GNU Emacs.
+
+;; GNU Emacs is free software: you can redistribute it and/or modify
+;; it under the terms of the GNU General Public License as published by
+;; the Free Software Foundation, either version 3 of the License, or
+;; (at your option) any later version.
+
+;; GNU Emacs is distributed in the hope that it will be useful,
+;; but WITHOUT ANY WARRANTY; without even the implied warranty of
+;; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;; GNU General Public License for more details.
+
+;; You should have received a copy of the GNU General Public License
+;; along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+
+;;; Commentary:
+
+;; The files in data/json are language server messages of typical
+;; shapes and sizes.  Besides the tests, `json-tests-benchmark' uses
+;; them to compare the C parser with json.el.
+
+;;; Code:
+
+(require 'ert)
+(require 'json)
+(require 'benchmark)
+
+(defconst json-tests-data-directory
+  (expand-file-name "data/json"
+		    (file-name-directory (or load-file-name
+					     buffer-file-name)))
+  "Directory holding the JSON test corpus.")
+
+(defun json-tests-corpus ()
+  "Return the contents of the files in the JSON test corpus."
+  (mapcar (lambda (file)
+	    (with-temp-buffer
+	      (let ((coding-system-for-read 'utf-8))
+		(insert-file-contents file))
+	      (buffer-string)))
+	  (directory-files json-tests-data-directory t "\\.json\\'")))
+
+(defun json-tests-normalize (value)
+  "Return VALUE with the members of all alists in it sorted by key.
+json.el puts object members into alists in reverse order."
+  (cond ((vectorp value) (vconcat (mapcar #'json-tests-normalize value)))
+	((consp value)
+	 (sort (mapcar (lambda (member)
+			 (cons (car member)
+			       (json-tests-normalize (cdr member))))
+		       value)
+	       (lambda (a b) (string< (car a) (car b)))))
+	(t value)))
+
+(ert-deftest json-tests-parse-scalars ()
+  (should (equal (json-parse-string "[1,-2,0,3.5,-0.25,1e3,true,false,null]")
+		 [1 -2 0 3.5 -0.25 1000.0 t :false :null]))
+  (should (equal (json-parse-string " \"a\\\"b\\\\c\\/\\n\\u00e9\\ud83d\\ude00\" ")
+		 "a\"b\\c/\né\U0001F600"))
+  (should (equal (json-parse-string "\"h\u00e9llo \u2713\"") "h\u00e9llo \u2713"))
+  (should (floatp (json-parse-string "123456789012345678901234567890")))
+  (should (equal (json-parse-string "[false,null]"
+				    :false-object nil :null-object 'none)
+		 [nil none])))
+
+(ert-deftest json-tests-parse-objects ()
+  (let ((h (json-parse-string "{\"a\":1,\"b\":{\"c\":[]},\"a\":2}")))
+    (should (hash-table-p h))
+    (should (eq (hash-table-test h) 'equal))
+    (should (equal (gethash "a" h) 2))
+    (should (equal (gethash "c" (gethash "b" h)) [])))
+  (should (equal (json-parse-string "{\"a\":1,\"b\":[2,{\"c\":3}]}"
+				    :object-type 'alist :array-type 'list)
+		 '((a . 1) (b 2 ((c . 3))))))
+  (should (equal (json-parse-string "{\"a\":1,\"\\u00e9\":{}}"
+				    :object-type 'plist)
+		 '(:a 1 :é nil))))
+
+(ert-deftest json-tests-parse-errors ()
+  (dolist (text '("" "[1," "{\"a\"" "\"abc"))
+    (should-error (json-parse-string text) :type 'json-end-of-file))
+  (dolist (text '("[1 2]" "{1:2}" "01x" "tru" "\"\\x\"" "\"\\ud800\""
+		  "[-]" "\"a\tb\"" "\"\xff\""))
+    (should-error (json-parse-string text) :type 'json-parse-error))
+  (should-error (json-parse-string "1 2") :type 'json-trailing-content)
+  (should-error (json-parse-string (concat (make-string 3000 ?\[)
+					   (make-string 3000 ?\])))
+		:type 'json-object-too-deep)
+  (should (equal (cdr (should-error (json-parse-string "[1, x]")))
+		 '("Unexpected character" 4)))
+  (should-error (json-parse-string "1" :object-type 'vector)))
+
+(ert-deftest json-tests-parse-buffer ()
+  (with-temp-buffer
+    (insert "{\"a\": [1, \"\u00e9\"]}  [2] trailing")
+    (goto-char (point-min))
+    (should (equal (json-parse-buffer :object-type 'alist)
+		   '((a . [1 "\u00e9"]))))
+    (should (= (point) 16))
+    (should (equal (json-parse-buffer) [2]))
+    (should (looking-at " trailing"))
+    (should-error (json-parse-buffer) :type 'json-parse-error)
+    ;; The gap must not get in the way.
+    (erase-buffer)
+    (insert "[1,2,3]")
+    (goto-char 3)
+    (insert " ")
+    (goto-char (point-min))
+    (should (equal (json-parse-buffer) [1 2 3]))))
+
+(ert-deftest json-tests-serialize ()
+  (should (equal (json-serialize [1 -2 3.5 1.0 t :false :null "x"])
+		 "[1,-2,3.5,1.0,true,false,null,\"x\"]"))
+  (should (equal (json-serialize "a\"b\\c\n\t\x01é✓")
+		 "\"a\\\"b\\\\c\\n\\t\\u0001é✓\""))
+  (should (equal (json-serialize '((a . 1) (b . [])))
+		 "{\"a\":1,\"b\":[]}"))
+  (should (equal (json-serialize '(:a 1 :b (:c "d")))
+		 "{\"a\":1,\"b\":{\"c\":\"d\"}}"))
+  (should (equal (json-serialize nil) "{}"))
+  (should (equal (json-serialize [nil] :null-object nil) "[null]"))
+  (let ((h (make-hash-table :test 'equal)))
+    (puthash "k" [1] h)
+    (should (equal (json-serialize h) "{\"k\":[1]}")))
+  (should-error (json-serialize 'foo) :type 'wrong-type-argument)
+  (should-error (json-serialize (/ 0.0 0.0)) :type 'wrong-type-argument)
+  (should-error (json-serialize (string-to-multibyte "\377"))
+		:type 'wrong-type-argument)
+  (let ((v (vector 1)))
+    (aset v 0 v)
+    (should-error (json-serialize v) :type 'json-object-too-deep))
+  (with-temp-buffer
+    (insert "x")
+    (json-insert [1 "é"])
+    (should (equal (buffer-string) "x[1,\"é\"]"))))
+
+(ert-deftest json-tests-corpus ()
+  "Check the C parser against json.el, and round trips."
+  (dolist (text (json-tests-corpus))
+    (let* ((value (json-parse-string text :object-type 'alist
+				     :array-type 'array
+				     :null-object nil :false-object :json-false))
+	   (json-object-type 'alist)
+	   (json-array-type 'vector)
+	   (json-key-type 'symbol))
+      (should (equal (json-tests-normalize value)
+		     (json-tests-normalize (json-read-from-string text))))
+      (should (equal (json-parse-string
+		      (json-serialize value :null-object nil
+				      :false-object :json-false)
+		      :object-type 'alist :null-object nil
+		      :false-object :json-false)
+		     value))
+      (should (equal (json-serialize (json-parse-string text))
+		     (json-serialize (json-parse-string text
+							:object-type 'plist)))))))
+
+(defun json-tests-benchmark (&optional repetitions)
+  "Time parsing and printing the JSON test corpus REPETITIONS times.
+Compare `json-parse-string' and `json-serialize' with `json-read'
+and `json-encode' from json.el."
+  (interactive)
+  (let* ((corpus (json-tests-corpus))
+	 (n (or repetitions 20))
+	 (json-object-type 'alist)
+	 (values (mapcar (lambda (text)
+			   (json-parse-string text :object-type 'alist))
+			 corpus)))
+    (garbage-collect)
+    (message "%s"
+	     (list (cons 'json-parse-string
+			 (benchmark-run n (mapc #'json-parse-string corpus)))
+		   (cons 'json-read
+			 (benchmark-run n (mapc #'json-read-from-string corpus)))
+		   (cons 'json-serialize
+			 (benchmark-run n (mapc #'json-serialize values)))
+		   (cons 'json-encode
+			 (benchmark-run n (mapc #'json-encode values)))))))
+
+(provide 'json-tests)
+
+;;; json-tests.el ends here
@@ -69,6 +69,19 @@ bytecompiled code, and their results compared.")
   (dolist (pat lexbind-tests)
     (should (lexbind-check-1 pat))))
 
+(ert-deftest lexbind-tests-tail-calls ()
+  "Test self tail calls with `byte-code-tail-calls'."
+  (let ((lexical-binding t))
+    (defalias 'lexbind-tests--length
+      (byte-compile '(lambda (l &optional n)
+                       (if l (lexbind-tests--length (cdr l) (1+ (or n 0)))
+                         (or n 0))))))
+  (let ((l (make-list (* 2 max-lisp-eval-depth) nil)))
+    (should-error (lexbind-tests--length l))
+    (let ((byte-code-tail-calls t))
+      (should (= (lexbind-tests--length l) (length l)))
+      (should (= (lexbind-tests--length '(a b c) 10) 13)))))
+
 
 
 (provide 'lexbind-tests)
@@ -0,0 +1,274 @@
+;;; process-tests.el --- Tests for subprocesses  -*- lexical-binding: t -*-
+
+;; Copyright (C) 2013 Free Software Foundation, Inc.
+
+;; This file is part of GNU Emacs.
+
+;; GNU Emacs is free software: you can redistribute it and/or modify
+;; it under the terms of the GNU General Public License as published by
+;; the Free Software Foundation, either version 3 of the License, or
+;; (at your option) any later version.
+
+;; GNU Emacs is distributed in the hope that it will be useful,
+;; but WITHOUT ANY WARRANTY; without even the implied warranty of
+;; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;; GNU General Public License for more details.
+
+;; You should have received a copy of the GNU General Public License
+;; along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+
+;;; Commentary:
+
+;; `process-tests-spawn-benchmark' measures how long it takes to start
+;; a subprocess, and how that depends on the size of the heap.
+;; `process-tests-call-process-benchmark' measures how fast
+;; `call-process' inserts a lot of output.
+
+;;; Code:
+
+(require 'ert)
+(require 'benchmark)
+
+(ert-deftest process-tests-environment ()
+  (let ((process-environment
+	 (append '("PROCESS_TESTS_A=first" "PROCESS_TESTS_A=second"
+		   "PROCESS_TESTS_B")
+		 process-environment))
+	(default-directory (file-name-as-directory temporary-file-directory)))
+    (with-temp-buffer
+      (should (eq (call-process "sh" nil t nil "-c"
+				"echo \"$PROCESS_TESTS_A:${PROCESS_TESTS_B-none}\"; pwd")
+		  0))
+      (should (equal (buffer-string)
+		     (format "first:none\n%s\n"
+			     (directory-file-name
+			      (file-truename default-directory))))))))
+
+;; Multibyte characters must survive being split between reads,
+;; however big the reads get.
+(ert-deftest process-tests-call-process-decoding ()
+  (dolist (display '(nil t))
+    (with-temp-buffer
+      (let ((coding-system-for-read 'utf-8-unix)
+	    (call-process-redisplay-interval 0.01))
+	(should (eq (call-process "sh" nil t display "-c"
+				  "yes '\316\261\316\262\316\263' | head -n 100000")
+		    0))
+	(goto-char (point-min))
+	(should (= (how-many "^\u03b1\u03b2\u03b3$") 100000))
+	(should (= (buffer-size) 400000))))))
+
+;; Message framing.  Each chunk is echoed by `cat' and read before the
+;; next one is sent, so that it arrives in a read of its own.
+
+(defun process-tests-framed-output (framing &rest chunks)
+  "Return the strings passed to the filter of `cat' with FRAMING.
+Send each of CHUNKS to `cat' and wait for it to be read back.  A
+chunk that is a symbol instead makes it the new framing."
+  (let* ((process-connection-type nil)
+	 (process (start-process "cat" nil "cat"))
+	 messages)
+    (unwind-protect
+	(progn
+	  (set-process-coding-system process 'binary 'binary)
+	  (set-process-filter process
+			      (lambda (_process string)
+				(push string messages)))
+	  (set-process-message-framing process framing)
+	  (dolist (chunk chunks)
+	    (if (symbolp chunk)
+		(set-process-message-framing process chunk)
+	      (process-send-string process chunk)
+	      (should (accept-process-output process 5)))))
+      (delete-process process))
+    (nreverse messages)))
+
+(ert-deftest process-tests-framing-newline ()
+  (should (equal (process-tests-framed-output 'newline "a\nb" "c\nd\ne")
+		 '("a" "bc" "d"))))
+
+(ert-deftest process-tests-framing-split-header ()
+  (should (equal (process-tests-framed-output
+		  'content-length
+		  "Content-Le" "ngth: 5\r" "\n\r" "\nhello")
+		 '("hello"))))
+
+(ert-deftest process-tests-framing-split-body ()
+  (should (equal (process-tests-framed-output
+		  'content-length
+		  "Content-Length: 11\r\n\r\nhel" "lo wo" "rld")
+		 '("hello world"))))
+
+(ert-deftest process-tests-framing-several-messages ()
+  (should (equal (process-tests-framed-output
+		  'content-length
+		  (concat "Content-Length: 1\r\n\r\na"
+			  "Content-Type: text/plain\r\ncontent-length:  2\r\n\r\nbc"
+			  "Content-Length: 0\r\n\r\n"
+			  "Content-Length: 3\r\n\r\nd")
+		  "ef")
+		 '("a" "bc" "" "def"))))
+
+(ert-deftest process-tests-framing-bad-header ()
+  (should (equal (process-tests-framed-output
+		  'content-length
+		  "Content-Length: x\r\n\r\n"
+		  "Content-Type: text/plain\r\n\r\n"
+		  "Content-Length: 2\r\n\r\nok")
+		 '("Content-Length: x\r\n\r\n"
+		   "Content-Type: text/plain\r\n\r\n"
+		   "ok"))))
+
+(ert-deftest process-tests-framing-off ()
+  ;; Switching framing off discards an incomplete message.
+  (should (equal (process-tests-framed-output
+		  'newline "a\nincomplete" nil "b\nc")
+		 '("a" "b\nc")))
+  (should (equal (process-tests-framed-output
+		  'content-length "Content-Length: 9\r\n\r\nabc" nil "de")
+		 '("de"))))
+
+(ert-deftest process-tests-nonblocking-send ()
+  "Input queued by a nonblocking send reaches the process in full.
+The end of file sent after it must come after all of it, or `cat'
+exits before echoing everything."
+  (let* ((process-connection-type nil)
+	 (data (mapconcat (lambda (i) (format "%07d\n" i))
+			  (number-sequence 0 (1- (* 512 1024))) ""))
+	 (buffer (generate-new-buffer " *process-tests*"))
+	 (process (start-process "cat" buffer "cat"))
+	 sent)
+    (unwind-protect
+	(with-current-buffer buffer
+	  (set-buffer-multibyte nil)
+	  (set-process-coding-system process 'binary 'binary)
+	  (set-process-nonblocking-send process
+					(lambda (_process) (setq sent t)))
+	  (process-send-string process data)
+	  (should (> (process-send-queue-size process) 0))
+	  (process-send-eof process)
+	  (should (= (process-send-queue-size process) 0))
+	  (should sent)
+	  (while (and (< (buffer-size) (length data))
+		      (accept-process-output process 5)))
+	  (should (= (buffer-size) (length data)))
+	  (should (string= (buffer-string) data)))
+      (delete-process process)
+      (kill-buffer buffer))))
+
+;; The output of the shell command below: more than one read's worth of
+;; text, with a two-byte character split between two writes.
+(defconst process-tests-large-output
+  (concat (make-string 5000 ?a) "\u00e9" (make-string 5000 ?b)))
+
+(defun process-tests-default-filter-output ()
+  "Insert `process-tests-large-output' with the default filter.
+The buffer already contains \"<>\", and the process mark is between
+the brackets and point before them.  Return the buffer's text, the
+position of the process mark, point, and the position of a marker that
+was at the process mark."
+  (let* ((process-connection-type nil)
+	 (coding-system-for-read 'utf-8)
+	 (buffer (generate-new-buffer " *process-tests*"))
+	 (process (start-process
+		   "sh" buffer "sh" "-c"
+		   (concat "head -c 5000 /dev/zero | tr '\\0' a;"
+			   " printf '\\303'; sleep 0.2; printf '\\251';"
+			   " head -c 5000 /dev/zero | tr '\\0' b"))))
+    (unwind-protect
+	(with-current-buffer buffer
+	  (insert "<>")
+	  (set-marker (process-mark process) 2)
+	  (goto-char 1)
+	  (let ((marker (copy-marker 2))
+		(tries 0))
+	    (while (and (< (buffer-size) (+ 2 (length process-tests-large-output)))
+			(< tries 100))
+	      (accept-process-output process 0.1)
+	      (setq tries (1+ tries)))
+	    (list (buffer-string) (marker-position (process-mark process))
+		  (point) (marker-position marker))))
+      (delete-process process)
+      (kill-buffer buffer))))
+
+(ert-deftest process-tests-default-filter ()
+  "The default filter inserts large output at the process mark.
+It inserts before markers, so the marker moves along with the mark."
+  (let ((end (+ 2 (length process-tests-large-output))))
+    (should (equal (process-tests-default-filter-output)
+		   (list (concat "<" process-tests-large-output ">")
+			 end 1 end)))))
+
+(ert-deftest process-tests-default-filter-advised ()
+  "Advice on the default filter sees all of the output."
+  (let* ((seen 0)
+	 (count (lambda (_process text)
+		  (setq seen (+ seen (length text)))))
+	 result)
+    (advice-add 'internal-default-process-filter :before count)
+    (unwind-protect
+	(setq result (process-tests-default-filter-output))
+      (advice-remove 'internal-default-process-filter count))
+    (should (= seen (length process-tests-large-output)))
+    (should (equal (car result)
+		   (concat "<" process-tests-large-output ">")))))
+
+(defun process-tests-spawn-benchmark (&optional count)
+  "Time starting COUNT processes with heaps of different sizes.
+COUNT defaults to 200.  Return a list of elements (MB CALL START),
+where CALL and START are the average times in milliseconds taken by
+`call-process' and `start-process' after about MB megabytes have been
+added to the heap."
+  (interactive)
+  (let ((n (or count 200))
+	junk results)
+    (dolist (mb '(0 256 1024))
+      (while (< (length junk) mb)
+	(push (make-string (* 1024 1024) ?x) junk))
+      (garbage-collect)
+      (push (list mb
+		  (/ (* 1000 (car (benchmark-run
+				    (dotimes (_ n) (call-process "true")))))
+		     n)
+		  (/ (* 1000
+			(car (benchmark-run
+			       (dotimes (_ n)
+				 (let ((process
+					(start-process "true" nil "true")))
+				   (while (process-live-p process)
+				     (accept-process-output process 0.01)))))))
+		     n))
+	    results))
+    (setq results (nreverse results))
+    (if (called-interactively-p 'interactive)
+	(message "%S" results))
+    results))
+
+(defun process-tests-call-process-benchmark (&optional megabytes)
+  "Time inserting MEGABYTES of output from `call-process'.
+MEGABYTES defaults to 100.  The output is decoded as UTF-8 into a
+multibyte buffer.  Return a list of elements (MAX SECONDS MB/S), one
+for each value MAX of `read-process-output-max' tried."
+  (interactive)
+  (let* ((bytes (* (or megabytes 100) 1024 1024))
+	 (command (format "yes 0123456789abcdefghijklmnopqrstuvwxyz | head -c %d"
+			  bytes))
+	 (coding-system-for-read 'utf-8-unix)
+	 results)
+    (dolist (max '(65536 1048576))
+      (let ((read-process-output-max max))
+	(with-temp-buffer
+	  (buffer-disable-undo)
+	  (garbage-collect)
+	  (let ((time (car (benchmark-run
+			     (call-process shell-file-name nil t nil
+					   shell-command-switch command)))))
+	    (push (list max time (/ bytes time 1024 1024)) results)))))
+    (setq results (nreverse results))
+    (if (called-interactively-p 'interactive)
+	(message "%S" results))
+    results))
+
+(provide 'process-tests)
+
+;;; process-tests.el ends here
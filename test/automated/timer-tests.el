@@ -0,0 +1,115 @@
+;;; timer-tests.el --- Tests for timers  -*- lexical-binding: t -*-
+
+;; Copyright (C) 2013 Free Software Foundation, Inc.
+
+;; This file is part of GNU Emacs.
+
+;; GNU Emacs is free software: you can redistribute it and/or modify
+;; it under the terms of the GNU General Public License as published by
+;; the Free Software Foundation, either version 3 of the License, or
+;; (at your option) any later version.
+
+;; GNU Emacs is distributed in the hope that it will be useful,
+;; but WITHOUT ANY WARRANTY; without even the implied warranty of
+;; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;; GNU General Public License for more details.
+
+;; You should have received a copy of the GNU General Public License
+;; along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+
+;;; Commentary:
+
+;; `timer-tests-benchmark' measures how scheduling many timers affects
+;; adding timers and each pass through the command loop.
+
+;;; Code:
+
+(require 'ert)
+(require 'benchmark)
+
+(defun timer-tests-sorted-p (list)
+  "Return non-nil if the timers in LIST are sorted by time."
+  (let ((sorted t))
+    (while (and sorted (cdr list))
+      (if (time-less-p (timer--time (cadr list)) (timer--time (car list)))
+	  (setq sorted nil))
+      (setq list (cdr list)))
+    sorted))
+
+(ert-deftest timer-tests-insertion-point ()
+  (let ((timers (mapcar (lambda (secs)
+			  (let ((timer (timer-create)))
+			    (timer-set-time timer (list 0 secs 0 0))
+			    timer))
+			'(10 20 20 30)))
+	(new (timer-create)))
+    (timer-set-time new '(0 20 0 0))
+    (should (eq (internal-timer-insertion-point new timers) timers))
+    (timer-set-time new '(0 5 0 0))
+    (should-not (internal-timer-insertion-point new timers))
+    (timer-set-time new '(0 40 0 0))
+    (should (eq (internal-timer-insertion-point new timers) (last timers)))
+    (timer-set-time new '(0 20 1 0))
+    (should (eq (internal-timer-insertion-point new timers) (nthcdr 2 timers)))
+    (should (eq (internal-timer-insertion-point new (cons 'junk timers))
+		(nthcdr 2 timers)))
+    (should-not (internal-timer-insertion-point new nil))
+    (should-error (internal-timer-insertion-point 'junk timers)
+		  :type 'wrong-type-argument)))
+
+(ert-deftest timer-tests-run ()
+  (let* ((timer-list nil)
+	 (later (mapcar (lambda (_) (run-at-time (+ 1000 (random 1000)) nil
+						  #'ignore))
+			(make-list 200 nil)))
+	 (ran nil))
+    (should (timer-tests-sorted-p timer-list))
+    (dolist (n '(3 1 2))
+      (run-at-time (* n 0.01) nil (lambda () (push n ran))))
+    (let ((end (time-add (current-time) '(0 1 0 0))))
+      (while (and (< (length ran) 3) (time-less-p (current-time) end))
+	(sleep-for 0.01)))
+    (should (equal ran '(3 2 1)))
+    (should (= (length timer-list) 200))
+    (mapc #'cancel-timer later)
+    (should-not timer-list)))
+
+;; Running a slow timer can make due the timers that were not due when
+;; timer_check started; the timers after those must still wake Emacs.
+(ert-deftest timer-tests-wake-after-slow-timer ()
+  (let* ((timer-list nil)
+	 (start (float-time))
+	 (ran nil))
+    (run-at-time 0 nil (lambda ()
+			 (push 'a ran)
+			 (let ((end (+ (float-time) 0.1)))
+			   (while (< (float-time) end)))))
+    (run-at-time 0.05 nil (lambda () (push 'b ran)))
+    (run-at-time 0.3 nil (lambda () (push (- (float-time) start) ran)))
+    (sleep-for 1)
+    (should (equal (cdr ran) '(b a)))
+    (should (< (car ran) 0.6))))
+
+(defun timer-tests-benchmark (&optional count)
+  "Time adding COUNT timers and waiting while they are scheduled.
+COUNT defaults to 10000."
+  (interactive)
+  (let ((timer-list nil)
+	(n (or count 10000))
+	timers)
+    (garbage-collect)
+    (message "%s"
+	     (list (cons 'add
+			 (benchmark-run 1
+			   (dotimes (_ n)
+			     (push (run-at-time (+ 1000 (random 100000)) nil
+						#'ignore)
+				   timers))))
+		   (cons 'wait
+			 (benchmark-run 1000 (accept-process-output nil 0)))
+		   (cons 'cancel
+			 (benchmark-run 1 (mapc #'cancel-timer timers)))))))
+
+(provide 'timer-tests)
+
+;;; timer-tests.el ends here
@@ -0,0 +1,175 @@
+;;; xdisp-tests.el --- Tests for the display engine  -*- lexical-binding: t -*-
+
+;; Copyright (C) 2014 Free Software Foundation, Inc.
+
+;; This file is part of GNU Emacs.
+
+;; GNU Emacs is free software: you can redistribute it and/or modify
+;; it under the terms of the GNU General Public License as published by
+;; the Free Software Foundation, either version 3 of the License, or
+;; (at your option) any later version.
+
+;; GNU Emacs is distributed in the hope that it will be useful,
+;; but WITHOUT ANY WARRANTY; without even the implied warranty of
+;; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;; GNU General Public License for more details.
+
+;; You should have received a copy of the GNU General Public License
+;; along with GNU Emacs.  If not, see <http://www.gnu.org/licenses/>.
+
+;;; Code:
+
+(require 'ert)
+(require 'face-remap)
+
+;; In batch mode the initial frame is never redisplayed.  A terminal
+;; frame on the pseudo-terminal of a subprocess is, so tests that need
+;; redisplay to run use one.
+
+(defvar xdisp-tests--process nil
+  "The process whose terminal `xdisp-tests-with-tty-frame' uses.")
+
+(defun xdisp-tests-call-with-tty-frame (function)
+  "Call FUNCTION with a new terminal frame selected."
+  (let* ((process-connection-type t)
+	 (xdisp-tests--process (start-process "xdisp-tests" nil "sleep" "60"))
+	 (frame (progn
+		  ;; The size of a terminal frame is that of its terminal.
+		  (set-process-window-size xdisp-tests--process 25 80)
+		  (make-terminal-frame
+		   `((tty . ,(process-tty-name xdisp-tests--process))
+		     (tty-type . "xterm"))))))
+    (set-process-query-on-exit-flag xdisp-tests--process nil)
+    (unwind-protect
+	(with-selected-frame frame
+	  (funcall function))
+      (delete-frame frame)
+      (delete-process xdisp-tests--process))))
+
+(defmacro xdisp-tests-with-tty-frame (&rest body)
+  "Evaluate BODY with a new terminal frame selected."
+  (declare (indent 0) (debug t))
+  `(xdisp-tests-call-with-tty-frame (lambda () ,@body)))
+
+(defun xdisp-tests-redisplay ()
+  "Redisplay all windows of the selected frame in full."
+  (force-window-update)
+  (force-mode-line-update t)
+  (redisplay t)
+  ;; Don't let the terminal's output fill up the pseudo-terminal.
+  (while (accept-process-output xdisp-tests--process 0)))
+
+(ert-deftest xdisp-tests-face-remap-in-place ()
+  "Faces are merged again after a remapping is changed in place.
+The second `face-remap-add-relative' for the same face modifies the
+existing entry of `face-remapping-alist', so redisplay must not reuse
+the faces it merged before."
+  (xdisp-tests-with-tty-frame
+    (with-temp-buffer
+      (insert (propertize "remapped" 'face 'bold) "\n")
+      (set-window-buffer (selected-window) (current-buffer))
+      (face-remap-add-relative 'bold :slant 'italic)
+      (let ((entry (assq 'bold face-remapping-alist))
+	    (stats (face-merge-cache-statistics)))
+	(xdisp-tests-redisplay)
+	;; Redisplay merged the faces of the text.
+	(should (> (cadr (face-merge-cache-statistics)) (cadr stats)))
+	(setq stats (face-merge-cache-statistics))
+	(face-remap-add-relative 'bold :underline t)
+	(should (eq (assq 'bold face-remapping-alist) entry))
+	(xdisp-tests-redisplay)
+	(should (> (cadr (face-merge-cache-statistics)) (cadr stats)))
+	(should (= (car (face-merge-cache-statistics)) (car stats)))))))
+
+(defun xdisp-tests-long-line-start (setup change)
+  "Return where display lines start around the middle of a long line.
+In a buffer holding a long line, call SETUP, then CHANGE, and return
+the window start that redisplay chooses to show position 80000.  Do this twice: first displaying the line before calling
+CHANGE, so that display lines remembered while moving through it
+could be used again afterwards, then without.  Return both values."
+  (let ((text (mapconcat #'number-to-string (number-sequence 1 20000) " "))
+	starts)
+    (xdisp-tests-with-tty-frame
+      (dolist (early '(t nil))
+	(with-temp-buffer
+	  (insert text)
+	  (set-window-buffer (selected-window) (current-buffer))
+	  (funcall setup)
+	  (goto-char 80000)
+	  (when early
+	    (xdisp-tests-redisplay))
+	  (funcall change)
+	  ;; Make redisplay look for a new start, going back from point.
+	  (set-window-start (selected-window) 1 t)
+	  (xdisp-tests-redisplay)
+	  (push (window-start) starts))))
+    starts))
+
+(ert-deftest xdisp-tests-long-line-wrap-prefix ()
+  "Display lines in a long line follow a new `wrap-prefix'."
+  (let ((starts (xdisp-tests-long-line-start
+		 #'ignore
+		 (lambda () (setq-local wrap-prefix "    ")))))
+    (should (= (car starts) (cadr starts)))))
+
+(ert-deftest xdisp-tests-long-line-display-table ()
+  "Display lines in a long line follow a display table changed in place."
+  (let ((starts (xdisp-tests-long-line-start
+		 (lambda () (setq buffer-display-table (make-display-table)))
+		 (lambda () (aset buffer-display-table ?1 (vector ?a ?b ?c))))))
+    (should (= (car starts) (cadr starts)))))
+
+(ert-deftest xdisp-tests-mode-line-cache-remap-in-place ()
+  "A mode line is produced again after a face is remapped in place.
+Remapping `mode-line' changes the face of the whole line, while
+`mode-line-buffer-id' is used only for the buffer name in it."
+  (dolist (face '(mode-line mode-line-buffer-id))
+    (xdisp-tests-with-tty-frame
+      (with-temp-buffer
+	(set-window-buffer (selected-window) (current-buffer))
+	(face-remap-add-relative face :slant 'italic)
+	(let ((entry (assq face face-remapping-alist))
+	      (cache-mode-lines t)
+	      stats)
+	  (xdisp-tests-redisplay)
+	  (setq stats (mode-line-cache-statistics))
+	  ;; Nothing changed, so the mode line is taken from the cache.
+	  (xdisp-tests-redisplay)
+	  (should (> (car (mode-line-cache-statistics)) (car stats)))
+	  (setq stats (mode-line-cache-statistics))
+	  (face-remap-add-relative face :underline t)
+	  (should (eq (assq face face-remapping-alist) entry))
+	  (xdisp-tests-redisplay)
+	  (should (> (cadr (mode-line-cache-statistics)) (cadr stats)))
+	  (should (= (car (mode-line-cache-statistics)) (car stats))))))))
+
+(ert-deftest xdisp-tests-skipped-fontification ()
+  "Text left unfontified because input was pending is fontified later.
+The next redisplay must do so even though nothing else changed."
+  (xdisp-tests-with-tty-frame
+    (with-temp-buffer
+      (dotimes (_ 100)
+	(insert "some text on a line\n"))
+      (goto-char (point-min))
+      (set-window-buffer (selected-window) (current-buffer))
+      (xdisp-tests-redisplay)
+      (let* ((calls 0)
+	     (fontification-functions
+	      (list (lambda (pos)
+		      (setq calls (1+ calls))
+		      (put-text-property pos (min (point-max) (+ pos 100))
+					 'fontified t)))))
+	(put-text-property (point-min) (point-max) 'fontified nil)
+	;; A non-nil `quit-flag' looks like pending input.
+	(let ((redisplay-skip-fontification-on-input t)
+	      (inhibit-quit t))
+	  (setq quit-flag t)
+	  (redisplay t)
+	  (setq quit-flag nil))
+	(should (= calls 0))
+	(redisplay)
+	(should (> calls 0))))))
+
+(provide 'xdisp-tests)
+
+;;; xdisp-tests.el ends here